@@ -0,0 +1,113 @@
+// Plays PCM from the SharedArrayBuffer ring written by src/streaming/pcmRing.ts.
+// Nothing is allocated and nothing is posted per render quantum; progress is published
+// through the read counter (and Atomics.notify for the producer waiting on it).
+const RING_WRITE = 0;
+const RING_READ = 1;
+const RING_DISCARD_UNTIL = 2;
+const RING_PAUSED = 3;
+const RING_END = 4;
+const RING_UNDERRUNS = 5;
+const RING_STEP = 6;
+const RING_DISCARD_PENDING = 7;
+const RING_CLOSED = 8;
+const RING_HEADER_INTS = 16;
+
+class PcmRingProcessor extends AudioWorkletProcessor {
+  constructor(options) {
+    super();
+    const { buffer, channels, capacity } = options.processorOptions;
+    this._header = new Int32Array(buffer, 0, RING_HEADER_INTS);
+    this._headerFloats = new Float32Array(buffer, 0, RING_HEADER_INTS);
+    this._mask = capacity - 1;
+    this._data = [];
+    for (let ch = 0; ch < channels; ch++) {
+      this._data.push(new Float32Array(buffer, RING_HEADER_INTS * 4 + ch * capacity * 4, capacity));
+    }
+    // Fractional position between ring frame `read` and `read + 1` when resampling
+    this._frac = 0;
+  }
+
+  process(inputs, outputs) {
+    const header = this._header;
+    // The player released this track: stop being processed so the node can be collected
+    if (Atomics.load(header, RING_CLOSED) !== 0) return false;
+
+    const output = outputs[0];
+    if (!output || output.length === 0) return true;
+
+    // Outputs start zeroed, so a paused ring simply leaves silence
+    if (Atomics.load(header, RING_PAUSED) !== 0) return true;
+
+    let read = Atomics.load(header, RING_READ);
+    // Take the seek request once; the producer raises the flag after storing the target, so a
+    // target replaced in between is re-applied next quantum (a no-op if it's not ahead)
+    if (Atomics.exchange(header, RING_DISCARD_PENDING, 0) !== 0) {
+      const discard = Atomics.load(header, RING_DISCARD_UNTIL);
+      if (((discard - read) | 0) > 0) {
+        read = discard;
+        this._frac = 0;
+      }
+    }
+    // Loaded after the discard so it is never older than a target the producer has published
+    const write = Atomics.load(header, RING_WRITE);
+
+    const ended = Atomics.load(header, RING_END) !== 0;
+    const step = this._headerFloats[RING_STEP] || 1;
+    const frames = output[0].length;
+    const channels = Math.min(output.length, this._data.length);
+    const mask = this._mask;
+    // A discard target the producer hasn't written up to yet leaves nothing to play
+    let available = Math.max(0, (write - read) | 0);
+    let produced = 0;
+
+    if (step === 1) {
+      // Same rate: straight copy (two spans at most across the wrap)
+      const count = Math.min(frames, available);
+      const start = read & mask;
+      const firstPart = Math.min(count, mask + 1 - start);
+      for (let ch = 0; ch < channels; ch++) {
+        const src = this._data[ch];
+        const dst = output[ch];
+        dst.set(src.subarray(start, start + firstPart), 0);
+        if (firstPart < count) dst.set(src.subarray(0, count - firstPart), firstPart);
+      }
+      read = (read + count) | 0;
+      produced = count;
+    } else {
+      // Linear interpolation between consecutive ring frames
+      let frac = this._frac;
+      for (let i = 0; i < frames; i++) {
+        if (available < 2 && !(ended && available === 1)) break;
+        const a = read & mask;
+        const b = available > 1 ? (read + 1) & mask : a;
+        for (let ch = 0; ch < channels; ch++) {
+          const src = this._data[ch];
+          output[ch][i] = src[a] + (src[b] - src[a]) * frac;
+        }
+        frac += step;
+        while (frac >= 1 && available > 0) {
+          frac -= 1;
+          read = (read + 1) | 0;
+          available--;
+        }
+        produced++;
+      }
+      this._frac = frac;
+    }
+
+    // Mono sources on a multi-channel output: mirror the first channel
+    for (let ch = channels; ch < output.length; ch++) {
+      output[ch].set(output[0]);
+    }
+
+    if (produced < frames && !ended) {
+      Atomics.add(header, RING_UNDERRUNS, 1);
+    }
+
+    Atomics.store(header, RING_READ, read);
+    Atomics.notify(header, RING_READ);
+    return true;
+  }
+}
+
+registerProcessor('pcm-ring-processor', PcmRingProcessor);
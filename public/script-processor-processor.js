@@ -1,70 +1,78 @@
+// Audio-thread half of the ScriptProcessor shim (see script-processor-shim.js).
+// Two SPSC rings share one SharedArrayBuffer, both planar (one region per channel):
+//   input:  each render quantum's input is appended here for the main thread's handler
+//   output: whatever the handler wrote to outputBuffer comes back here and is played
+// Nothing is allocated and nothing is posted per quantum. Views over every quantum-sized
+// span are built once up front. Quanta are batched: the main thread is only woken (via
+// Atomics.notify) once a whole bufferSize batch of input is in the ring.
+const RING_IN_WRITE = 0;   // input frames written (this processor)
+const RING_IN_READ = 1;    // input frames consumed (main thread)
+const RING_OVERRUNS = 2;   // input quanta dropped because the main thread fell behind
+const RING_OUT_WRITE = 3;  // output frames produced (main thread)
+const RING_OUT_READ = 4;   // output frames played (this processor)
+const RING_UNDERRUNS = 5;  // quanta played as silence because no output was ready
+const RING_HEADER_INTS = 8;
+
+const QUANTUM = 128;
+
+// views[q][ch] covers frames [q * QUANTUM, (q + 1) * QUANTUM) of channel ch
+function quantumViews(buffer, byteOffset, channels, capacity) {
+  const views = [];
+  for (let q = 0; q < capacity / QUANTUM; q++) {
+    const perChannel = [];
+    for (let ch = 0; ch < channels; ch++) {
+      perChannel.push(new Float32Array(buffer, byteOffset + (ch * capacity + q * QUANTUM) * 4, QUANTUM));
+    }
+    views.push(perChannel);
+  }
+  return views;
+}
+
 class ScriptProcessorProcessor extends AudioWorkletProcessor {
-  constructor() {
+  constructor(options) {
     super();
-    this._bufferPool = []; // Array of Float32Array interleaved buffers
-    this._channels = 1;
-    this._bufferSize = 128;
-
-    this.port.onmessage = (e) => {
-      const d = e.data || {};
-      if (d.type === 'buffers' && Array.isArray(d.buffers)) {
-        // Initialize pool from transferred ArrayBuffers
-        this._channels = d.channels || this._channels;
-        this._bufferSize = d.bufferSize || this._bufferSize;
-        this._bufferPool = d.buffers.map(b => new Float32Array(b));
-      } else if (d.type === 'returnBuffer' && d.buffer) {
-        // Returned ArrayBuffer from main thread - re-create view and push back
-        this._bufferPool.push(new Float32Array(d.buffer));
-      }
-    };
+    const { buffer, inputChannels, outputChannels, capacity, batchFrames } = options.processorOptions;
+    this._header = new Int32Array(buffer, 0, RING_HEADER_INTS);
+    this._capacity = capacity;
+    this._quantumMask = capacity / QUANTUM - 1;
+    this._batchMask = batchFrames - 1;
+    const inputBytes = inputChannels * capacity * 4;
+    this._input = quantumViews(buffer, RING_HEADER_INTS * 4, inputChannels, capacity);
+    this._output = quantumViews(buffer, RING_HEADER_INTS * 4 + inputBytes, outputChannels, capacity);
   }
 
   process(inputs, outputs) {
     const input = inputs[0] || [];
     const output = outputs[0] || [];
+    const header = this._header;
 
-    // Try to use a pooled interleaved buffer and transfer back to main thread
-    if (this._bufferPool.length > 0) {
-      const buf = this._bufferPool.shift(); // take ownership
-      const chCount = Math.min(this._channels, input.length || 0);
-      const frameCount = buf.length / this._channels;
-      // Fill interleaved buffer
-      for (let i = 0, idx = 0; i < frameCount; i++, idx += this._channels) {
-        for (let ch = 0; ch < this._channels; ch++) {
-          const channelArr = input[ch] || new Float32Array(frameCount);
-          buf[idx + ch] = channelArr[i] || 0;
-        }
-      }
-
-      try {
-        // Transfer the underlying ArrayBuffer to the main thread
-        this.port.postMessage({ type: 'audio', buffer: buf.buffer, channels: this._channels, frameCount }, [buf.buffer]);
-      } catch (err) {
-        // If transfer fails, drop it and continue
+    // Input: append this quantum, or drop it (never block or allocate here)
+    const inWrite = Atomics.load(header, RING_IN_WRITE);
+    const inRead = Atomics.load(header, RING_IN_READ);
+    if (this._capacity - ((inWrite - inRead) | 0) < QUANTUM) {
+      Atomics.add(header, RING_OVERRUNS, 1);
+    } else {
+      const slot = this._input[(inWrite / QUANTUM) & this._quantumMask];
+      for (let ch = 0; ch < slot.length; ch++) {
+        if (input[ch]) slot[ch].set(input[ch]);
+        else slot[ch].fill(0);
       }
+      const written = (inWrite + QUANTUM) | 0;
+      Atomics.store(header, RING_IN_WRITE, written);
+      if ((written & this._batchMask) === 0) Atomics.notify(header, RING_IN_WRITE);
+    }
 
-      // For output, do a simple passthrough if node is connected to destination
+    // Output: play what the handler produced; outputs start zeroed, so a miss is silence
+    const outWrite = Atomics.load(header, RING_OUT_WRITE);
+    const outRead = Atomics.load(header, RING_OUT_READ);
+    if (((outWrite - outRead) | 0) >= QUANTUM) {
+      const slot = this._output[(outRead / QUANTUM) & this._quantumMask];
       for (let ch = 0; ch < output.length; ch++) {
-        const outC = output[ch];
-        const inC = input[ch] || new Float32Array(outC.length);
-        outC.set(inC);
+        output[ch].set(slot[Math.min(ch, slot.length - 1)]);
       }
-
-      return true;
-    }
-
-    // Fallback: no pooled buffer available, do per-frame copy and post non-transferable message
-    try {
-      const arr = input.map(ch => new Float32Array(ch));
-      this.port.postMessage({ type: 'audio', input: arr });
-    } catch (e) {
-      // ignore
-    }
-
-    for (let ch = 0; ch < output.length; ch++) {
-      const outC = output[ch];
-      const inC = input[ch] || new Float32Array(outC.length);
-      outC.set(inC);
+      Atomics.store(header, RING_OUT_READ, (outRead + QUANTUM) | 0);
+    } else {
+      Atomics.add(header, RING_UNDERRUNS, 1);
     }
 
     return true;
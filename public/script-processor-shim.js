@@ -5,67 +5,169 @@
 
   const moduleUrl = './script-processor-processor.js';
 
+  // Ring header, shared with script-processor-processor.js
+  const RING_IN_WRITE = 0;
+  const RING_IN_READ = 1;
+  const RING_OVERRUNS = 2;
+  const RING_OUT_WRITE = 3;
+  const RING_OUT_READ = 4;
+  const RING_UNDERRUNS = 5;
+  const RING_HEADER_INTS = 8;
+  const RENDER_QUANTUM = 128;
+  // bufferSize 0 lets the implementation choose, as with the native node
+  const DEFAULT_BUFFER_SIZE = 1024;
+  const MAX_BUFFER_SIZE = 16384;
+  // Ring size floor, and the wake-up jitter the output is primed to absorb on top of one batch
+  const MIN_RING_FRAMES = 16384;
+  const OUTPUT_JITTER_FRAMES = 2048;
+
+  const waitAsync = typeof Atomics !== 'undefined' ? Atomics.waitAsync : undefined;
+
+  // Counters for soak runs: main-thread wake-ups (the old per-quantum message rate),
+  // handler callbacks and the time spent in them, input quanta the worklet dropped and
+  // output quanta it had to play as silence
+  const stats = { wakeups: 0, callbacks: 0, handlerMs: 0, overruns: 0, underruns: 0, startedAt: performance.now() };
+  window.__scriptProcessorShimStats = () => {
+    const seconds = (performance.now() - stats.startedAt) / 1000;
+    return {
+      ...stats,
+      wakeupsPerSecond: seconds > 0 ? stats.wakeups / seconds : 0,
+      handlerLoad: seconds > 0 ? stats.handlerMs / (seconds * 1000) : 0
+    };
+  };
+
+  // The requested size, rounded up to a power of two of whole render quanta
+  const batchFramesFor = (bufferSize) => {
+    const requested = Math.min(bufferSize || DEFAULT_BUFFER_SIZE, MAX_BUFFER_SIZE);
+    let frames = RENDER_QUANTUM;
+    while (frames < requested) frames *= 2;
+    return frames;
+  };
+
+  // slots[s][ch] is a persistent view of slot s of channel ch; handed out as-is by getChannelData
+  const slotViews = (buffer, byteOffset, channels, capacity, slotFrames) => {
+    const slots = [];
+    for (let s = 0; s < capacity / slotFrames; s++) {
+      const perChannel = [];
+      for (let ch = 0; ch < channels; ch++) {
+        perChannel.push(new Float32Array(buffer, byteOffset + (ch * capacity + s * slotFrames) * 4, slotFrames));
+      }
+      slots.push(perChannel);
+    }
+    return slots;
+  };
+
   AudioContext.prototype.createScriptProcessor = function(bufferSize = 4096, inputChannels = 1, outputChannels = 1) {
     const ctx = this;
     let workletNode = null;
     let handler = null;
+    // Bumped on disconnect so a wait still in flight doesn't start a second drain loop
+    let pumpGeneration = 0;
     const pending = [];
-    const POOL_SIZE = 4;
-
-    const makeHandler = (e) => {
-      if (!handler) return;
-      // Two possible message shapes: {type:'audio', buffer:ArrayBuffer, channels, frameCount} or {type:'audio', input:[Float32Array,...]}
-      const d = e.data || {};
-      if (d.type === 'audio' && d.buffer) {
-        // Received interleaved transferred buffer
-        const interleaved = new Float32Array(d.buffer);
-        const ch = d.channels || inputChannels;
-        const frameCount = d.frameCount || (interleaved.length / ch);
-        const bufferObj = {
-          numberOfChannels: ch,
-          getChannelData: (c) => {
-            const out = new Float32Array(frameCount);
-            for (let i = 0, j = c; i < frameCount; i++, j += ch) out[i] = interleaved[j];
-            return out;
-          }
-        };
-        const outputBuffer = { getChannelData: (c) => new Float32Array(frameCount) };
-        try { handler({ inputBuffer: bufferObj, outputBuffer }); } catch (err) { console.error('onaudioprocess handler error:', err); }
-
-        // Return buffer back to worklet for reuse by transferring it back
-        try { workletNode.port.postMessage({ type: 'returnBuffer', buffer: d.buffer }, [d.buffer]); } catch (err) {}
-      } else if (Array.isArray(d.input)) {
-        const inputArr = d.input;
-        const bufferObj = {
-          numberOfChannels: inputArr.length,
-          getChannelData: (c) => inputArr[c] || new Float32Array(bufferSize)
-        };
-        const outputBuffer = { getChannelData: (c) => new Float32Array(bufferSize) };
-        try { handler({ inputBuffer: bufferObj, outputBuffer }); } catch (err) { console.error(err); }
+    const inChannels = Math.max(1, inputChannels);
+    const outChannels = Math.max(1, outputChannels);
+    // One handler call per bufferSize frames, like the native node. Larger sizes mean fewer
+    // main-thread wake-ups and more latency; SDL picks it from SDL_HINT_AUDIO_DEVICE_SAMPLE_FRAMES.
+    const slotFrames = batchFramesFor(bufferSize);
+    // Worst-case wake-up delay when Atomics.waitAsync isn't available: half a batch
+    const pollIntervalMs = Math.max(1, (slotFrames / ctx.sampleRate) * 500);
+
+    if (typeof SharedArrayBuffer === 'undefined') {
+      console.warn('ScriptProcessor shim needs SharedArrayBuffer (cross-origin isolation); audio processing is disabled.');
+    }
+
+    // Both rings have the same power-of-two capacity, a whole number of slots
+    let capacity = 1024;
+    while (capacity < Math.max(MIN_RING_FRAMES, slotFrames * 8)) capacity *= 2;
+    const slotMask = capacity / slotFrames - 1;
+    const inputBytes = inChannels * capacity * 4;
+    const ring = typeof SharedArrayBuffer !== 'undefined'
+      ? new SharedArrayBuffer(RING_HEADER_INTS * 4 + inputBytes + outChannels * capacity * 4)
+      : null;
+    const header = ring ? new Int32Array(ring, 0, RING_HEADER_INTS) : null;
+    const inputSlots = ring ? slotViews(ring, RING_HEADER_INTS * 4, inChannels, capacity, slotFrames) : null;
+    const outputSlots = ring ? slotViews(ring, RING_HEADER_INTS * 4 + inputBytes, outChannels, capacity, slotFrames) : null;
+
+    // One event object for the node's lifetime; getChannelData returns views into the rings,
+    // so the handler reads the worklet's input and writes straight into what it will play
+    let inSlot = 0;
+    let outSlot = 0;
+    const event = {
+      inputBuffer: {
+        numberOfChannels: inChannels,
+        length: slotFrames,
+        sampleRate: ctx.sampleRate,
+        duration: slotFrames / ctx.sampleRate,
+        getChannelData: (c) => inputSlots[inSlot][c]
+      },
+      outputBuffer: {
+        numberOfChannels: outChannels,
+        length: slotFrames,
+        sampleRate: ctx.sampleRate,
+        duration: slotFrames / ctx.sampleRate,
+        getChannelData: (c) => outputSlots[outSlot][c]
+      },
+      playbackTime: 0
+    };
+
+    // Runs the handler once per complete input slot that has an output slot free to fill
+    const drain = () => {
+      let inRead = Atomics.load(header, RING_IN_READ);
+      const inWrite = Atomics.load(header, RING_IN_WRITE);
+      let outWrite = Atomics.load(header, RING_OUT_WRITE);
+      const outRead = Atomics.load(header, RING_OUT_READ);
+
+      while (((inWrite - inRead) | 0) >= slotFrames && capacity - ((outWrite - outRead) | 0) >= slotFrames) {
+        inSlot = (inRead / slotFrames) & slotMask;
+        outSlot = (outWrite / slotFrames) & slotMask;
+        const out = outputSlots[outSlot];
+        for (let ch = 0; ch < outChannels; ch++) out[ch].fill(0);
+        if (handler) {
+          const started = performance.now();
+          event.playbackTime = ctx.currentTime;
+          try { handler(event); } catch (err) { console.error('onaudioprocess handler error:', err); }
+          stats.handlerMs += performance.now() - started;
+          stats.callbacks++;
+        }
+        inRead = (inRead + slotFrames) | 0;
+        outWrite = (outWrite + slotFrames) | 0;
+      }
+
+      Atomics.store(header, RING_IN_READ, inRead);
+      Atomics.store(header, RING_OUT_WRITE, outWrite);
+      stats.overruns = Atomics.load(header, RING_OVERRUNS);
+      stats.underruns = Atomics.load(header, RING_UNDERRUNS);
+    };
+
+    // Sleeps until the worklet publishes a full batch; no message or timer per quantum
+    const pump = (generation) => {
+      if (generation !== pumpGeneration) return;
+      stats.wakeups++;
+      drain();
+      const next = () => pump(generation);
+      const write = Atomics.load(header, RING_IN_WRITE);
+      if (waitAsync) {
+        const result = waitAsync(header, RING_IN_WRITE, write);
+        if (result.async) result.value.then(next);
+        else Promise.resolve().then(next);
+      } else {
+        setTimeout(next, pollIntervalMs);
       }
     };
 
     // Start loading the worklet module
-    ctx.audioWorklet.addModule(moduleUrl).then(() => {
+    if (ring) ctx.audioWorklet.addModule(moduleUrl).then(() => {
+      // The first batch's output is due one batch after its input starts arriving, plus
+      // wake-up jitter; that much silence up front is the shim's output latency
+      Atomics.store(header, RING_OUT_WRITE, (1 + Math.ceil(OUTPUT_JITTER_FRAMES / slotFrames)) * slotFrames);
+
       workletNode = new AudioWorkletNode(ctx, 'script-processor-processor', {
         numberOfInputs: 1,
         numberOfOutputs: 1,
-        outputChannelCount: [outputChannels]
+        outputChannelCount: [outChannels],
+        processorOptions: { buffer: ring, inputChannels: inChannels, outputChannels: outChannels, capacity, batchFrames: slotFrames }
       });
-
-      // Initialize buffer pool: create a few transferable interleaved buffers and send them to worklet
-      const buffers = [];
-      const size = bufferSize * Math.max(1, inputChannels);
-      for (let i = 0; i < POOL_SIZE; i++) {
-        buffers.push(new Float32Array(size).buffer);
-      }
-      workletNode.port.postMessage({ type: 'buffers', buffers, channels: Math.max(1, inputChannels), bufferSize }, buffers);
-
-      // Hook up handler if already set
-      workletNode.port.onmessage = makeHandler;
-      if (handler) {
-        // no-op - handler is used in makeHandler
-      }
+      pump(pumpGeneration);
 
       // flush pending connect/disconnect calls
       pending.forEach(evt => {
@@ -78,12 +180,20 @@
 
     const wrapper = {
       connect(dest) {
-        if (workletNode) workletNode.connect(dest);
-        else pending.push({ type: 'connect', dest });
+        if (workletNode) {
+          workletNode.connect(dest);
+          pump(++pumpGeneration);
+        } else {
+          pending.push({ type: 'connect', dest });
+        }
       },
       disconnect() {
-        if (workletNode) workletNode.disconnect();
-        else pending.push({ type: 'disconnect' });
+        if (workletNode) {
+          workletNode.disconnect();
+          pumpGeneration++;
+        } else {
+          pending.push({ type: 'disconnect' });
+        }
       },
       set onaudioprocess(cb) {
         handler = cb;
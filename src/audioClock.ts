@@ -0,0 +1,141 @@
+// Audio clock for the visualizer. Players publish their output position with the time it was
+// sampled and the output latency (src/playerStateBlock.ts); this extrapolates that to any
+// display time, so visuals can show what is heard on the frame it is heard rather than what
+// the analyser held when the frame was drawn.
+import { PlayerStateSnapshot, StateBlockLocation, StateBlockView, createSnapshot } from './playerStateBlock';
+
+export interface AudioClockSnapshot {
+  // Mean and worst difference between where the clock predicted a new published position
+  // would be and where it was, in ms, over the current play run
+  clockDriftMs: number;
+  maxClockDriftMs: number;
+  outputLatencyMs: number;
+  // How far behind the newest spectrum the one on screen was
+  spectrumDelayMs: number;
+}
+
+// A prediction this far off is a seek or a stall, not drift: restart from the new position
+const RESYNC_SECONDS = 0.25;
+// Share of each prediction error folded back in; smooths quantized publishers (currentTime)
+const CORRECTION = 0.1;
+const DRIFT_WEIGHT = 0.05;
+// Spectra kept for latency compensation; at 60 Hz this covers about 260 ms of output latency
+const DELAY_SLOTS = 16;
+
+export class AudioClock {
+  private view: StateBlockView | null = null;
+  private published: PlayerStateSnapshot = createSnapshot();
+  private lastSeq: number = -1;
+  // Model: output position `position` (s) at `at` (clockNow() ms), advancing in real time while playing
+  private position: number = 0;
+  private at: number = 0;
+  private playing: boolean = false;
+  private latency: number = 0;
+  private stats: AudioClockSnapshot = { clockDriftMs: 0, maxClockDriftMs: 0, outputLatencyMs: 0, spectrumDelayMs: 0 };
+
+  // Spectrum delay line: copies of recent spectra stamped with the output position they describe
+  private slots: Uint8Array[] = [];
+  private stamps = new Float64Array(DELAY_SLOTS);
+  private newest: number = -1;
+  private filled: number = 0;
+
+  attach(location: StateBlockLocation | null, binCount: number): void {
+    this.view = location ? new StateBlockView(location.buffer, location.byteOffset) : null;
+    this.lastSeq = -1;
+    this.playing = false;
+    this.resetDelay();
+    this.slots = [];
+    for (let i = 0; i < DELAY_SLOTS; i++) this.slots.push(new Uint8Array(binCount));
+  }
+
+  isAttached(): boolean {
+    return this.view !== null;
+  }
+
+  isPlaying(): boolean {
+    return this.playing;
+  }
+
+  // Folds in a newly published position, if there is one
+  update(): void {
+    if (!this.view) return;
+    const seq = this.view.read(this.published);
+    if (seq === this.lastSeq) return;
+    this.lastSeq = seq;
+
+    const s = this.published;
+    if (s.clockTime > 0 && this.playing && s.isPlaying) {
+      const predicted = this.positionAt(s.clockTime);
+      const error = s.currentTime - predicted;
+      if (Math.abs(error) > RESYNC_SECONDS) {
+        this.resync(s);
+      } else {
+        const driftMs = Math.abs(error) * 1000;
+        this.stats.clockDriftMs += (driftMs - this.stats.clockDriftMs) * DRIFT_WEIGHT;
+        if (driftMs > this.stats.maxClockDriftMs) this.stats.maxClockDriftMs = driftMs;
+        this.position = predicted + error * CORRECTION;
+        this.at = s.clockTime;
+      }
+    } else {
+      if (s.isPlaying && !this.playing) {
+        this.stats.clockDriftMs = 0;
+        this.stats.maxClockDriftMs = 0;
+      }
+      this.resync(s);
+    }
+    this.playing = s.isPlaying;
+    this.latency = s.outputLatency;
+    this.stats.outputLatencyMs = s.outputLatency * 1000;
+  }
+
+  // Output position at clockNow()-based time `time`; frozen while paused
+  positionAt(time: number): number {
+    return this.playing ? this.position + (time - this.at) / 1000 : this.position;
+  }
+
+  // What is heard at `time`: the output position one output latency earlier
+  audibleAt(time: number): number {
+    return this.playing ? Math.max(0, this.positionAt(time) - this.latency) : this.position;
+  }
+
+  // Stores `bins` (describing output up to `now`) and returns the stored spectrum that was
+  // current at `displayTime` minus the output latency. Without a running clock `bins` is
+  // returned as-is.
+  delaySpectrum(bins: Uint8Array, now: number, displayTime: number): Uint8Array {
+    if (!this.playing || this.slots.length === 0 || bins.length !== this.slots[0].length) {
+      this.resetDelay();
+      this.stats.spectrumDelayMs = 0;
+      return bins;
+    }
+
+    this.newest = (this.newest + 1) % DELAY_SLOTS;
+    this.slots[this.newest].set(bins);
+    this.stamps[this.newest] = this.positionAt(now);
+    if (this.filled < DELAY_SLOTS) this.filled++;
+
+    // Newest spectrum that had been output by the time of what is heard on this frame
+    const heard = this.audibleAt(displayTime);
+    let pick = this.newest;
+    for (let i = 1; i < this.filled; i++) {
+      if (this.stamps[pick] <= heard) break;
+      pick = (this.newest - i + DELAY_SLOTS) % DELAY_SLOTS;
+    }
+    this.stats.spectrumDelayMs = (this.stamps[this.newest] - this.stamps[pick]) * 1000;
+    return this.slots[pick];
+  }
+
+  snapshot(): AudioClockSnapshot {
+    return { ...this.stats };
+  }
+
+  private resync(s: PlayerStateSnapshot): void {
+    this.position = s.currentTime;
+    this.at = s.clockTime;
+    this.resetDelay();
+  }
+
+  private resetDelay(): void {
+    this.newest = -1;
+    this.filled = 0;
+  }
+}
@@ -23,6 +23,19 @@ interface ApiResponse {
   files: ApiFile[];
 }
 
+export interface LoadedTrack {
+  audio: ArrayBuffer;
+  index: ArrayBuffer | null;
+}
+
+function resolveUrl(url: string): AudioSource {
+  if (url.startsWith('gs://')) {
+    // Convert gs://bucket/path to https://storage.googleapis.com/bucket/path
+    return { url: url.replace('gs://', 'https://storage.googleapis.com/'), type: 'google-bucket' };
+  }
+  return { url, type: url.startsWith('https') ? 'https' : 'http' };
+}
+
 export class AudioLoader {
   async loadAudio(source: AudioSource): Promise<ArrayBuffer> {
     try {
@@ -69,18 +82,30 @@ export class AudioLoader {
   }
 
   async loadFromURL(url: string): Promise<ArrayBuffer> {
-    let finalUrl = url;
-    let type: 'google-bucket' | 'ftp' | 'http' | 'https' = 'http';
-
-    if (url.startsWith('gs://')) {
-        // Convert gs://bucket/path to https://storage.googleapis.com/bucket/path
-        finalUrl = url.replace('gs://', 'https://storage.googleapis.com/');
-        type = 'google-bucket';
-    } else if (url.startsWith('https')) {
-        type = 'https';
-    }
+    return this.loadAudio(resolveUrl(url));
+  }
+
+  // The audio and, in parallel, the scanner's index next to it (`track.flac.idx`, see
+  // src/trackIndex.ts). A missing or unreachable index is normal and only means the player
+  // summarizes the track itself.
+  async loadTrack(url: string): Promise<LoadedTrack> {
+    const source = resolveUrl(url);
+    const [audio, index] = await Promise.all([this.loadAudio(source), this.loadIndex(source.url)]);
+    return { audio, index };
+  }
 
-    return this.loadAudio({ url: finalUrl, type });
+  async loadIndex(audioUrl: string): Promise<ArrayBuffer | null> {
+    try {
+      // `.idx` goes on the path; signed or cache-busted URLs keep their query string
+      const indexUrl = new URL(audioUrl, self.location.href);
+      indexUrl.pathname += '.idx';
+      indexUrl.hash = '';
+      const response = await fetch(indexUrl, { mode: 'cors', credentials: 'omit' });
+      if (!response.ok) return null;
+      return await response.arrayBuffer();
+    } catch {
+      return null;
+    }
   }
 
   async fetchPlaylist(folder: string): Promise<PlaylistTrack[]> {
@@ -1,5 +1,12 @@
 // Audio player with load/play/pause/seek functionality
 import { FlacDecoder } from './flacDecoder';
+import { DecodeService } from './decodeService';
+import { PlayerStateSnapshot, PlayerStateSource, StateBlockLocation, StateBlockView, allocateStateBlock, outputLatencyOf } from './playerStateBlock';
+import { TrackHandoff, TrackHandoffTarget, decodedAudio } from './decodedTrackStore';
+import { AnalyserSpectrumSource, SpectrumSource } from './spectrumSource';
+import { StereoSource } from './stereoSource';
+import { TrackIndex, indexForTrack } from './trackIndex';
+import { WaveformBuilder, WaveformView, buildInSlices } from './waveformPyramid';
 
 export interface PlayerState {
   isPlaying: boolean;
@@ -8,7 +15,7 @@ export interface PlayerState {
   isLoading: boolean;
 }
 
-export class AudioPlayer {
+export class AudioPlayer implements PlayerStateSource, TrackHandoffTarget {
   private audioContext: AudioContext;
   private sourceNode: AudioBufferSourceNode | null = null;
   private gainNode: GainNode;
@@ -17,7 +24,13 @@ export class AudioPlayer {
   private startTime: number = 0;
   private pausedAt: number = 0;
   private isPlaying: boolean = false;
+  private isLoading: boolean = false;
   private onStateChange?: (state: PlayerState) => void;
+  private stateBlock: StateBlockView = allocateStateBlock();
+  private spectrum: SpectrumSource | null = null;
+  private waveform: WaveformView | null = null;
+  private cancelWaveform: (() => void) | null = null;
+  private trackIndex: TrackIndex | null = null;
 
   constructor() {
     this.audioContext = new AudioContext();
@@ -27,6 +40,8 @@ export class AudioPlayer {
     
     this.gainNode.connect(this.analyser);
     this.analyser.connect(this.audioContext.destination);
+
+    DecodeService.get().acquire();
   }
 
   setStateChangeCallback(callback: (state: PlayerState) => void): void {
@@ -39,17 +54,21 @@ export class AudioPlayer {
     }
   }
 
-  async loadAudio(arrayBuffer: ArrayBuffer): Promise<void> {
+  async loadAudio(arrayBuffer: ArrayBuffer, index: TrackIndex | null = null): Promise<void> {
     this.notifyStateChange();
     
     try {
-      // Stop current playback
+      // Stop current playback and drop the previous track before decoding the next one,
+      // so two decoded tracks are never alive at the same time
       this.stop();
+      this.audioBuffer = null;
+      this.trackIndex = null;
+      this.dropWaveform();
 
-      // Decode the audio
-      const decoder = new FlacDecoder();
-      const decodedData = await decoder.decode(arrayBuffer);
-      this.audioBuffer = await decoder.createAudioBuffer(decodedData);
+      // Decode the audio at the playback rate, on the shared decode context
+      const decoder = new FlacDecoder(this.audioContext.sampleRate);
+      this.audioBuffer = await decoder.decodeToAudioBuffer(arrayBuffer);
+      this.trackIndex = indexForTrack(index, this.audioBuffer.length, this.audioBuffer.sampleRate);
       
       this.pausedAt = 0;
       this.notifyStateChange();
@@ -170,10 +189,31 @@ export class AudioPlayer {
       isPlaying: this.isPlaying,
       currentTime: this.getCurrentTime(),
       duration: this.getDuration(),
-      isLoading: false
+      isLoading: this.isLoading
     };
   }
 
+  setLoading(loading: boolean): void {
+    this.isLoading = loading;
+  }
+
+  // There is no engine thread here, so the block is refreshed from the context clock on read;
+  // its sequence still only moves when a value changed.
+  readState(out: PlayerStateSnapshot): number {
+    const currentTime = this.getCurrentTime();
+    const duration = this.getDuration();
+    this.stateBlock.write(
+      { isPlaying: this.isPlaying, currentTime, duration, isLoading: this.isLoading },
+      Math.max(0, duration - currentTime),
+      outputLatencyOf(this.audioContext)
+    );
+    return this.stateBlock.read(out);
+  }
+
+  stateBlockLocation(): StateBlockLocation {
+    return this.stateBlock;
+  }
+
   setVolume(volume: number): void {
     this.gainNode.gain.value = Math.max(0, Math.min(1, volume));
   }
@@ -182,10 +222,77 @@ export class AudioPlayer {
     return this.analyser;
   }
 
+  getSpectrumSource(): SpectrumSource {
+    if (!this.spectrum) {
+      this.spectrum = new AnalyserSpectrumSource(this.analyser);
+    }
+    return this.spectrum;
+  }
+
+  // Stereo analysis runs in the SDL engine only
+  getStereoSource(): StereoSource | null {
+    return null;
+  }
+
+  // Overview for the seek bar: the scanned index's when there is one, otherwise built from
+  // the decoded buffer in the background on first request
+  getWaveform(): WaveformView | null {
+    if (!this.audioBuffer) return null;
+    if (this.trackIndex) return this.trackIndex.waveform;
+    if (!this.waveform) {
+      const audio = this.audioBuffer;
+      const channels: Float32Array[] = [];
+      for (let ch = 0; ch < audio.numberOfChannels; ch++) channels.push(audio.getChannelData(ch));
+      const builder = new WaveformBuilder(channels, audio.sampleRate);
+      this.cancelWaveform = buildInSlices((maxFrames) => builder.step(maxFrames));
+      this.waveform = builder.view;
+    }
+    return this.waveform;
+  }
+
+  private dropWaveform(): void {
+    this.cancelWaveform?.();
+    this.cancelWaveform = null;
+    this.waveform = null;
+  }
+
+  // Gives up the decoded buffer (no copy) together with the exact playback frame
+  detachTrack(): TrackHandoff | null {
+    if (!this.audioBuffer) return null;
+
+    const audio = this.audioBuffer;
+    const frame = Math.min(Math.round(this.getCurrentTime() * audio.sampleRate), audio.length);
+    const wasPlaying = this.isPlaying;
+    const index = this.trackIndex;
+    this.stop();
+    this.audioBuffer = null;
+    this.trackIndex = null;
+    this.dropWaveform();
+    return { audio: decodedAudio(audio), encoded: null, frame, sampleRate: audio.sampleRate, wasPlaying, index };
+  }
+
+  async adoptTrack(handoff: TrackHandoff): Promise<void> {
+    this.stop();
+    this.dropWaveform();
+    // The streaming player only hands over the encoded file
+    this.audioBuffer = handoff.audio ? await handoff.audio() :
+      await new FlacDecoder(this.audioContext.sampleRate).decodeToAudioBuffer(handoff.encoded!);
+    this.trackIndex = handoff.index;
+
+    // The source node plays buffers at any rate, so the frame maps straight to seconds
+    this.pausedAt = Math.min(handoff.frame / handoff.sampleRate, this.audioBuffer.duration);
+    if (handoff.wasPlaying) {
+      this.play();
+    }
+    this.notifyStateChange();
+  }
+
   destroy(): void {
     this.stop();
+    this.dropWaveform();
     this.gainNode.disconnect();
     this.analyser.disconnect();
     this.audioContext.close();
+    DecodeService.get().release();
   }
 }
@@ -1,16 +1,47 @@
 import React, { useState, useEffect, useRef } from 'react';
-import { AudioPlayer, PlayerState } from '../audioPlayer';
-import { SdlAudioPlayer } from '../sdlAudioPlayer';
+import { AudioPlayer } from '../audioPlayer';
+import { SdlAudioPlayer, getEngineStartupStats } from '../sdlAudioPlayer';
+import { StreamingAudioPlayer } from '../streamingAudioPlayer';
 import { AudioLoader, PlaylistTrack } from '../audioLoader';
+import { PipelineClient } from '../pipelineClient';
+import { DecodedTrackStore } from '../decodedTrackStore';
+import { PlayerStatus, getSubscriptionStats, subscribePlayerState } from '../stateSubscription';
 import { WebGPUVisualizer, VisualizerMode } from '../webgpuVisualizer';
+import { OffscreenVisualizer } from '../visualizerClient';
+import { TrackIndex } from '../trackIndex';
+import { WaveformView } from '../waveformPyramid';
+import { WaveformSeekBar, WaveformSeekBarHandle, getWaveformDrawStats } from './WaveformSeekBar';
 import './Player.css';
 
-type AudioOutputMode = 'web-audio' | 'sdl';
+type AudioOutputMode = 'web-audio' | 'web-audio-stream' | 'sdl';
+
+const formatTime = (seconds: number): string => {
+  const mins = Math.floor(seconds / 60);
+  const secs = Math.floor(seconds % 60);
+  return `${mins}:${secs.toString().padStart(2, '0')}`;
+};
+
+// Renders of the player tree, reported by window.__playerUiStats() next to the subscription stats
+let renderCount = 0;
+
+window.__playerUiStats = () => {
+  const stats = getSubscriptionStats();
+  const minutes = stats.playbackSeconds / 60;
+  return {
+    renders: renderCount,
+    ...stats,
+    ...getWaveformDrawStats(),
+    ...getEngineStartupStats(),
+    ...DecodedTrackStore.get().getStats(),
+    rendersPerMinute: minutes > 0 ? renderCount / minutes : 0,
+    callbackMsPerMinute: minutes > 0 ? stats.callbackMs / minutes : 0
+  };
+};
 
 export const Player: React.FC = () => {
-  const [playerState, setPlayerState] = useState<PlayerState>({
+  // Discrete status only; the playback position never goes through React state
+  const [playerState, setPlayerState] = useState<PlayerStatus>({
     isPlaying: false,
-    currentTime: 0,
     duration: 0,
     isLoading: false
   });
@@ -22,30 +53,50 @@ export const Player: React.FC = () => {
   const [playlist, setPlaylist] = useState<PlaylistTrack[]>([]);
   const [showPlaylist, setShowPlaylist] = useState<boolean>(false);
   const [isLoadingPlaylist, setIsLoadingPlaylist] = useState<boolean>(false);
+  const [showFrameStats, setShowFrameStats] = useState<boolean>(false);
+  const [waveform, setWaveform] = useState<WaveformView | null>(null);
   
   // Use a generic type or union for playerRef
-  const playerRef = useRef<AudioPlayer | SdlAudioPlayer | null>(null);
-  const visualizerRef = useRef<WebGPUVisualizer | null>(null);
+  const playerRef = useRef<AudioPlayer | StreamingAudioPlayer | SdlAudioPlayer | null>(null);
+  const visualizerRef = useRef<WebGPUVisualizer | OffscreenVisualizer | null>(null);
   const canvasRef = useRef<HTMLCanvasElement>(null);
+  const currentTimeRef = useRef<HTMLSpanElement>(null);
+  const seekSliderRef = useRef<HTMLInputElement>(null);
+  const waveformSeekRef = useRef<WaveformSeekBarHandle>(null);
+  const isSeekingRef = useRef<boolean>(false);
+  const shownSecondRef = useRef<number>(-1);
+  const frameStatsRef = useRef<HTMLDivElement>(null);
+  const onBatteryRef = useRef<boolean>(false);
+
+  // Counted after every commit rather than in the render body, which React may run twice
+  useEffect(() => {
+    renderCount++;
+  });
 
   useEffect(() => {
     // Initialize player based on mode
-    let player: AudioPlayer | SdlAudioPlayer;
+    let player: AudioPlayer | StreamingAudioPlayer | SdlAudioPlayer;
     if (outputMode === 'sdl') {
       player = new SdlAudioPlayer();
+    } else if (outputMode === 'web-audio-stream') {
+      player = new StreamingAudioPlayer();
     } else {
       player = new AudioPlayer();
     }
 
-    player.setStateChangeCallback(setPlayerState);
     playerRef.current = player;
 
-    // If we have an existing visualizer, we might need to re-init it if the analyser changed
-    // But SdlAudioPlayer returns a dummy analyser or null.
-    // If outputMode changed, we might want to reload audio if it was loaded?
-    // For now, switching modes resets the player.
+    // A mode switch hands the loaded track (and its position) over instead of reloading it
+    const store = DecodedTrackStore.get();
+    if (store.hasPending()) {
+      player.setLoading(true);
+      store.handTo(player)
+        .catch((err) => setError(err instanceof Error ? err.message : 'Failed to switch output mode'))
+        .finally(() => player.setLoading(false));
+    }
 
     return () => {
+      store.detachFrom(player);
       player.destroy();
       // We don't necessarily destroy visualizer here as it's bound to canvas,
       // but we might need to re-hook the analyser.
@@ -57,20 +108,45 @@ export const Player: React.FC = () => {
     // We need to re-run this when player reference changes (which happens on mode switch)
     // but playerRef.current is mutable.
     // Better to depend on outputMode to trigger re-init of visualizer source.
+    // Only the first run sets up the GPU; later ones just rebind the new player's source.
 
     const initVisualizer = async () => {
       if (!canvasRef.current || !playerRef.current) return;
 
+      // Rendered from a worker where possible, so track loads and React work don't stall it
       if (!visualizerRef.current) {
-        const visualizer = new WebGPUVisualizer(canvasRef.current);
-        visualizerRef.current = visualizer;
+        visualizerRef.current = OffscreenVisualizer.isSupported()
+          ? new OffscreenVisualizer(canvasRef.current)
+          : new WebGPUVisualizer(canvasRef.current);
       }
 
-      const analyser = playerRef.current.getAnalyser();
-      // If analyser is dummy (SDL), visualizer might just show nothing or flat line.
-
-      const success = await visualizerRef.current.initialize(analyser);
+      // Web Audio modes wrap their AnalyserNode; SDL mode reads the engine's spectrum
+      // straight out of WASM memory
+      const spectrum = await playerRef.current.getSpectrumSource();
+      // Correlation, vectorscope and scope come from the engine, so SDL mode only
+      const stereo = await playerRef.current.getStereoSource();
+
+      // Unmounted while the sources were being fetched
+      const visualizer = visualizerRef.current;
+      if (!visualizer || !playerRef.current) return;
+
+      // The player's state block doubles as the audio clock the visuals are locked to
+      const clock = playerRef.current.stateBlockLocation();
+      let success = await visualizer.initialize(spectrum, clock, stereo);
+      // Destroyed or replaced in the meantime
+      if (visualizerRef.current !== visualizer) return;
+      // No WebGPU in the worker: the canvas was never handed over, so draw from the page
+      if (!success && visualizer instanceof OffscreenVisualizer && !visualizer.ownsCanvas() && canvasRef.current) {
+        visualizer.destroy();
+        const fallback = new WebGPUVisualizer(canvasRef.current);
+        visualizerRef.current = fallback;
+        success = await fallback.initialize(spectrum, clock, stereo);
+        if (visualizerRef.current !== fallback) return;
+      }
       if (success) {
+          visualizerRef.current.setVisible(document.visibilityState === 'visible');
+          visualizerRef.current.setOnBattery(onBatteryRef.current);
+          visualizerRef.current.setPlaying(playerRef.current?.getState().isPlaying ?? false);
           visualizerRef.current.startAnimation();
           visualizerRef.current.setMode(visualizerMode);
           visualizerRef.current.setTogglePlayCallback(() => {
@@ -92,6 +168,54 @@ export const Player: React.FC = () => {
     initVisualizer();
   }, [outputMode]); // Re-run when output mode changes
 
+  // The visualizer outlives mode switches but not the player: its worker and GPU device go
+  // with the component
+  useEffect(() => {
+    return () => {
+      visualizerRef.current?.destroy();
+      visualizerRef.current = null;
+    };
+  }, []);
+
+  // Player status comes from the active player's state block, read once per frame.
+  // React re-renders on discrete changes only; the time text and seek slider are
+  // written through refs so playback itself causes no renders.
+  useEffect(() => {
+    return subscribePlayerState(() => playerRef.current, {
+      onStatus: (status) => {
+        setPlayerState(status);
+        visualizerRef.current?.setPlaying(status.isPlaying);
+      },
+      onPosition: (snapshot) => {
+        const second = Math.floor(snapshot.currentTime);
+        if (currentTimeRef.current && second !== shownSecondRef.current) {
+          shownSecondRef.current = second;
+          currentTimeRef.current.textContent = formatTime(snapshot.currentTime);
+        }
+        // Leave the thumb alone while the user is dragging it
+        if (seekSliderRef.current && !isSeekingRef.current) {
+          seekSliderRef.current.value = String(snapshot.currentTime);
+        }
+        waveformSeekRef.current?.setPosition(snapshot.currentTime);
+      }
+    });
+  }, []);
+
+  // A finished load (or a switch to another player) may bring a new overview to seek on;
+  // any load drops the one being shown
+  useEffect(() => {
+    if (playerState.isLoading) {
+      setWaveform(null);
+      return;
+    }
+    setWaveform(playerState.duration > 0 ? playerRef.current?.getWaveform() ?? null : null);
+  }, [playerState.duration, playerState.isLoading, outputMode]);
+
+  // Only the SDL engine feeds the stereo view
+  useEffect(() => {
+    if (outputMode !== 'sdl' && visualizerMode === 'stereo') setVisualizerMode('flat');
+  }, [outputMode, visualizerMode]);
+
   // Update visualizer mode when state changes
   useEffect(() => {
       if (visualizerRef.current) {
@@ -99,22 +223,82 @@ export const Player: React.FC = () => {
       }
   }, [visualizerMode]);
 
+  // The visualizer stops drawing in hidden tabs and caps its frame rate on battery
+  useEffect(() => {
+    const onVisibility = () => visualizerRef.current?.setVisible(document.visibilityState === 'visible');
+    document.addEventListener('visibilitychange', onVisibility);
+
+    let battery: any = null;
+    const onCharging = () => {
+      onBatteryRef.current = !battery.charging;
+      visualizerRef.current?.setOnBattery(onBatteryRef.current);
+    };
+    const nav = navigator as any;
+    if (typeof nav.getBattery === 'function') {
+      nav.getBattery().then((b: any) => {
+        battery = b;
+        battery.addEventListener('chargingchange', onCharging);
+        onCharging();
+      }).catch(() => { /* Battery API blocked; pace as if plugged in */ });
+    }
+
+    return () => {
+      document.removeEventListener('visibilitychange', onVisibility);
+      battery?.removeEventListener('chargingchange', onCharging);
+    };
+  }, []);
+
+  // Frame timing overlay, written straight to the DOM twice a second
+  useEffect(() => {
+    if (!showFrameStats) return;
+    const update = () => {
+      const el = frameStatsRef.current;
+      const visualizer = visualizerRef.current;
+      if (!el || !visualizer) return;
+      const s = visualizer.getStats();
+      const gc = s.gcFreeStreak < 0
+        ? 'n/a'
+        : `${s.gcFreeStreak} (best ${s.longestGcFreeStreak}, ${s.gcEvents} GCs)`;
+      el.textContent =
+        `cpu ${s.avgCpuFrameMs.toFixed(2)} ms avg / ${s.maxCpuFrameMs.toFixed(2)} max\n` +
+        `dropped ${s.droppedFrames} of ${s.frames}\n` +
+        `gc-free ${gc}\n` +
+        `upload ${s.uploadBytes} B/frame\n` +
+        `pacing ${s.pacing}${s.fpsCap > 0 ? ` @${Math.round(s.fpsCap)}` : ''}, ` +
+        `skipped ${s.skippedFrames}, saved ${s.submitsSaved} submits\n` +
+        `clock drift ${s.clockDriftMs.toFixed(2)} ms avg / ${s.maxClockDriftMs.toFixed(2)} max\n` +
+        `latency ${s.outputLatencyMs.toFixed(1)} ms, spectrum delayed ${s.spectrumDelayMs.toFixed(1)} ms\n` +
+        `gpu init ${s.gpuInitMs.toFixed(1)} ms (${s.gpuInits}x), ` +
+        `switch ${s.lastSwitchMs.toFixed(2)} ms / ${s.maxSwitchMs.toFixed(2)} max (${s.sourceSwitches}x)\n` +
+        `gpu memory ${(s.gpuMemoryBytes / 1024).toFixed(0)} KiB in ${s.gpuObjects} objects`;
+    };
+    update();
+    const id = window.setInterval(update, 500);
+    return () => window.clearInterval(id);
+  }, [showFrameStats]);
+
   const loadAudioFromUrl = async (url: string) => {
     if (!url.trim() || !playerRef.current) {
       return;
     }
 
-    setPlayerState(prev => ({ ...prev, isLoading: true }));
+    const player = playerRef.current;
+    player.setLoading(true);
+    // The old track's overview must not be drawn (or seeked on) while the new one loads
+    setWaveform(null);
     setError('');
 
     try {
-      const loader = new AudioLoader();
-      const arrayBuffer = await loader.loadFromURL(url);
-      await playerRef.current.loadAudio(arrayBuffer);
+      // Fetching runs in the pipeline worker so large downloads never block rendering. A
+      // scanned track's index comes along and is used in place, so nothing is recomputed.
+      const { audio, index } = await PipelineClient.get().loadTrack(url);
+      const trackIndex = index ? TrackIndex.from(index) : null;
+      if (index && !trackIndex) console.warn(`Ignoring the index next to ${url}: not a version this build reads`);
+      await player.loadAudio(audio, trackIndex);
     } catch (err) {
       setError(err instanceof Error ? err.message : 'Failed to load audio');
     } finally {
-      setPlayerState(prev => ({ ...prev, isLoading: false }));
+      player.setLoading(false);
     }
   };
 
@@ -149,10 +333,8 @@ export const Player: React.FC = () => {
     playerRef.current?.seek(time);
   };
 
-  const formatTime = (seconds: number): string => {
-    const mins = Math.floor(seconds / 60);
-    const secs = Math.floor(seconds % 60);
-    return `${mins}:${secs.toString().padStart(2, '0')}`;
+  const handleWaveformSeek = (time: number) => {
+    playerRef.current?.seek(time);
   };
 
   return (
@@ -164,6 +346,17 @@ export const Player: React.FC = () => {
           height={400}
           className="visualizer-canvas"
         />
+        {webGPUSupported && (
+          <button
+            className="frame-stats-toggle"
+            onClick={() => setShowFrameStats(!showFrameStats)}
+            title="Frame timing"
+          >
+            {showFrameStats ? '×' : 'ms'}
+          </button>
+        )}
+        {showFrameStats && <div ref={frameStatsRef} className="frame-stats" />}
+
         {!webGPUSupported && (
           <div className="webgpu-warning">
             WebGPU not supported in this browser
@@ -225,6 +418,35 @@ export const Player: React.FC = () => {
                 >
                     Flat Mode
                 </button>
+                <button
+                    className={`toggle-btn ${visualizerMode === 'waterfall' ? 'active' : ''}`}
+                    onClick={() => setVisualizerMode('waterfall')}
+                    style={{
+                        padding: '0.5rem 1rem',
+                        background: visualizerMode === 'waterfall' ? '#0084ff' : 'rgba(255,255,255,0.1)',
+                        border: 'none',
+                        color: 'white',
+                        cursor: 'pointer'
+                    }}
+                >
+                    Waterfall
+                </button>
+                <button
+                    className={`toggle-btn ${visualizerMode === 'stereo' ? 'active' : ''}`}
+                    onClick={() => setVisualizerMode('stereo')}
+                    disabled={outputMode !== 'sdl'}
+                    title={outputMode !== 'sdl' ? 'Stereo analysis needs SDL output' : undefined}
+                    style={{
+                        padding: '0.5rem 1rem',
+                        background: visualizerMode === 'stereo' ? '#0084ff' : 'rgba(255,255,255,0.1)',
+                        border: 'none',
+                        color: 'white',
+                        cursor: outputMode !== 'sdl' ? 'not-allowed' : 'pointer',
+                        opacity: outputMode !== 'sdl' ? 0.5 : 1
+                    }}
+                >
+                    Stereo
+                </button>
                 <button
                     className={`toggle-btn ${visualizerMode === '3D' ? 'active' : ''}`}
                     onClick={() => setVisualizerMode('3D')}
@@ -259,6 +481,21 @@ export const Player: React.FC = () => {
                 >
                     Web Audio
                 </button>
+                <button
+                    className={`toggle-btn ${outputMode === 'web-audio-stream' ? 'active' : ''}`}
+                    onClick={() => setOutputMode('web-audio-stream')}
+                    disabled={typeof SharedArrayBuffer === 'undefined'}
+                    title={typeof SharedArrayBuffer === 'undefined' ? 'Needs a cross-origin isolated page' : undefined}
+                    style={{
+                        padding: '0.5rem 1rem',
+                        background: outputMode === 'web-audio-stream' ? '#28a745' : 'rgba(255,255,255,0.1)',
+                        border: 'none',
+                        color: 'white',
+                        cursor: 'pointer'
+                    }}
+                >
+                    Web Audio (Stream)
+                </button>
                 <button
                     className={`toggle-btn ${outputMode === 'sdl' ? 'active' : ''}`}
                     onClick={() => setOutputMode('sdl')}
@@ -319,17 +556,34 @@ export const Player: React.FC = () => {
         </div>
 
         <div className="seek-container">
-          <span className="time-display">{formatTime(playerState.currentTime)}</span>
-          <input
-            type="range"
-            className="seek-slider"
-            min="0"
-            max={playerState.duration || 0}
-            step="0.1"
-            value={playerState.currentTime}
-            onChange={handleSeek}
-            disabled={!playerState.duration}
-          />
+          <span className="time-display" ref={currentTimeRef}>{formatTime(0)}</span>
+          {waveform ? (
+            <WaveformSeekBar
+              ref={waveformSeekRef}
+              waveform={waveform}
+              duration={playerState.duration}
+              onSeek={handleWaveformSeek}
+            />
+          ) : (
+            <input
+              ref={seekSliderRef}
+              type="range"
+              className="seek-slider"
+              min="0"
+              max={playerState.duration || 0}
+              step="0.1"
+              defaultValue={0}
+              onChange={handleSeek}
+              // Capturing the pointer keeps pointerup coming here when the drag ends off the slider
+              onPointerDown={(e) => {
+                e.currentTarget.setPointerCapture(e.pointerId);
+                isSeekingRef.current = true;
+              }}
+              onPointerUp={() => { isSeekingRef.current = false; }}
+              onPointerCancel={() => { isSeekingRef.current = false; }}
+              disabled={!playerState.duration}
+            />
+          )}
           <span className="time-display">{formatTime(playerState.duration)}</span>
         </div>
 
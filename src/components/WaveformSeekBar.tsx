@@ -0,0 +1,188 @@
+import React, { forwardRef, useEffect, useImperativeHandle, useRef } from 'react';
+import { WaveformView } from '../waveformPyramid';
+
+export interface WaveformSeekBarHandle {
+  setPosition(seconds: number): void;
+}
+
+interface WaveformSeekBarProps {
+  waveform: WaveformView;
+  duration: number;
+  onSeek: (seconds: number) => void;
+}
+
+// Cost of the last and slowest full waveform draw, reported by window.__playerUiStats()
+const drawStats = { waveformDrawMs: 0, waveformMaxDrawMs: 0, waveformDraws: 0 };
+
+export function getWaveformDrawStats(): typeof drawStats {
+  return { ...drawStats };
+}
+
+// While the pyramid is still being built the waveform is redrawn at this interval
+const BUILD_REDRAW_MS = 100;
+
+// Draws the level with one or two buckets per pixel, so a column folds at most a few buckets
+// and the cost is O(width) whatever the track length.
+function drawWaveform(canvas: HTMLCanvasElement, waveform: WaveformView): void {
+  const started = performance.now();
+  const width = canvas.width;
+  const height = canvas.height;
+  const ctx = canvas.getContext('2d');
+  if (!ctx || width === 0) return;
+  ctx.clearRect(0, 0, width, height);
+
+  const level = waveform.levelFor(width);
+  const data = waveform.levelData(level);
+  const buckets = waveform.buckets(level);
+  const built = waveform.builtBuckets(level);
+  const perPixel = buckets / width;
+  const mid = height / 2;
+  const scale = mid / 127;
+
+  ctx.fillStyle = 'rgba(0, 132, 255, 0.75)';
+  for (let x = 0; x < width; x++) {
+    const first = Math.floor(x * perPixel);
+    if (first >= built) break;
+    const last = Math.min(built, Math.max(first + 1, Math.floor((x + 1) * perPixel)));
+    let lo = 127;
+    let hi = -127;
+    for (let b = first; b < last; b++) {
+      if (data[b * 2] < lo) lo = data[b * 2];
+      if (data[b * 2 + 1] > hi) hi = data[b * 2 + 1];
+    }
+    const top = mid - hi * scale;
+    ctx.fillRect(x, top, 1, Math.max(1, (hi - lo) * scale));
+  }
+
+  const ms = performance.now() - started;
+  drawStats.waveformDrawMs = ms;
+  drawStats.waveformDraws++;
+  if (ms > drawStats.waveformMaxDrawMs) drawStats.waveformMaxDrawMs = ms;
+}
+
+// Seek bar over the track's min/max overview. The waveform sits on its own canvas and is
+// only redrawn when the width changes or the pyramid fills in; playback just moves the
+// playhead on the overlay canvas above it.
+export const WaveformSeekBar = forwardRef<WaveformSeekBarHandle, WaveformSeekBarProps>(
+  ({ waveform, duration, onSeek }, ref) => {
+    const containerRef = useRef<HTMLDivElement>(null);
+    const baseRef = useRef<HTMLCanvasElement>(null);
+    const overlayRef = useRef<HTMLCanvasElement>(null);
+    const positionRef = useRef<number>(0);
+    const shownXRef = useRef<number>(-1);
+    const draggingRef = useRef<boolean>(false);
+
+    const drawPlayhead = (seconds: number) => {
+      const overlay = overlayRef.current;
+      if (!overlay || duration <= 0) return;
+      const x = Math.round(Math.min(1, Math.max(0, seconds / duration)) * overlay.width);
+      if (x === shownXRef.current) return;
+      shownXRef.current = x;
+
+      const ctx = overlay.getContext('2d');
+      if (!ctx) return;
+      ctx.clearRect(0, 0, overlay.width, overlay.height);
+      ctx.fillStyle = 'rgba(255, 255, 255, 0.08)';
+      ctx.fillRect(0, 0, x, overlay.height);
+      ctx.fillStyle = '#ffffff';
+      ctx.fillRect(Math.max(0, x - 1), 0, 2, overlay.height);
+    };
+
+    useImperativeHandle(ref, () => ({
+      setPosition(seconds: number) {
+        positionRef.current = seconds;
+        // Leave the playhead where the user is dragging it
+        if (!draggingRef.current) drawPlayhead(seconds);
+      }
+    }), [duration]);
+
+    // Size both canvases to the element in device pixels and redraw on resize
+    useEffect(() => {
+      const container = containerRef.current;
+      const base = baseRef.current;
+      const overlay = overlayRef.current;
+      if (!container || !base || !overlay) return;
+
+      const resize = () => {
+        const dpr = window.devicePixelRatio || 1;
+        const width = Math.max(1, Math.round(container.clientWidth * dpr));
+        const height = Math.max(1, Math.round(container.clientHeight * dpr));
+        if (base.width !== width || base.height !== height) {
+          base.width = overlay.width = width;
+          base.height = overlay.height = height;
+          shownXRef.current = -1;
+        }
+        drawWaveform(base, waveform);
+        drawPlayhead(positionRef.current);
+      };
+      resize();
+
+      const observer = new ResizeObserver(resize);
+      observer.observe(container);
+
+      let timer: ReturnType<typeof setInterval> | null = null;
+      if (!waveform.isComplete()) {
+        timer = setInterval(() => {
+          drawWaveform(base, waveform);
+          if (waveform.isComplete() && timer !== null) {
+            clearInterval(timer);
+            timer = null;
+          }
+        }, BUILD_REDRAW_MS);
+      }
+
+      return () => {
+        observer.disconnect();
+        if (timer !== null) clearInterval(timer);
+      };
+    }, [waveform, duration]);
+
+    const timeAt = (e: React.PointerEvent<HTMLDivElement>): number => {
+      const rect = e.currentTarget.getBoundingClientRect();
+      const fraction = rect.width > 0 ? (e.clientX - rect.left) / rect.width : 0;
+      return Math.min(1, Math.max(0, fraction)) * duration;
+    };
+
+    // The playhead follows the pointer; the seek happens once, on release
+    const handlePointerDown = (e: React.PointerEvent<HTMLDivElement>) => {
+      if (duration <= 0) return;
+      e.currentTarget.setPointerCapture(e.pointerId);
+      draggingRef.current = true;
+      drawPlayhead(timeAt(e));
+    };
+
+    const handlePointerMove = (e: React.PointerEvent<HTMLDivElement>) => {
+      if (draggingRef.current) drawPlayhead(timeAt(e));
+    };
+
+    const handlePointerUp = (e: React.PointerEvent<HTMLDivElement>) => {
+      if (!draggingRef.current) return;
+      draggingRef.current = false;
+      const seconds = timeAt(e);
+      positionRef.current = seconds;
+      onSeek(seconds);
+    };
+
+    const handlePointerCancel = () => {
+      draggingRef.current = false;
+      shownXRef.current = -1;
+      drawPlayhead(positionRef.current);
+    };
+
+    return (
+      <div
+        ref={containerRef}
+        className="waveform-seek"
+        onPointerDown={handlePointerDown}
+        onPointerMove={handlePointerMove}
+        onPointerUp={handlePointerUp}
+        onPointerCancel={handlePointerCancel}
+      >
+        <canvas ref={baseRef} className="waveform-seek-layer" />
+        <canvas ref={overlayRef} className="waveform-seek-layer" />
+      </div>
+    );
+  }
+);
+
+WaveformSeekBar.displayName = 'WaveformSeekBar';
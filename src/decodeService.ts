@@ -0,0 +1,90 @@
+// Shared decode service. Owns the only contexts used for decoding so that loading a track
+// never creates (and leaks) an AudioContext. Decoding runs on OfflineAudioContexts, which
+// are never started and therefore never spin up an audio rendering thread.
+
+const DEFAULT_SAMPLE_RATE = 48000;
+
+export interface DecodeServiceStats {
+  contextsCreated: number;
+  contextsLive: number;
+  decodes: number;
+  // PCM bytes held by the most recent decode; with no extra copies this is the peak per load
+  lastDecodedBytes: number;
+}
+
+// Reads the native sample rate from a FLAC STREAMINFO or WAV fmt header, so the decode
+// can run without resampling. Returns null for anything else.
+export function sniffSampleRate(arrayBuffer: ArrayBuffer): number | null {
+  if (arrayBuffer.byteLength < 44) return null;
+  const view = new DataView(arrayBuffer);
+
+  // "fLaC" followed by the STREAMINFO block: the rate is the top 20 bits at byte 18
+  if (view.getUint32(0) === 0x664c6143) {
+    const rate = (view.getUint32(18) >>> 12) & 0xfffff;
+    return rate > 0 ? rate : null;
+  }
+
+  // "RIFF" .... "WAVE" with the fmt chunk first (the common layout)
+  if (view.getUint32(0) === 0x52494646 && view.getUint32(8) === 0x57415645 && view.getUint32(12) === 0x666d7420) {
+    const rate = view.getUint32(24, true);
+    return rate > 0 ? rate : null;
+  }
+
+  return null;
+}
+
+export class DecodeService {
+  private static instance: DecodeService | null = null;
+
+  private contexts = new Map<number, OfflineAudioContext>();
+  private users: number = 0;
+  private counters = { contextsCreated: 0, decodes: 0, lastDecodedBytes: 0 };
+
+  static get(): DecodeService {
+    if (!DecodeService.instance) {
+      DecodeService.instance = new DecodeService();
+    }
+    return DecodeService.instance;
+  }
+
+  // Players hold a reference for their lifetime; the contexts are dropped with the last one
+  acquire(): void {
+    this.users++;
+  }
+
+  release(): void {
+    this.users = Math.max(0, this.users - 1);
+    if (this.users === 0) {
+      this.dispose();
+    }
+  }
+
+  // One context per sample rate, created on first use and reused for every later decode
+  getContext(sampleRate: number = DEFAULT_SAMPLE_RATE): OfflineAudioContext {
+    let context = this.contexts.get(sampleRate);
+    if (!context) {
+      context = new OfflineAudioContext(1, 1, sampleRate);
+      this.contexts.set(sampleRate, context);
+      this.counters.contextsCreated++;
+    }
+    return context;
+  }
+
+  // Decodes at `sampleRate` if given, otherwise at the file's native rate when it can be read
+  async decode(arrayBuffer: ArrayBuffer, sampleRate?: number): Promise<AudioBuffer> {
+    const rate = sampleRate ?? sniffSampleRate(arrayBuffer) ?? DEFAULT_SAMPLE_RATE;
+    this.counters.decodes++;
+    const audioBuffer = await this.getContext(rate).decodeAudioData(arrayBuffer);
+    this.counters.lastDecodedBytes = audioBuffer.length * audioBuffer.numberOfChannels * Float32Array.BYTES_PER_ELEMENT;
+    return audioBuffer;
+  }
+
+  getStats(): DecodeServiceStats {
+    return { ...this.counters, contextsLive: this.contexts.size };
+  }
+
+  // OfflineAudioContext has no close(); never-started contexts are released with their references
+  dispose(): void {
+    this.contexts.clear();
+  }
+}
@@ -0,0 +1,117 @@
+// Hands the loaded track from one output mode's player to the next, so switching modes
+// doesn't re-download or re-decode it. PCM is owned by exactly one party at a time: the
+// outgoing player gives it up in detachTrack(), the store holds it while no player does,
+// and the incoming player takes it in adoptTrack().
+import { TrackIndex } from './trackIndex';
+
+export interface TrackHandoff {
+  // Decoded planar PCM at the rate it was decoded at. A function so the outgoing player can
+  // let go without copying: the SDL engine only copies the track out of WASM memory when the
+  // incoming player calls it, and repeat calls share that one copy. Null when only the
+  // encoded file is available (the streaming player never holds the whole decoded track).
+  audio: (() => Promise<AudioBuffer>) | null;
+  encoded: ArrayBuffer | null;
+  // Playback position in frames at `sampleRate` (the rate of `audio`, or the file's
+  // native rate when only `encoded` is set)
+  frame: number;
+  sampleRate: number;
+  wasPlaying: boolean;
+  // The scanner's index for the track, when one came with it (see src/trackIndex.ts)
+  index: TrackIndex | null;
+  // Frees what the handoff still holds when it is dropped without being adopted
+  dispose?: () => void;
+}
+
+// `audio` for a player that already holds an AudioBuffer
+export function decodedAudio(buffer: AudioBuffer): () => Promise<AudioBuffer> {
+  const ready = Promise.resolve(buffer);
+  return () => ready;
+}
+
+// Implemented by every player so Player.tsx can switch backends generically
+export interface TrackHandoffTarget {
+  detachTrack(): TrackHandoff | null;
+  adoptTrack(handoff: TrackHandoff): Promise<void>;
+}
+
+export interface TrackStoreStats {
+  handoffs: number;
+  // detach + adopt of the most recent switch, in ms
+  lastHandoffMs: number;
+}
+
+export class DecodedTrackStore {
+  private static instance: DecodedTrackStore | null = null;
+
+  private pending: TrackHandoff | null = null;
+  // The handoff being adopted, until the adopt finishes. A switch before then detaches a
+  // player that never got the track, so this one is carried on to the next player instead.
+  private adopting: { player: TrackHandoffTarget; handoff: TrackHandoff } | null = null;
+  // Bumped by every detach; an adopt that finishes under an older generation went into a
+  // player that is already gone
+  private generation: number = 0;
+  private detachedAt: number = 0;
+  private stats: TrackStoreStats = { handoffs: 0, lastHandoffMs: 0 };
+
+  static get(): DecodedTrackStore {
+    if (!DecodedTrackStore.instance) {
+      DecodedTrackStore.instance = new DecodedTrackStore();
+    }
+    return DecodedTrackStore.instance;
+  }
+
+  // Detaches the current track from `player` and holds it until the next handTo(). A
+  // handoff nobody took yet is dropped.
+  detachFrom(player: TrackHandoffTarget): void {
+    this.generation++;
+    let handoff: TrackHandoff | null;
+    if (this.adopting?.player === player) {
+      // It never finished taking the track: pass on what it was handed
+      handoff = this.adopting.handoff;
+      player.detachTrack()?.dispose?.();
+    } else {
+      this.detachedAt = performance.now();
+      handoff = player.detachTrack();
+    }
+    this.adopting = null;
+    if (this.pending && this.pending !== handoff) this.pending.dispose?.();
+    this.pending = handoff;
+  }
+
+  // Gives the held track to `player`, if there is one; the store lets go of it first.
+  // False when there was nothing to give or another switch overtook this one.
+  async handTo(player: TrackHandoffTarget): Promise<boolean> {
+    const handoff = this.pending;
+    this.pending = null;
+    if (!handoff) return false;
+
+    const generation = this.generation;
+    this.adopting = { player, handoff };
+    try {
+      await player.adoptTrack(handoff);
+    } catch (err) {
+      if (generation !== this.generation) return false;
+      throw err;
+    } finally {
+      if (this.adopting?.handoff === handoff) this.adopting = null;
+    }
+    if (generation !== this.generation) return false;
+
+    this.stats.handoffs++;
+    this.stats.lastHandoffMs = performance.now() - this.detachedAt;
+    return true;
+  }
+
+  hasPending(): boolean {
+    return this.pending !== null;
+  }
+
+  clear(): void {
+    this.pending?.dispose?.();
+    this.pending = null;
+  }
+
+  getStats(): TrackStoreStats {
+    return { ...this.stats };
+  }
+}
@@ -0,0 +1,111 @@
+// JS side of the engine's command buffer (CommandBuffer in src/sdl/audio_engine.cpp):
+//   i32 count | i32 reserved | 64 x { i32 op | i32 reserved | f64 arg }
+// Controls append opcodes here and the queue is drained with a single _flush_commands()
+// call per animation frame, so a seek-bar drag costs one WASM call per frame, not per event.
+
+export const CMD_PLAY = 1;
+export const CMD_PAUSE = 2;
+export const CMD_RESUME = 3;
+export const CMD_STOP = 4;
+export const CMD_SEEK = 5;
+export const CMD_SET_VOLUME = 6;
+
+export const COMMAND_CAPACITY = 64;
+const HEADER_BYTES = 8;
+const COMMAND_BYTES = 16;
+export const COMMAND_BUFFER_BYTES = HEADER_BYTES + COMMAND_BYTES * COMMAND_CAPACITY;
+
+export interface CommandStats {
+  enqueued: number;   // commands appended by the UI
+  wasmCalls: number;  // _flush_commands() calls actually made
+  executed: number;   // commands the engine ran after coalescing
+}
+
+export interface CommandTarget {
+  heapBuffer(): ArrayBufferLike;
+  bufferPtr(): number;
+  flush(): number;
+}
+
+export class EngineCommandQueue {
+  readonly stats: CommandStats = { enqueued: 0, wasmCalls: 0, executed: 0 };
+
+  private target: CommandTarget;
+  private ints: Int32Array | null = null;
+  private floats: Float64Array | null = null;
+  private viewBuffer: ArrayBufferLike | null = null;
+  private frameId: number | null = null;
+
+  constructor(target: CommandTarget) {
+    this.target = target;
+  }
+
+  enqueue(op: number, arg: number = 0): void {
+    this.ensureViews();
+    let ints = this.ints!;
+
+    let count = Atomics.load(ints, 0);
+    if (count >= COMMAND_CAPACITY) {
+      this.flush();
+      ints = this.ints!;
+      count = 0;
+    }
+
+    const base = HEADER_BYTES + count * COMMAND_BYTES;
+    ints[base >> 2] = op;
+    this.floats![(base + 8) >> 3] = arg;
+    Atomics.store(ints, 0, count + 1);
+    this.stats.enqueued++;
+
+    this.scheduleFlush();
+  }
+
+  // Drains the queue now. Called from the frame callback, and synchronously before any
+  // direct engine call (load, cleanup) so commands are never applied out of order.
+  flush(): void {
+    if (this.frameId !== null) {
+      cancelAnimationFrame(this.frameId);
+      this.frameId = null;
+    }
+    if (!this.ints) return;
+
+    this.ensureViews();
+    if (Atomics.load(this.ints, 0) === 0) return;
+
+    this.stats.executed += this.target.flush();
+    this.stats.wasmCalls++;
+  }
+
+  dispose(): void {
+    if (this.frameId !== null) {
+      cancelAnimationFrame(this.frameId);
+      this.frameId = null;
+    }
+    this.ints = null;
+    this.floats = null;
+    this.viewBuffer = null;
+  }
+
+  private scheduleFlush(): void {
+    if (this.frameId !== null) return;
+    // Hidden tabs get no animation frames; don't let controls wait for the tab to return
+    if (typeof document !== 'undefined' && document.visibilityState === 'hidden') {
+      this.flush();
+      return;
+    }
+    this.frameId = requestAnimationFrame(() => {
+      this.frameId = null;
+      this.flush();
+    });
+  }
+
+  // Views over WASM memory must be rebuilt whenever memory growth replaces the buffer
+  private ensureViews(): void {
+    const heap = this.target.heapBuffer();
+    if (this.viewBuffer === heap && this.ints) return;
+    const ptr = this.target.bufferPtr();
+    this.ints = new Int32Array(heap, ptr, COMMAND_BUFFER_BYTES / 4);
+    this.floats = new Float64Array(heap, ptr, COMMAND_BUFFER_BYTES / 8);
+    this.viewBuffer = heap;
+  }
+}
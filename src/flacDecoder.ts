@@ -1,4 +1,6 @@
 // FLAC decoder interface using Web Audio API
+import { DecodeService } from './decodeService';
+
 export interface FlacDecoderResult {
   sampleRate: number;
   channels: number;
@@ -7,17 +9,18 @@ export interface FlacDecoderResult {
 }
 
 export class FlacDecoder {
-  private audioContext: AudioContext;
+  private sampleRate?: number;
 
-  constructor() {
-    this.audioContext = new AudioContext();
+  // Without a sample rate the track is decoded at its native rate (no resampling)
+  constructor(sampleRate?: number) {
+    this.sampleRate = sampleRate;
   }
 
   async decode(arrayBuffer: ArrayBuffer): Promise<FlacDecoderResult> {
     try {
-      // Use Web Audio API to decode FLAC
-      const audioBuffer = await this.audioContext.decodeAudioData(arrayBuffer);
-      
+      // Use Web Audio API to decode FLAC, on the shared decode context
+      const audioBuffer = await DecodeService.get().decode(arrayBuffer, this.sampleRate);
+
       const samples: Float32Array[] = [];
       for (let i = 0; i < audioBuffer.numberOfChannels; i++) {
         samples.push(audioBuffer.getChannelData(i));
@@ -35,22 +38,18 @@ export class FlacDecoder {
     }
   }
 
-  async createAudioBuffer(decodedData: FlacDecoderResult): Promise<AudioBuffer> {
-    const audioBuffer = this.audioContext.createBuffer(
-      decodedData.channels,
-      decodedData.samples[0].length,
-      decodedData.sampleRate
-    );
-
-    for (let i = 0; i < decodedData.channels; i++) {
-      const channelData = audioBuffer.getChannelData(i);
-      channelData.set(decodedData.samples[i]);
+  // Returns the decoded AudioBuffer itself, ready for an AudioBufferSourceNode. The channel
+  // data is never copied into a second buffer, so peak memory per load is one decoded track.
+  async decodeToAudioBuffer(arrayBuffer: ArrayBuffer): Promise<AudioBuffer> {
+    try {
+      return await DecodeService.get().decode(arrayBuffer, this.sampleRate);
+    } catch (error) {
+      console.error('Error decoding FLAC:', error);
+      throw new Error('Failed to decode FLAC file');
     }
-
-    return audioBuffer;
   }
 
-  getAudioContext(): AudioContext {
-    return this.audioContext;
+  getAudioContext(): BaseAudioContext {
+    return DecodeService.get().getContext(this.sampleRate);
   }
 }
@@ -0,0 +1,146 @@
+// Decides, once per animation frame, whether the visualizer should draw. Frames are only
+// worth drawing when something can change on screen: audio playing, a spectrum decaying
+// after a pause, or the user interacting. The rest are skipped or, with nothing to wait
+// for, the loop sleeps until woken.
+
+export type PaceDecision = 'render' | 'skip' | 'sleep';
+
+export interface PacingSnapshot {
+  // full: every display frame; capped: battery FPS cap; idle: silent spectrum, low rate;
+  // sleeping: paused and settled, loop stopped; hidden: tab not visible, loop stopped
+  pacing: 'full' | 'capped' | 'idle' | 'sleeping' | 'hidden';
+  renderedFrames: number;
+  skippedFrames: number;
+  // Display frames that got no GPU submit: skipped ticks plus frames slept through
+  submitsSaved: number;
+  fpsCap: number;
+}
+
+export interface FramePacerOptions {
+  batteryFpsCap?: number;
+  idleFps?: number;
+  // How long after the last change (pause, input, mode switch) frames keep coming at full rate
+  settleMs?: number;
+}
+
+const DEFAULT_FRAME_MS = 1000 / 60;
+
+// Any lit bin means there is something to draw; a playing spectrum has one within the first few
+function isSilent(bins: Uint8Array | null): boolean {
+  if (!bins) return true;
+  for (let i = 0; i < bins.length; i++) {
+    if (bins[i] !== 0) return false;
+  }
+  return true;
+}
+
+export class FramePacer {
+  private batteryFpsCap: number;
+  private idleFps: number;
+  private settleMs: number;
+
+  private visible: boolean = true;
+  private playing: boolean = false;
+  private onBattery: boolean = false;
+  private lastActivity: number = -Infinity;
+  private lastTick: number = 0;
+  private lastRender: number = 0;
+  private sleepStart: number = 0;
+  // Shortest tick gap seen, taken as the display's refresh interval
+  private frameInterval: number = Infinity;
+
+  private stats: PacingSnapshot = {
+    pacing: 'full',
+    renderedFrames: 0,
+    skippedFrames: 0,
+    submitsSaved: 0,
+    fpsCap: 0
+  };
+
+  constructor(options: FramePacerOptions = {}) {
+    this.batteryFpsCap = options.batteryFpsCap ?? 30;
+    this.idleFps = options.idleFps ?? 4;
+    this.settleMs = options.settleMs ?? 1500;
+  }
+
+  setVisible(visible: boolean): void {
+    this.visible = visible;
+  }
+
+  setPlaying(playing: boolean, now: number): void {
+    if (playing !== this.playing) this.poke(now);
+    this.playing = playing;
+  }
+
+  setOnBattery(onBattery: boolean): void {
+    this.onBattery = onBattery;
+  }
+
+  setBatteryFpsCap(fps: number): void {
+    this.batteryFpsCap = fps;
+  }
+
+  // Something changed that needs full-rate frames for a while (input, mode, new source)
+  poke(now: number): void {
+    this.lastActivity = now;
+  }
+
+  // The loop is restarting after a sleep; counts the display frames it slept through
+  wake(now: number): void {
+    if (this.sleepStart > 0) {
+      const interval = this.frameInterval === Infinity ? DEFAULT_FRAME_MS : this.frameInterval;
+      this.stats.submitsSaved += Math.floor((now - this.sleepStart) / interval);
+      this.sleepStart = 0;
+    }
+    this.lastTick = 0;
+  }
+
+  tick(timestamp: number, bins: Uint8Array | null): PaceDecision {
+    const s = this.stats;
+    if (this.lastTick > 0) {
+      const gap = timestamp - this.lastTick;
+      if (gap > 0 && gap < this.frameInterval) this.frameInterval = gap;
+    }
+    this.lastTick = timestamp;
+
+    const settling = timestamp - this.lastActivity < this.settleMs;
+    if (!this.visible || (!this.playing && !settling)) {
+      s.pacing = this.visible ? 'sleeping' : 'hidden';
+      this.sleepStart = timestamp;
+      return 'sleep';
+    }
+
+    let minGap = 0;
+    if (!settling && isSilent(bins)) {
+      s.pacing = 'idle';
+      minGap = 1000 / this.idleFps;
+    } else if (this.onBattery && this.batteryFpsCap > 0) {
+      s.pacing = 'capped';
+      minGap = 1000 / this.batteryFpsCap;
+    } else {
+      s.pacing = 'full';
+    }
+    s.fpsCap = minGap > 0 ? 1000 / minGap : 0;
+
+    // Half an interval of slack so a 30 FPS cap on a 60 Hz display lands on every other frame
+    const slack = (this.frameInterval === Infinity ? DEFAULT_FRAME_MS : this.frameInterval) / 2;
+    if (this.lastRender > 0 && timestamp - this.lastRender < minGap - slack) {
+      s.skippedFrames++;
+      s.submitsSaved++;
+      return 'skip';
+    }
+
+    this.lastRender = timestamp;
+    s.renderedFrames++;
+    return 'render';
+  }
+
+  // Estimated display refresh interval, for looking ahead to when a frame is shown
+  frameIntervalMs(): number {
+    return this.frameInterval === Infinity ? DEFAULT_FRAME_MS : this.frameInterval;
+  }
+
+  snapshot(): PacingSnapshot {
+    return { ...this.stats };
+  }
+}
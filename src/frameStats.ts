@@ -0,0 +1,92 @@
+// Per-frame timing for the visualizer's render loop. Recording a frame allocates nothing,
+// so the stats don't disturb what they measure.
+
+export interface FrameStatsSnapshot {
+  frames: number;
+  // CPU time spent inside render(), in ms
+  cpuFrameMs: number;
+  avgCpuFrameMs: number;
+  maxCpuFrameMs: number;
+  // Frames where the gap since the previous one was more than 1.5x the display interval
+  droppedFrames: number;
+  // Consecutive frames without an observed GC (JS heap size never went down).
+  // Only tracked where performance.memory exists (Chromium); -1 elsewhere.
+  gcFreeStreak: number;
+  longestGcFreeStreak: number;
+  gcEvents: number;
+  // Bytes written to GPU buffers by the last frame, and in total
+  uploadBytes: number;
+  totalUploadBytes: number;
+}
+
+const AVG_WEIGHT = 0.05;
+const DROP_FACTOR = 1.5;
+
+export class FrameStats {
+  private stats: FrameStatsSnapshot = {
+    frames: 0,
+    cpuFrameMs: 0,
+    avgCpuFrameMs: 0,
+    maxCpuFrameMs: 0,
+    droppedFrames: 0,
+    gcFreeStreak: 0,
+    longestGcFreeStreak: 0,
+    gcEvents: 0,
+    uploadBytes: 0,
+    totalUploadBytes: 0
+  };
+  private lastTimestamp: number = 0;
+  // Shortest frame gap seen so far, taken as the display's refresh interval
+  private frameInterval: number = Infinity;
+  private lastHeapSize: number = 0;
+  private memory: { usedJSHeapSize: number } | undefined;
+
+  constructor() {
+    this.memory = (performance as any).memory;
+    if (!this.memory) {
+      this.stats.gcFreeStreak = -1;
+      this.stats.longestGcFreeStreak = -1;
+    }
+  }
+
+  // `timestamp` is the requestAnimationFrame time, `cpuMs` the time the frame's work took
+  record(timestamp: number, cpuMs: number, uploadBytes: number = 0): void {
+    const s = this.stats;
+    s.frames++;
+    s.uploadBytes = uploadBytes;
+    s.totalUploadBytes += uploadBytes;
+    s.cpuFrameMs = cpuMs;
+    s.avgCpuFrameMs = s.frames === 1 ? cpuMs : s.avgCpuFrameMs + (cpuMs - s.avgCpuFrameMs) * AVG_WEIGHT;
+    if (cpuMs > s.maxCpuFrameMs) s.maxCpuFrameMs = cpuMs;
+
+    if (this.lastTimestamp > 0) {
+      const gap = timestamp - this.lastTimestamp;
+      if (gap > 0 && gap < this.frameInterval) this.frameInterval = gap;
+      if (gap > this.frameInterval * DROP_FACTOR) {
+        s.droppedFrames += Math.round(gap / this.frameInterval) - 1;
+      }
+    }
+    this.lastTimestamp = timestamp;
+
+    if (this.memory) {
+      const heap = this.memory.usedJSHeapSize;
+      if (heap < this.lastHeapSize) {
+        s.gcEvents++;
+        s.gcFreeStreak = 0;
+      } else {
+        s.gcFreeStreak++;
+        if (s.gcFreeStreak > s.longestGcFreeStreak) s.longestGcFreeStreak = s.gcFreeStreak;
+      }
+      this.lastHeapSize = heap;
+    }
+  }
+
+  // A gap after a pause (hidden tab, stopped loop) is not a dropped frame
+  resetTiming(): void {
+    this.lastTimestamp = 0;
+  }
+
+  snapshot(): FrameStatsSnapshot {
+    return { ...this.stats };
+  }
+}
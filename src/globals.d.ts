@@ -0,0 +1,23 @@
+// Compile-time constants injected by webpack's DefinePlugin (see webpack.config.js)
+declare const __SERVICE_WORKER_ENABLED__: boolean;
+
+// Player UI cost counters, for reading from the devtools console (see src/components/Player.tsx)
+interface Window {
+  __playerUiStats?: () => {
+    renders: number;
+    frames: number;
+    statusUpdates: number;
+    positionUpdates: number;
+    callbackMs: number;
+    waveformDrawMs: number;
+    waveformMaxDrawMs: number;
+    waveformDraws: number;
+    engineStartupMs: number;
+    engineWarmStart: boolean;
+    handoffs: number;
+    lastHandoffMs: number;
+    playbackSeconds: number;
+    rendersPerMinute: number;
+    callbackMsPerMinute: number;
+  };
+}
@@ -0,0 +1,94 @@
+// Accounting for the visualizer's GPU allocations. Every buffer and texture it creates goes
+// through here, so the live byte count shows whether anything leaks across source switches.
+
+export interface GpuResourceSnapshot {
+  // Adapter/device/pipeline setups; stays at 1 unless the device is lost
+  gpuInits: number;
+  gpuInitMs: number;
+  // Audio source rebinds on an existing device (output mode switches), and what they cost
+  sourceSwitches: number;
+  lastSwitchMs: number;
+  maxSwitchMs: number;
+  // Buffers and textures currently allocated, and their size. Texture sizes are estimates:
+  // 1 byte per texel for r8 formats, 4 for everything else.
+  gpuObjects: number;
+  gpuMemoryBytes: number;
+}
+
+function bytesPerTexel(format: GPUTextureFormat): number {
+  return format.startsWith('r8') ? 1 : 4;
+}
+
+function textureBytes(descriptor: GPUTextureDescriptor): number {
+  const size = descriptor.size as number[];
+  return (size[0] ?? 1) * (size[1] ?? 1) * (size[2] ?? 1) * bytesPerTexel(descriptor.format);
+}
+
+export class GpuResources {
+  private live = new Map<GPUBuffer | GPUTexture, number>();
+  private stats: GpuResourceSnapshot = {
+    gpuInits: 0,
+    gpuInitMs: 0,
+    sourceSwitches: 0,
+    lastSwitchMs: 0,
+    maxSwitchMs: 0,
+    gpuObjects: 0,
+    gpuMemoryBytes: 0
+  };
+
+  buffer(device: GPUDevice, descriptor: GPUBufferDescriptor): GPUBuffer {
+    const buffer = device.createBuffer(descriptor);
+    this.track(buffer, descriptor.size);
+    return buffer;
+  }
+
+  // `descriptor.size` must be given as an array
+  texture(device: GPUDevice, descriptor: GPUTextureDescriptor): GPUTexture {
+    const texture = device.createTexture(descriptor);
+    this.track(texture, textureBytes(descriptor));
+    return texture;
+  }
+
+  release(resource: GPUBuffer | GPUTexture | null): void {
+    if (!resource) return;
+    const bytes = this.live.get(resource);
+    if (bytes === undefined) return;
+    this.live.delete(resource);
+    this.stats.gpuObjects--;
+    this.stats.gpuMemoryBytes -= bytes;
+    resource.destroy();
+  }
+
+  releaseAll(): void {
+    this.live.forEach((_, resource) => resource.destroy());
+    this.forget();
+  }
+
+  // For a lost device: its resources are already gone
+  forget(): void {
+    this.live.clear();
+    this.stats.gpuObjects = 0;
+    this.stats.gpuMemoryBytes = 0;
+  }
+
+  recordInit(ms: number): void {
+    this.stats.gpuInits++;
+    this.stats.gpuInitMs = ms;
+  }
+
+  recordSwitch(ms: number): void {
+    this.stats.sourceSwitches++;
+    this.stats.lastSwitchMs = ms;
+    if (ms > this.stats.maxSwitchMs) this.stats.maxSwitchMs = ms;
+  }
+
+  snapshot(): GpuResourceSnapshot {
+    return { ...this.stats };
+  }
+
+  private track(resource: GPUBuffer | GPUTexture, bytes: number): void {
+    this.live.set(resource, bytes);
+    this.stats.gpuObjects++;
+    this.stats.gpuMemoryBytes += bytes;
+  }
+}
@@ -11,3 +11,13 @@ root.render(
     <App />
   </React.StrictMode>
 );
+
+// Precache the app shell and engine files so later visits start without the network.
+// Registered after load so the worker's own precache fetches don't compete with startup.
+if (__SERVICE_WORKER_ENABLED__ && 'serviceWorker' in navigator) {
+  window.addEventListener('load', () => {
+    navigator.serviceWorker.register('sw.js').catch((err) => {
+      console.warn('Service worker registration failed:', err);
+    });
+  });
+}
@@ -1,8 +1,17 @@
-// Minimal Math library for 3D WebGPU rendering
+// Minimal Math library for 3D WebGPU rendering.
+// The `*Into` / `set` variants write into an existing object so per-frame code can run
+// without allocating; the static constructors are kept for one-off setup code.
 
 export class Vec3 {
   constructor(public x: number, public y: number, public z: number) {}
 
+  set(x: number, y: number, z: number): Vec3 {
+    this.x = x;
+    this.y = y;
+    this.z = z;
+    return this;
+  }
+
   static normalize(v: Vec3): Vec3 {
     const len = Math.sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
     if (len === 0) return new Vec3(0, 0, 0);
@@ -44,36 +53,59 @@ export class Mat4 {
   }
 
   static perspective(fov: number, aspect: number, near: number, far: number): Mat4 {
-    const m = new Mat4();
+    return Mat4.perspectiveInto(new Mat4(), fov, aspect, near, far);
+  }
+
+  static perspectiveInto(out: Mat4, fov: number, aspect: number, near: number, far: number): Mat4 {
     const f = 1.0 / Math.tan(fov / 2);
     const nf = 1 / (near - far);
-
-    m.values[0] = f / aspect;
-    m.values[5] = f;
-    m.values[10] = (far + near) * nf;
-    m.values[11] = -1;
-    m.values[14] = (2 * far * near) * nf;
-    m.values[15] = 0;
-    return m;
+    const m = out.values;
+
+    m.fill(0);
+    m[0] = f / aspect;
+    m[5] = f;
+    m[10] = (far + near) * nf;
+    m[11] = -1;
+    m[14] = (2 * far * near) * nf;
+    return out;
   }
 
   static lookAt(eye: Vec3, center: Vec3, up: Vec3): Mat4 {
-    const z = Vec3.normalize(Vec3.subtract(eye, center));
-    const x = Vec3.normalize(Vec3.cross(up, z));
-    const y = Vec3.normalize(Vec3.cross(z, x));
+    return Mat4.lookAtInto(new Mat4(), eye, center, up);
+  }
 
-    const m = new Mat4();
-    m.values[0] = x.x; m.values[4] = x.y; m.values[8] = x.z;
-    m.values[1] = y.x; m.values[5] = y.y; m.values[9] = y.z;
-    m.values[2] = z.x; m.values[6] = z.y; m.values[10] = z.z;
-    m.values[12] = -Vec3.dot(x, eye);
-    m.values[13] = -Vec3.dot(y, eye);
-    m.values[14] = -Vec3.dot(z, eye);
-    return m;
+  // Same basis as Vec3.normalize/cross, computed in scalars
+  static lookAtInto(out: Mat4, eye: Vec3, center: Vec3, up: Vec3): Mat4 {
+    let zx = eye.x - center.x, zy = eye.y - center.y, zz = eye.z - center.z;
+    let len = Math.sqrt(zx * zx + zy * zy + zz * zz);
+    if (len > 0) { zx /= len; zy /= len; zz /= len; }
+
+    let xx = up.y * zz - up.z * zy, xy = up.z * zx - up.x * zz, xz = up.x * zy - up.y * zx;
+    len = Math.sqrt(xx * xx + xy * xy + xz * xz);
+    if (len > 0) { xx /= len; xy /= len; xz /= len; }
+
+    let yx = zy * xz - zz * xy, yy = zz * xx - zx * xz, yz = zx * xy - zy * xx;
+    len = Math.sqrt(yx * yx + yy * yy + yz * yz);
+    if (len > 0) { yx /= len; yy /= len; yz /= len; }
+
+    const m = out.values;
+    m[0] = xx; m[4] = xy; m[8] = xz;
+    m[1] = yx; m[5] = yy; m[9] = yz;
+    m[2] = zx; m[6] = zy; m[10] = zz;
+    m[3] = 0; m[7] = 0; m[11] = 0;
+    m[12] = -(xx * eye.x + xy * eye.y + xz * eye.z);
+    m[13] = -(yx * eye.x + yy * eye.y + yz * eye.z);
+    m[14] = -(zx * eye.x + zy * eye.y + zz * eye.z);
+    m[15] = 1;
+    return out;
   }
 
   static multiply(a: Mat4, b: Mat4): Mat4 {
-    const out = new Mat4();
+    return Mat4.multiplyInto(new Mat4(), a, b);
+  }
+
+  // `out` must not be `a` or `b`
+  static multiplyInto(out: Mat4, a: Mat4, b: Mat4): Mat4 {
     const ae = a.values;
     const be = b.values;
     const oe = out.values;
@@ -0,0 +1,119 @@
+// Main-thread client for the loader pipeline worker.
+// Falls back to running the same steps in-thread when workers are unavailable.
+import { AudioLoader, LoadedTrack } from './audioLoader';
+import { PipelineRequest, PipelineResponse, SharedHeapTarget, interleaveInto } from './workers/pipelineProtocol';
+
+type PendingRequest = {
+  resolve: (response: PipelineResponse) => void;
+  reject: (error: Error) => void;
+};
+
+// Distributes Omit over the request union so each variant keeps its own fields
+type DistributiveOmit<T, K extends keyof any> = T extends unknown ? Omit<T, K> : never;
+type RequestBody = DistributiveOmit<PipelineRequest, 'id'>;
+
+export class PipelineClient {
+  private static instance: PipelineClient | null = null;
+
+  private worker: Worker | null = null;
+  private nextId: number = 1;
+  private pending = new Map<number, PendingRequest>();
+
+  static get(): PipelineClient {
+    if (!PipelineClient.instance) {
+      PipelineClient.instance = new PipelineClient();
+    }
+    return PipelineClient.instance;
+  }
+
+  private constructor() {
+    try {
+      this.worker = new Worker(new URL('./workers/pipeline.worker.ts', import.meta.url));
+      this.worker.onmessage = (e: MessageEvent<PipelineResponse>) => this.handleResponse(e.data);
+      this.worker.onerror = (e) => {
+        console.error('Pipeline worker failed; continuing on the main thread:', e.message);
+        this.failAll(new Error(e.message || 'Pipeline worker failed'));
+        this.worker?.terminate();
+        this.worker = null;
+      };
+    } catch (err) {
+      console.warn('Pipeline worker unavailable; loading on the main thread:', err);
+      this.worker = null;
+    }
+  }
+
+  // The audio plus the scanner's index next to it, when one exists
+  async loadTrack(url: string): Promise<LoadedTrack> {
+    if (!this.worker) {
+      return new AudioLoader().loadTrack(url);
+    }
+    const response = await this.request({ type: 'fetch', url });
+    if (response.type !== 'fetched') throw new Error(`Unexpected pipeline response: ${response.type}`);
+    return { audio: response.buffer, index: response.index };
+  }
+
+  // Interleaves planar channels. The channel buffers are transferred to the worker, so the
+  // caller must not touch them afterwards. With a shared heap target the samples are written
+  // in place and null is returned; otherwise a new interleaved array comes back.
+  async interleave(channels: Float32Array[], target: SharedHeapTarget | null): Promise<Float32Array | null> {
+    const frames = channels.length > 0 ? channels[0].length : 0;
+    const length = frames * channels.length;
+
+    if (!this.worker) {
+      const destination = target
+        ? new Float32Array(target.memory, target.byteOffset, length)
+        : new Float32Array(length);
+      interleaveInto(channels, destination);
+      return target ? null : destination;
+    }
+
+    // Several channels may be views over one buffer; each buffer can only be transferred once
+    const transfer = Array.from(new Set(channels.map(ch => ch.buffer as ArrayBuffer)));
+    let response: PipelineResponse;
+    try {
+      response = await this.request({ type: 'interleave', channels, target }, transfer);
+    } catch (err) {
+      if (err instanceof DOMException && err.name === 'DataCloneError') {
+        // Some engines refuse to detach AudioBuffer storage; copy instead of transferring
+        response = await this.request({ type: 'interleave', channels, target });
+      } else {
+        throw err;
+      }
+    }
+
+    if (response.type !== 'interleaved') throw new Error(`Unexpected pipeline response: ${response.type}`);
+    return response.buffer ? new Float32Array(response.buffer, 0, response.length) : null;
+  }
+
+  private request(body: RequestBody, transfer: Transferable[] = []): Promise<PipelineResponse> {
+    const id = this.nextId++;
+    const message = { ...body, id } as PipelineRequest;
+
+    return new Promise<PipelineResponse>((resolve, reject) => {
+      this.pending.set(id, { resolve, reject });
+      try {
+        this.worker!.postMessage(message, transfer);
+      } catch (err) {
+        this.pending.delete(id);
+        reject(err);
+      }
+    });
+  }
+
+  private handleResponse(response: PipelineResponse): void {
+    const pending = this.pending.get(response.id);
+    if (!pending) return;
+    this.pending.delete(response.id);
+
+    if (response.type === 'error') {
+      pending.reject(new Error(response.message));
+    } else {
+      pending.resolve(response);
+    }
+  }
+
+  private failAll(error: Error): void {
+    this.pending.forEach(p => p.reject(error));
+    this.pending.clear();
+  }
+}
@@ -0,0 +1,142 @@
+// Fixed-layout player status block. The SDL engine publishes it from WASM memory and
+// AudioPlayer keeps a JS-side copy; the UI reads either one once per animation frame.
+// Layout must match EngineStatus in src/sdl/audio_engine.cpp:
+//   u32 seq | u32 flags | f64 position | f64 duration | f64 bufferedAhead |
+//   f64 clockTime | f64 outputLatency
+import { PlayerState } from './audioPlayer';
+
+export const STATE_BLOCK_BYTES = 48;
+
+export const STATE_FLAG_PLAYING = 1 << 0;
+export const STATE_FLAG_LOADING = 1 << 1;
+
+// Int32 / Float64 element indices within the block
+const SEQ = 0;
+const FLAGS = 1;
+const POSITION = 1;
+const DURATION = 2;
+const BUFFERED_AHEAD = 3;
+const CLOCK_TIME = 4;
+const OUTPUT_LATENCY = 5;
+
+const MAX_READ_ATTEMPTS = 4;
+
+export interface PlayerStateSnapshot extends PlayerState {
+  bufferedAhead: number;
+  // Audio clock: `currentTime` was the output position at `clockTime` (clockNow() timebase),
+  // and is heard `outputLatency` seconds later
+  clockTime: number;
+  outputLatency: number;
+  seq: number;
+}
+
+export function createSnapshot(): PlayerStateSnapshot {
+  return {
+    isPlaying: false, currentTime: 0, duration: 0, isLoading: false,
+    bufferedAhead: 0, clockTime: 0, outputLatency: 0, seq: 0
+  };
+}
+
+// Milliseconds on a timebase every thread agrees on (performance.now() is per-thread)
+export function clockNow(): number {
+  return performance.timeOrigin + performance.now();
+}
+
+// Seconds from a frame leaving the Web Audio graph to it being heard. outputLatency is
+// missing in some browsers; baseLatency alone is then the best available figure.
+export function outputLatencyOf(context: BaseAudioContext): number {
+  const ctx = context as AudioContext;
+  return (ctx.baseLatency || 0) + (ctx.outputLatency || 0);
+}
+
+// Where a state block lives, so another reader (the visualizer, maybe in a worker) can map it
+export interface StateBlockLocation {
+  buffer: ArrayBufferLike;
+  byteOffset: number;
+}
+
+// Anything the UI can pull player status from without a callback
+export interface PlayerStateSource {
+  // Copies the latest published state into `out` and returns its sequence number.
+  // The sequence only changes when one of the values changed.
+  readState(out: PlayerStateSnapshot): number;
+  stateBlockLocation(): StateBlockLocation | null;
+}
+
+export class StateBlockView {
+  readonly buffer: ArrayBufferLike;
+  readonly byteOffset: number;
+  private ints: Int32Array;
+  private floats: Float64Array;
+
+  constructor(buffer: ArrayBufferLike, byteOffset: number = 0) {
+    this.buffer = buffer;
+    this.byteOffset = byteOffset;
+    this.ints = new Int32Array(buffer, byteOffset, STATE_BLOCK_BYTES / 4);
+    this.floats = new Float64Array(buffer, byteOffset, STATE_BLOCK_BYTES / 8);
+  }
+
+  sequence(): number {
+    return Atomics.load(this.ints, SEQ) >>> 0;
+  }
+
+  // Seqlock read: retries while a write is in flight (odd seq) or raced with this read.
+  // On persistent contention the previous snapshot is left untouched.
+  read(out: PlayerStateSnapshot): number {
+    for (let attempt = 0; attempt < MAX_READ_ATTEMPTS; attempt++) {
+      const before = Atomics.load(this.ints, SEQ) >>> 0;
+      if (before & 1) continue;
+
+      const flags = this.ints[FLAGS];
+      const position = this.floats[POSITION];
+      const duration = this.floats[DURATION];
+      const bufferedAhead = this.floats[BUFFERED_AHEAD];
+      const clockTime = this.floats[CLOCK_TIME];
+      const outputLatency = this.floats[OUTPUT_LATENCY];
+
+      if ((Atomics.load(this.ints, SEQ) >>> 0) !== before) continue;
+
+      out.isPlaying = (flags & STATE_FLAG_PLAYING) !== 0;
+      out.isLoading = (flags & STATE_FLAG_LOADING) !== 0;
+      out.currentTime = position;
+      out.duration = duration;
+      out.bufferedAhead = bufferedAhead;
+      out.clockTime = clockTime;
+      out.outputLatency = outputLatency;
+      out.seq = before;
+      return before;
+    }
+    return out.seq;
+  }
+
+  // Single-writer publish for JS-side players; only bumps seq when something changed.
+  // The clock is stamped with the position, as the engine does.
+  write(state: PlayerState, bufferedAhead: number, outputLatency: number): void {
+    const flags = (state.isPlaying ? STATE_FLAG_PLAYING : 0) | (state.isLoading ? STATE_FLAG_LOADING : 0);
+    const clockChanged = flags !== this.ints[FLAGS] || state.currentTime !== this.floats[POSITION];
+    if (!clockChanged &&
+        state.duration === this.floats[DURATION] &&
+        bufferedAhead === this.floats[BUFFERED_AHEAD] &&
+        outputLatency === this.floats[OUTPUT_LATENCY]) {
+      return;
+    }
+
+    const seq = Atomics.load(this.ints, SEQ);
+    Atomics.store(this.ints, SEQ, seq + 1);
+    this.ints[FLAGS] = flags;
+    this.floats[POSITION] = state.currentTime;
+    this.floats[DURATION] = state.duration;
+    this.floats[BUFFERED_AHEAD] = bufferedAhead;
+    if (clockChanged) this.floats[CLOCK_TIME] = clockNow();
+    this.floats[OUTPUT_LATENCY] = outputLatency;
+    Atomics.store(this.ints, SEQ, seq + 2);
+  }
+}
+
+// Backing store for JS-side blocks; shared when cross-origin isolated so a worker could read it too
+export function allocateStateBlock(): StateBlockView {
+  const buffer = typeof SharedArrayBuffer !== 'undefined' && (globalThis as any).crossOriginIsolated
+    ? new SharedArrayBuffer(STATE_BLOCK_BYTES)
+    : new ArrayBuffer(STATE_BLOCK_BYTES);
+  return new StateBlockView(buffer);
+}
@@ -0,0 +1,211 @@
+#include "analysis.h"
+
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr float kPi = 3.14159265358979f;
+constexpr float kSmoothing = 0.8f;
+constexpr float kMinDecibels = -100.0f;
+constexpr float kMaxDecibels = -30.0f;
+// The scope only re-arms after the signal dips this far below zero, so noise around a
+// crossing doesn't make the trigger jump
+constexpr float kTriggerHysteresis = 0.01f;
+
+unsigned reverse_bits(unsigned value, int bits) {
+    unsigned result = 0;
+    for (int i = 0; i < bits; ++i) {
+        result = (result << 1) | (value & 1u);
+        value >>= 1;
+    }
+    return result;
+}
+
+// Left and right channels of the four frames starting at `frame`, zero before the track
+void load_frames(const float* interleaved, int channels, long frame, f32x4& left, f32x4& right) {
+    if (frame >= 0 && channels == 2) {
+        const float* src = interleaved + (size_t)frame * 2;
+        f32x4 a = load4(src);
+        f32x4 b = load4(src + 4);
+        left = __builtin_shufflevector(a, b, 0, 2, 4, 6);
+        right = __builtin_shufflevector(a, b, 1, 3, 5, 7);
+        return;
+    }
+    if (frame >= 0 && channels == 1) {
+        left = right = load4(interleaved + frame);
+        return;
+    }
+    for (int i = 0; i < 4; ++i) {
+        long f = frame + i;
+        if (f < 0) {
+            left[i] = right[i] = 0.0f;
+            continue;
+        }
+        const float* src = interleaved + (size_t)f * channels;
+        left[i] = src[0];
+        right[i] = src[channels > 1 ? 1 : 0];
+    }
+}
+
+} // namespace
+
+SpectrumAnalyzer::SpectrumAnalyzer(float smoothing)
+    : smoothing_(smoothing),
+      window_(SPECTRUM_FFT_SIZE),
+      twiddles_(SPECTRUM_FFT_SIZE / 2),
+      buffer_(SPECTRUM_FFT_SIZE),
+      smoothed_(SPECTRUM_BINS, 0.0f),
+      scratchBins_(SPECTRUM_BINS, 0) {
+    // Blackman window, as specified for AnalyserNode
+    const float a0 = 0.42f, a1 = 0.5f, a2 = 0.08f;
+    for (int i = 0; i < SPECTRUM_FFT_SIZE; ++i) {
+        float x = (float)i / SPECTRUM_FFT_SIZE;
+        window_[i] = a0 - a1 * std::cos(2.0f * kPi * x) + a2 * std::cos(4.0f * kPi * x);
+    }
+    for (int i = 0; i < SPECTRUM_FFT_SIZE / 2; ++i) {
+        float angle = -2.0f * kPi * i / SPECTRUM_FFT_SIZE;
+        twiddles_[i] = std::complex<float>(std::cos(angle), std::sin(angle));
+    }
+    block_.binCount = SPECTRUM_BINS;
+}
+
+void SpectrumAnalyzer::update(const float* interleaved, size_t frames, int channels, size_t endFrame) {
+    if (!interleaved || channels <= 0) return;
+
+    // Window of the most recent frames, zero-padded before the start of the track
+    const int bits = 11; // log2(SPECTRUM_FFT_SIZE)
+    const float channelScale = 1.0f / channels;
+    if (endFrame > frames) endFrame = frames;
+    for (int i = 0; i < SPECTRUM_FFT_SIZE; ++i) {
+        long frame = (long)endFrame - SPECTRUM_FFT_SIZE + i;
+        float sample = 0.0f;
+        if (frame >= 0) {
+            const float* src = interleaved + (size_t)frame * channels;
+            for (int ch = 0; ch < channels; ++ch) sample += src[ch];
+            sample *= channelScale;
+        }
+        buffer_[reverse_bits((unsigned)i, bits)] = std::complex<float>(sample * window_[i], 0.0f);
+    }
+
+    // Iterative radix-2 FFT
+    for (int size = 2; size <= SPECTRUM_FFT_SIZE; size <<= 1) {
+        int half = size >> 1;
+        int step = SPECTRUM_FFT_SIZE / size;
+        for (int start = 0; start < SPECTRUM_FFT_SIZE; start += size) {
+            for (int k = 0; k < half; ++k) {
+                std::complex<float> t = twiddles_[k * step] * buffer_[start + k + half];
+                buffer_[start + k + half] = buffer_[start + k] - t;
+                buffer_[start + k] += t;
+            }
+        }
+    }
+
+    // Smoothed magnitude -> dB -> byte, the AnalyserNode pipeline
+    const float scale = 1.0f / SPECTRUM_FFT_SIZE;
+    const float rangeScale = 255.0f / (kMaxDecibels - kMinDecibels);
+    unsigned sum = 0;
+    for (int k = 0; k < SPECTRUM_BINS; ++k) {
+        float magnitude = std::abs(buffer_[k]) * scale;
+        smoothed_[k] = smoothing_ * smoothed_[k] + (1.0f - smoothing_) * magnitude;
+        float db = smoothed_[k] > 0.0f ? 20.0f * std::log10(smoothed_[k]) : kMinDecibels;
+        float scaled = (db - kMinDecibels) * rangeScale;
+        uint8_t value = (uint8_t)std::clamp(scaled, 0.0f, 255.0f);
+        scratchBins_[k] = value;
+        sum += value;
+    }
+
+    publish((float)sum / (SPECTRUM_BINS * 255.0f));
+}
+
+void SpectrumAnalyzer::reset() {
+    std::fill(smoothed_.begin(), smoothed_.end(), 0.0f);
+    std::fill(scratchBins_.begin(), scratchBins_.end(), 0);
+    publish(0.0f);
+}
+
+void SpectrumAnalyzer::publish(float level) {
+    uint32_t seq = block_.seq.load(std::memory_order_relaxed);
+    block_.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(block_.bins, scratchBins_.data(), SPECTRUM_BINS);
+    block_.level = level;
+    block_.seq.store(seq + 2, std::memory_order_release);
+}
+
+StereoAnalyzer::StereoAnalyzer()
+    : mono_(STEREO_WINDOW, 0.0f),
+      points_(STEREO_POINTS * 2, 0.0f) {
+    block_.pointCount = STEREO_POINTS;
+    block_.scopeSamples = SCOPE_SAMPLES;
+}
+
+void StereoAnalyzer::update(const float* interleaved, size_t frames, int channels, size_t endFrame) {
+    if (!interleaved || channels <= 0) return;
+    static_assert(STEREO_DECIMATION == 4, "one point per four-frame vector");
+
+    // One pass in four-frame vectors: energy and cross sums, the mono downmix for the
+    // scope, and the first frame of each vector as a mid/side point
+    if (endFrame > frames) endFrame = frames;
+    const long start = (long)endFrame - STEREO_WINDOW;
+    f32x4 energyLeft = {};
+    f32x4 energyRight = {};
+    f32x4 cross = {};
+    for (int p = 0; p < STEREO_POINTS; ++p) {
+        f32x4 left, right;
+        load_frames(interleaved, channels, start + (long)p * 4, left, right);
+        energyLeft += left * left;
+        energyRight += right * right;
+        cross += left * right;
+        f32x4 mid = (left + right) * 0.5f;
+        f32x4 side = (left - right) * 0.5f;
+        store4(&mono_[p * 4], mid);
+        points_[p * 2] = side[0];
+        points_[p * 2 + 1] = mid[0];
+    }
+
+    const float k = kSmoothing;
+    energyLeft_ = k * energyLeft_ + (1.0f - k) * sum4(energyLeft);
+    energyRight_ = k * energyRight_ + (1.0f - k) * sum4(energyRight);
+    cross_ = k * cross_ + (1.0f - k) * sum4(cross);
+    float energy = energyLeft_ * energyRight_;
+    correlation_ = energy > 1e-12f ? std::clamp(cross_ / std::sqrt(energy), -1.0f, 1.0f) : 0.0f;
+
+    // Last rising zero crossing that still has a full scope window after it; without one
+    // the scope free-runs on the newest samples
+    const size_t latest = STEREO_WINDOW - SCOPE_SAMPLES;
+    size_t trigger = latest;
+    bool armed = false;
+    for (size_t i = 0; i <= latest; ++i) {
+        float sample = mono_[i];
+        if (sample < -kTriggerHysteresis) {
+            armed = true;
+        } else if (armed && sample >= 0.0f) {
+            trigger = i;
+            armed = false;
+        }
+    }
+
+    publish(trigger);
+}
+
+void StereoAnalyzer::reset() {
+    energyLeft_ = energyRight_ = cross_ = 0.0f;
+    std::fill(mono_.begin(), mono_.end(), 0.0f);
+    std::fill(points_.begin(), points_.end(), 0.0f);
+    correlation_ = 0.0f;
+    publish(0);
+}
+
+void StereoAnalyzer::publish(size_t trigger) {
+    uint32_t seq = block_.seq.load(std::memory_order_relaxed);
+    block_.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(block_.points, points_.data(), sizeof(block_.points));
+    std::memcpy(block_.scope, mono_.data() + trigger, sizeof(block_.scope));
+    block_.correlation = correlation_;
+    block_.seq.store(seq + 2, std::memory_order_release);
+}
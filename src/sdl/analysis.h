@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Spectrum analysis for the SDL engine. Results are published in a fixed-layout block in
+// WASM memory that the visualizer reads directly (see src/spectrumSource.ts), so SDL mode
+// gets the same visuals as Web Audio mode without an AnalyserNode.
+//
+// Output matches AnalyserNode.getByteFrequencyData with its defaults: Blackman window,
+// smoothingTimeConstant 0.8, minDecibels -100, maxDecibels -30.
+
+constexpr int SPECTRUM_FFT_SIZE = 2048;
+constexpr int SPECTRUM_BINS = SPECTRUM_FFT_SIZE / 2;
+
+// Layout mirrors src/spectrumSource.ts:
+//   u32 seq | u32 binCount | f32 level | u32 reserved | u8 bins[SPECTRUM_BINS]
+// `seq` is a seqlock like EngineStatus; readers that only draw may skip the check.
+struct SpectrumBlock {
+    std::atomic<uint32_t> seq;
+    uint32_t binCount;
+    float level; // mean of bins / 255 (the visualizer reduces bins itself on the GPU)
+    uint32_t reserved;
+    uint8_t bins[SPECTRUM_BINS];
+};
+static_assert(sizeof(SpectrumBlock) == 16 + SPECTRUM_BINS, "SpectrumBlock layout is shared with JS");
+
+class SpectrumAnalyzer {
+public:
+    // `smoothing` is AnalyserNode's smoothingTimeConstant; one-off analyses (the scanner's
+    // thumbnails) pass 0 so a single update shows the window as it is
+    explicit SpectrumAnalyzer(float smoothing = 0.8f);
+
+    // Analyses the SPECTRUM_FFT_SIZE frames ending at `endFrame` of an interleaved track
+    // (downmixed to mono) and publishes the result.
+    void update(const float* interleaved, size_t frames, int channels, size_t endFrame);
+
+    // Publishes silence and forgets the smoothing history (pause, stop, new track)
+    void reset();
+
+    SpectrumBlock* block() { return &block_; }
+
+private:
+    void publish(float level);
+
+    SpectrumBlock block_ = {};
+    float smoothing_;
+    std::vector<float> window_;
+    std::vector<std::complex<float>> twiddles_;
+    std::vector<std::complex<float>> buffer_;
+    std::vector<float> smoothed_;
+    std::vector<uint8_t> scratchBins_;
+};
+
+// Stereo-field analysis for mastering views, computed over the same window as the spectrum:
+// a running L/R correlation, a mid/side point cloud (one point per STEREO_DECIMATION frames)
+// and an oscilloscope window that starts on a rising zero crossing, so periodic signals
+// stand still. The arrays are drawn as-is by the visualizer (see src/stereoSource.ts).
+
+constexpr int STEREO_WINDOW = SPECTRUM_FFT_SIZE;
+constexpr int STEREO_DECIMATION = 4;
+constexpr int STEREO_POINTS = STEREO_WINDOW / STEREO_DECIMATION;
+constexpr int SCOPE_SAMPLES = STEREO_WINDOW / 2;
+
+// Layout mirrors src/stereoSource.ts:
+//   u32 seq | u32 pointCount | u32 scopeSamples | f32 correlation |
+//   f32 points[STEREO_POINTS][2] (side, mid), oldest first | f32 scope[SCOPE_SAMPLES] (mono)
+struct StereoBlock {
+    std::atomic<uint32_t> seq;
+    uint32_t pointCount;
+    uint32_t scopeSamples;
+    float correlation; // -1 (out of phase) .. 1 (mono), smoothed like the spectrum
+    float points[STEREO_POINTS * 2];
+    float scope[SCOPE_SAMPLES];
+};
+static_assert(sizeof(StereoBlock) == 16 + 8 * STEREO_POINTS + 4 * SCOPE_SAMPLES,
+              "StereoBlock layout is shared with JS");
+
+class StereoAnalyzer {
+public:
+    StereoAnalyzer();
+
+    // Analyses the STEREO_WINDOW frames ending at `endFrame`. Mono tracks read as
+    // fully correlated; beyond two channels only the first two are used.
+    void update(const float* interleaved, size_t frames, int channels, size_t endFrame);
+
+    // Publishes silence and forgets the correlation history
+    void reset();
+
+    StereoBlock* block() { return &block_; }
+
+private:
+    void publish(size_t trigger);
+
+    StereoBlock block_ = {};
+    std::vector<float> mono_;
+    std::vector<float> points_;
+    // Smoothed energy and cross terms the correlation is taken from
+    float energyLeft_ = 0.0f;
+    float energyRight_ = 0.0f;
+    float cross_ = 0.0f;
+    float correlation_ = 0.0f;
+};
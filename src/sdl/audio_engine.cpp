@@ -3,6 +3,14 @@
 #include <vector>
 #include <iostream>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+
+#include "analysis.h"
+#include "kernels.h"
+#include "waveform.h"
 
 // Define exports to ensure they are available to JS
 #ifdef __cplusplus
@@ -12,7 +20,10 @@ extern "C" {
 // Global state
 struct PlayerState {
     SDL_AudioStream* stream = nullptr;
-    std::vector<float> audioBuffer;
+    // Interleaved track samples. Always allocated with malloc() so a buffer filled on the
+    // JS side can be adopted without another full-track copy (see adopt_audio_data).
+    float* samples = nullptr;
+    size_t sampleCount = 0;
     bool isPlaying = false;
     float volume = 1.0f;
     int sampleRate = 44100;
@@ -23,9 +34,55 @@ struct PlayerState {
     // To implement "Play/Pause/Seek" accurately with a large buffer:
     // We will clear the stream and push data from the current offset.
     size_t playHead = 0; // Index in float samples
+    size_t pushedUntil = 0; // End (exclusive) of the samples handed to the stream since the last seek
     SDL_AudioDeviceID deviceId = 0;
+    bool isLoading = false;
 } g_state;
 
+// Status block the UI reads straight out of WASM memory on requestAnimationFrame
+// (layout mirrors src/playerStateBlock.ts). `seq` is a seqlock: odd while a write is in
+// progress, and it only advances when a published value actually changed.
+enum EngineStatusFlags : uint32_t {
+    STATUS_PLAYING = 1u << 0,
+    STATUS_LOADING = 1u << 1,
+};
+
+struct EngineStatus {
+    std::atomic<uint32_t> seq;
+    uint32_t flags;
+    double position;      // seconds
+    double duration;      // seconds
+    double bufferedAhead; // seconds queued in the SDL stream, not yet handed to the device
+    double clockTime;     // when `position` was sampled: performance.timeOrigin + now(), in ms
+    double outputLatency; // seconds between the device taking a frame and it being heard
+};
+static_assert(sizeof(EngineStatus) == 48, "EngineStatus layout is shared with JS");
+
+static EngineStatus g_status = {};
+// Device buffer size in seconds, queried once the device is open
+static double g_deviceLatency = 0.0;
+
+// Epoch-based so readers on other threads (the visualizer worker) share the timebase
+EM_JS(double, engine_clock_now, (), {
+    return performance.timeOrigin + performance.now();
+});
+static SpectrumAnalyzer g_spectrum;
+static StereoAnalyzer g_stereo;
+static WaveformPyramid g_waveform;
+// Serializes the main thread and the stream callback, the two possible writers
+static std::atomic_flag g_statusWriteLock = ATOMIC_FLAG_INIT;
+// Same for the analyzers: the callback updates them while the main thread may reset them
+// (load, pause, stop, detach), and neither update() nor reset() may run over the other
+static std::atomic_flag g_analysisLock = ATOMIC_FLAG_INIT;
+
+// Publishes silence from both analyzers and drops their history
+static void reset_analysis() {
+    while (g_analysisLock.test_and_set(std::memory_order_acquire)) {}
+    g_spectrum.reset();
+    g_stereo.reset();
+    g_analysisLock.clear(std::memory_order_release);
+}
+
 EMSCRIPTEN_KEEPALIVE
 int init_audio() {
     // SDL3 returns bool (true on success)
@@ -41,11 +98,34 @@ int init_audio() {
         return 0;
     }
 
+    // Frames handed to the device are heard one device buffer later
+    SDL_AudioSpec deviceSpec;
+    int deviceFrames = 0;
+    if (SDL_GetAudioDeviceFormat(g_state.deviceId, &deviceSpec, &deviceFrames) && deviceSpec.freq > 0) {
+        g_deviceLatency = (double)deviceFrames / deviceSpec.freq;
+    }
+
     return 1;
 }
 
+static void release_audio_data() {
+    std::free(g_state.samples);
+    g_state.samples = nullptr;
+    g_state.sampleCount = 0;
+}
+
+static bool has_audio_data() {
+    return g_state.samples != nullptr && g_state.sampleCount > 0;
+}
+
+static void publish_status();
+static void on_stream_get(void*, SDL_AudioStream*, int, int);
+
+// Takes ownership of `data`, which must come from malloc() (JS: Module._malloc).
+// The loader worker interleaves straight into that allocation, so the track is never
+// copied on the main thread. The buffer is freed on the next load or in cleanup().
 EMSCRIPTEN_KEEPALIVE
-void set_audio_data(float* data, int length, int channels, int sampleRate) {
+void adopt_audio_data(float* data, int length, int channels, int sampleRate) {
     // Stop current playback
     if (g_state.stream) {
         SDL_DestroyAudioStream(g_state.stream);
@@ -53,11 +133,16 @@ void set_audio_data(float* data, int length, int channels, int sampleRate) {
     }
 
     // Update state
-    g_state.audioBuffer.assign(data, data + length);
+    if (g_state.samples != data) release_audio_data();
+    g_state.samples = data;
+    g_state.sampleCount = length > 0 ? (size_t)length : 0;
     g_state.channels = channels;
     g_state.sampleRate = sampleRate;
     g_state.playHead = 0;
+    g_state.pushedUntil = 0;
     g_state.isPlaying = false;
+    reset_analysis();
+    g_waveform.reset();
 
     // Create a new stream matching the audio format
     SDL_AudioSpec spec;
@@ -71,15 +156,33 @@ void set_audio_data(float* data, int length, int channels, int sampleRate) {
         return;
     }
 
+    // Publish position from the device's pull callback instead of having JS poll for it
+    SDL_SetAudioStreamGetCallback(g_state.stream, on_stream_get, nullptr);
+
     // Bind stream to device (SDL3 returns bool)
     if (!SDL_BindAudioStream(g_state.deviceId, g_state.stream)) {
         std::cerr << "SDL_BindAudioStream failed: " << SDL_GetError() << std::endl;
     }
+
+    publish_status();
+}
+
+// Copying variant used by the ccall fallback, where `data` lives in a temporary stack copy.
+EMSCRIPTEN_KEEPALIVE
+void set_audio_data(float* data, int length, int channels, int sampleRate) {
+    size_t bytes = (length > 0 ? (size_t)length : 0) * sizeof(float);
+    float* copy = (float*)std::malloc(bytes ? bytes : sizeof(float));
+    if (!copy) {
+        std::cerr << "set_audio_data: out of memory (" << bytes << " bytes)" << std::endl;
+        return;
+    }
+    if (bytes) std::memcpy(copy, data, bytes);
+    adopt_audio_data(copy, length, channels, sampleRate);
 }
 
 EMSCRIPTEN_KEEPALIVE
 void play() {
-    if (!g_state.stream || g_state.audioBuffer.empty()) return;
+    if (!g_state.stream || !has_audio_data()) return;
 
     if (g_state.isPlaying) return;
 
@@ -90,11 +193,14 @@ void play() {
     // How to check if stream is empty? SDL_GetAudioStreamAvailable(stream) (returns bytes queued)
 
     int queued = SDL_GetAudioStreamAvailable(g_state.stream);
-    if (queued == 0 && g_state.playHead < g_state.audioBuffer.size()) {
+    if (queued == 0 && g_state.playHead < g_state.sampleCount) {
         // Push all remaining data
-        size_t samplesRemaining = g_state.audioBuffer.size() - g_state.playHead;
-        SDL_PutAudioStreamData(g_state.stream, &g_state.audioBuffer[g_state.playHead], samplesRemaining * sizeof(float));
+        size_t samplesRemaining = g_state.sampleCount - g_state.playHead;
+        SDL_PutAudioStreamData(g_state.stream, g_state.samples + g_state.playHead, samplesRemaining * sizeof(float));
+        g_state.pushedUntil = g_state.sampleCount;
     }
+
+    publish_status();
 }
 
 EMSCRIPTEN_KEEPALIVE
@@ -103,6 +209,8 @@ void pause_audio() {
 
     g_state.isPlaying = false;
     SDL_PauseAudioDevice(g_state.deviceId);
+    reset_analysis();
+    publish_status();
 }
 
 EMSCRIPTEN_KEEPALIVE
@@ -110,6 +218,7 @@ void resume_audio() {
     if (g_state.isPlaying) return;
     g_state.isPlaying = true;
     SDL_ResumeAudioDevice(g_state.deviceId);
+    publish_status();
 }
 
 EMSCRIPTEN_KEEPALIVE
@@ -119,41 +228,54 @@ void stop() {
     SDL_ClearAudioStream(g_state.stream);
     g_state.isPlaying = false;
     g_state.playHead = 0;
+    g_state.pushedUntil = 0;
+    reset_analysis();
+    publish_status();
 }
 
-EMSCRIPTEN_KEEPALIVE
-void seek(float time) {
-    if (!g_state.stream || g_state.audioBuffer.empty()) return;
-
-    // Calculate sample index
-    size_t sampleIndex = (size_t)(time * g_state.sampleRate) * g_state.channels;
-
+static void seek_to_sample(size_t sampleIndex) {
     // Align to channels
     sampleIndex = sampleIndex - (sampleIndex % g_state.channels);
 
-    if (sampleIndex >= g_state.audioBuffer.size()) {
-        sampleIndex = g_state.audioBuffer.size();
+    if (sampleIndex >= g_state.sampleCount) {
+        sampleIndex = g_state.sampleCount;
     }
 
     g_state.playHead = sampleIndex;
+    g_state.pushedUntil = sampleIndex;
 
     // Clear existing data in stream
     SDL_ClearAudioStream(g_state.stream);
 
     // If we are currently playing, push new data immediately
     if (g_state.isPlaying) {
-        size_t samplesRemaining = g_state.audioBuffer.size() - g_state.playHead;
+        size_t samplesRemaining = g_state.sampleCount - g_state.playHead;
         if (samplesRemaining > 0) {
-            SDL_PutAudioStreamData(g_state.stream, &g_state.audioBuffer[g_state.playHead], samplesRemaining * sizeof(float));
+            SDL_PutAudioStreamData(g_state.stream, g_state.samples + g_state.playHead, samplesRemaining * sizeof(float));
+            g_state.pushedUntil = g_state.sampleCount;
         }
     }
+
+    publish_status();
 }
 
 EMSCRIPTEN_KEEPALIVE
-float get_current_time() {
-    if (!g_state.stream) return 0.0f;
+void seek(float time) {
+    if (!g_state.stream || !has_audio_data()) return;
+    seek_to_sample((size_t)(time * g_state.sampleRate) * g_state.channels);
+}
+
+// Sample-exact variant used when a track is handed over from another output mode
+EMSCRIPTEN_KEEPALIVE
+void seek_frame(int frame) {
+    if (!g_state.stream || !has_audio_data()) return;
+    seek_to_sample((size_t)(frame > 0 ? frame : 0) * g_state.channels);
+}
+
+static size_t current_frame() {
+    if (!g_state.stream) return 0;
 
-    if (g_state.audioBuffer.empty()) return 0.0f;
+    if (!has_audio_data()) return 0;
 
     // Bytes currently in the stream (not yet played)
     int queuedBytes = SDL_GetAudioStreamAvailable(g_state.stream);
@@ -161,20 +283,155 @@ float get_current_time() {
     // Samples remaining to be played from what we pushed
     size_t samplesQueued = queuedBytes / sizeof(float);
 
-    // Samples we INTENDED to play (from playHead to end)
-    size_t totalSamplesToPlay = g_state.audioBuffer.size() - g_state.playHead;
+    // Everything pushed since the last seek, minus what the device hasn't taken yet.
+    // Before anything is pushed (paused after a seek or stop) this is just the playHead.
+    size_t currentSampleIndex = g_state.pushedUntil > samplesQueued ? g_state.pushedUntil - samplesQueued : 0;
+    if (currentSampleIndex < g_state.playHead) currentSampleIndex = g_state.playHead;
 
-    // Samples actually played so far since the last seek/play
-    size_t samplesPlayedSinceSeek = totalSamplesToPlay - samplesQueued;
+    if (currentSampleIndex > g_state.sampleCount) currentSampleIndex = g_state.sampleCount;
 
-    size_t currentSampleIndex = g_state.playHead + samplesPlayedSinceSeek;
+    // Each frame has `channels` samples
+    return currentSampleIndex / g_state.channels;
+}
 
-    if (currentSampleIndex > g_state.audioBuffer.size()) currentSampleIndex = g_state.audioBuffer.size();
+static double current_time_seconds() {
+    if (!has_audio_data()) return 0.0;
+    return (double)current_frame() / g_state.sampleRate;
+}
 
-    // Convert to seconds
-    // Each frame has `channels` samples
-    size_t frames = currentSampleIndex / g_state.channels;
-    return (float)frames / g_state.sampleRate;
+static void publish_status() {
+    uint32_t flags = (g_state.isPlaying ? STATUS_PLAYING : 0u) | (g_state.isLoading ? STATUS_LOADING : 0u);
+    double position = current_time_seconds();
+    double duration = 0.0;
+    double bufferedAhead = 0.0;
+    if (has_audio_data() && g_state.channels > 0 && g_state.sampleRate > 0) {
+        double samplesPerSecond = (double)g_state.channels * g_state.sampleRate;
+        duration = (double)g_state.sampleCount / samplesPerSecond;
+        if (g_state.stream) {
+            bufferedAhead = (SDL_GetAudioStreamQueued(g_state.stream) / sizeof(float)) / samplesPerSecond;
+        }
+    }
+
+    while (g_statusWriteLock.test_and_set(std::memory_order_acquire)) {}
+
+    bool clockChanged = flags != g_status.flags || position != g_status.position;
+    if (clockChanged || duration != g_status.duration || bufferedAhead != g_status.bufferedAhead ||
+        g_deviceLatency != g_status.outputLatency) {
+        uint32_t seq = g_status.seq.load(std::memory_order_relaxed);
+        g_status.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        g_status.flags = flags;
+        g_status.position = position;
+        g_status.duration = duration;
+        g_status.bufferedAhead = bufferedAhead;
+        // Only restamped with the position, so a clock reader never sees time pass without it
+        if (clockChanged) g_status.clockTime = engine_clock_now();
+        g_status.outputLatency = g_deviceLatency;
+        g_status.seq.store(seq + 2, std::memory_order_release);
+    }
+
+    g_statusWriteLock.clear(std::memory_order_release);
+}
+
+// Called whenever the device pulls from the stream; keeps the position and the analysis
+// fresh during playback
+static void on_stream_get(void*, SDL_AudioStream*, int, int) {
+    publish_status();
+    if (has_audio_data() && g_state.channels > 0) {
+        size_t frames = g_state.sampleCount / g_state.channels;
+        size_t frame = current_frame();
+        while (g_analysisLock.test_and_set(std::memory_order_acquire)) {}
+        g_spectrum.update(g_state.samples, frames, g_state.channels, frame);
+        g_stereo.update(g_state.samples, frames, g_state.channels, frame);
+        g_analysisLock.clear(std::memory_order_release);
+    }
+}
+
+EMSCRIPTEN_KEEPALIVE
+float get_current_time() {
+    return (float)current_time_seconds();
+}
+
+EMSCRIPTEN_KEEPALIVE
+int get_current_frame() {
+    return (int)current_frame();
+}
+
+// Gives the track buffer back to the caller (the counterpart of adopt_audio_data) and
+// leaves the engine empty. The caller must free() it. Returns null when nothing is loaded.
+EMSCRIPTEN_KEEPALIVE
+float* detach_audio_data() {
+    if (g_state.stream) {
+        SDL_DestroyAudioStream(g_state.stream);
+        g_state.stream = nullptr;
+    }
+    float* data = g_state.samples;
+    g_state.samples = nullptr;
+    g_state.sampleCount = 0;
+    g_state.playHead = 0;
+    g_state.pushedUntil = 0;
+    g_state.isPlaying = false;
+    reset_analysis();
+    g_waveform.reset();
+    publish_status();
+    return data;
+}
+
+// Splits `frames` frames of an interleaved buffer, from `startFrame` on, into `planar`
+// (channel after channel, `frames` each). JS moves a detached track into an AudioBuffer
+// through this a slab at a time, instead of a strided copy per channel in JS. Returns 0,
+// leaving `planar` untouched, when the arguments don't describe a buffer.
+EMSCRIPTEN_KEEPALIVE
+int deinterleave_frames(const float* interleaved, int channels, int startFrame, int frames, float* planar) {
+    if (!interleaved || !planar || channels <= 0 || startFrame < 0 || frames <= 0) return 0;
+    // Plane pointers on the stack for any common layout, on the heap beyond that
+    float* stackPlanes[8];
+    std::vector<float*> heapPlanes;
+    float** planes = stackPlanes;
+    if (channels > 8) {
+        heapPlanes.resize((size_t)channels);
+        planes = heapPlanes.data();
+    }
+    for (int ch = 0; ch < channels; ++ch) planes[ch] = planar + (size_t)ch * frames;
+    deinterleave(interleaved + (size_t)startFrame * channels, channels, (size_t)frames, planes);
+    return 1;
+}
+
+EMSCRIPTEN_KEEPALIVE
+EngineStatus* get_status_ptr() {
+    return &g_status;
+}
+
+// Spectrum of what is playing, updated from the stream callback (see analysis.h)
+EMSCRIPTEN_KEEPALIVE
+SpectrumBlock* get_spectrum_ptr() {
+    return g_spectrum.block();
+}
+
+// Correlation, vectorscope points and scope window of what is playing (see analysis.h)
+EMSCRIPTEN_KEEPALIVE
+StereoBlock* get_stereo_ptr() {
+    return g_stereo.block();
+}
+
+// Starts a min/max overview of the loaded track (see waveform.h) and returns its header,
+// or null when nothing is loaded. JS then calls waveform_step until it returns 1.
+EMSCRIPTEN_KEEPALIVE
+WaveformHeader* waveform_begin() {
+    if (!has_audio_data() || g_state.channels <= 0) return nullptr;
+    g_waveform.begin(g_state.samples, g_state.sampleCount / g_state.channels, g_state.channels);
+    return g_waveform.empty() ? nullptr : g_waveform.header();
+}
+
+EMSCRIPTEN_KEEPALIVE
+int waveform_step(int maxFrames) {
+    return g_waveform.step(maxFrames > 0 ? (size_t)maxFrames : 0) ? 1 : 0;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void set_loading(int loading) {
+    g_state.isLoading = loading != 0;
+    publish_status();
 }
 
 EMSCRIPTEN_KEEPALIVE
@@ -185,6 +442,89 @@ void set_volume(float vol) {
     }
 }
 
+// Command buffer: JS appends opcodes into this block during a UI frame and then makes one
+// flush_commands() call (layout mirrors src/engineCommands.ts). Redundant commands are
+// coalesced at flush time, e.g. only the last seek and the last volume change of a frame run.
+enum EngineCommandOp : int32_t {
+    CMD_PLAY = 1,
+    CMD_PAUSE = 2,
+    CMD_RESUME = 3,
+    CMD_STOP = 4,
+    CMD_SEEK = 5,
+    CMD_SET_VOLUME = 6,
+};
+
+struct EngineCommand {
+    int32_t op;
+    int32_t reserved;
+    double arg;
+};
+
+constexpr int32_t COMMAND_CAPACITY = 64;
+
+struct CommandBuffer {
+    std::atomic<int32_t> count;
+    int32_t reserved;
+    EngineCommand commands[COMMAND_CAPACITY];
+};
+static_assert(sizeof(EngineCommand) == 16 && sizeof(CommandBuffer) == 8 + 16 * COMMAND_CAPACITY,
+              "CommandBuffer layout is shared with JS");
+
+static CommandBuffer g_commands = {};
+
+EMSCRIPTEN_KEEPALIVE
+CommandBuffer* get_command_buffer_ptr() {
+    return &g_commands;
+}
+
+// Runs the queued commands in order and returns how many were executed (after coalescing)
+EMSCRIPTEN_KEEPALIVE
+int flush_commands() {
+    int32_t count = g_commands.count.load(std::memory_order_acquire);
+    if (count > COMMAND_CAPACITY) count = COMMAND_CAPACITY;
+
+    int32_t lastSeek = -1;
+    int32_t lastVolume = -1;
+    for (int32_t i = 0; i < count; ++i) {
+        if (g_commands.commands[i].op == CMD_SEEK) lastSeek = i;
+        else if (g_commands.commands[i].op == CMD_SET_VOLUME) lastVolume = i;
+    }
+
+    int executed = 0;
+    int32_t previousOp = 0;
+    for (int32_t i = 0; i < count; ++i) {
+        const EngineCommand& cmd = g_commands.commands[i];
+        switch (cmd.op) {
+            case CMD_PLAY:
+            case CMD_PAUSE:
+            case CMD_RESUME:
+            case CMD_STOP:
+                // Repeating a transport command back-to-back is a no-op
+                if (cmd.op == previousOp) continue;
+                if (cmd.op == CMD_PLAY) play();
+                else if (cmd.op == CMD_PAUSE) pause_audio();
+                else if (cmd.op == CMD_RESUME) resume_audio();
+                else stop();
+                break;
+            case CMD_SEEK:
+                if (i != lastSeek) continue;
+                seek((float)cmd.arg);
+                break;
+            case CMD_SET_VOLUME:
+                if (i != lastVolume) continue;
+                set_volume((float)cmd.arg);
+                break;
+            default:
+                continue;
+        }
+        previousOp = cmd.op;
+        ++executed;
+    }
+
+    g_commands.count.store(0, std::memory_order_release);
+    return executed;
+}
+
 EMSCRIPTEN_KEEPALIVE
 void cleanup() {
     if (g_state.stream) {
@@ -195,7 +535,8 @@ void cleanup() {
         SDL_CloseAudioDevice(g_state.deviceId);
         g_state.deviceId = 0;
     }
-    g_state.audioBuffer.clear();
+    g_waveform.reset();
+    release_audio_data();
     SDL_Quit();
 }
 
@@ -14,14 +14,14 @@ mkdir -p "$BUILD_DIR" "$OUT_DIR"
 source /content/build_space/emsdk/emsdk_env.sh || source ./emsdk/emsdk_env.sh || ../emsdk/emsdk_env.sh || ../../emsdk/emsdk_env.sh
 
 
-echo "Compiling audio_engine.cpp -> $OUT_JS using -sUSE_SDL=3"
+echo "Compiling audio_engine.cpp analysis.cpp waveform.cpp kernels.cpp -> $OUT_JS using -sUSE_SDL=3"
 
 # Compile directly using the SDL3 port
-emcc "$SCRIPT_DIR/audio_engine.cpp" \
+emcc "$SCRIPT_DIR/audio_engine.cpp" "$SCRIPT_DIR/analysis.cpp" "$SCRIPT_DIR/waveform.cpp" "$SCRIPT_DIR/kernels.cpp" \
   -s USE_SDL=3 \
   -s USE_PTHREADS=1 \
   -s WASM=1 \
-  -s EXPORTED_FUNCTIONS='["_init_audio","_set_audio_data","_play","_pause_audio","_resume_audio","_stop","_seek","_get_current_time","_set_volume","_cleanup","_malloc","_free"]' \
+  -s EXPORTED_FUNCTIONS='["_init_audio","_set_audio_data","_adopt_audio_data","_play","_pause_audio","_resume_audio","_stop","_seek","_seek_frame","_get_current_time","_get_current_frame","_detach_audio_data","_deinterleave_frames","_set_volume","_get_status_ptr","_get_spectrum_ptr","_get_stereo_ptr","_waveform_begin","_waveform_step","_set_loading","_get_command_buffer_ptr","_flush_commands","_cleanup","_malloc","_free"]' \
   -s EXPORTED_RUNTIME_METHODS='["ccall","cwrap","HEAPF32","HEAPU8"]' \
   -s ALLOW_MEMORY_GROWTH=1 \
   -s MODULARIZE=1 \
@@ -29,6 +29,7 @@ emcc "$SCRIPT_DIR/audio_engine.cpp" \
   -s ENVIRONMENT="web,worker" \
   -s AUDIO_WORKLET=1 \
   -s WASM_WORKERS=1 \
+  -msimd128 \
   -O3 \
   -o "$OUT_JS"
 
@@ -0,0 +1,55 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Builds and runs the kernel micro-benchmarks (kernel_bench.cpp) natively and, when emsdk is
+# available, as WASM under Node with the engine's SIMD flags. Results are written to
+# build/kernel-bench.<target>.json. Copy a good run to build/kernel-bench.<target>.baseline.json
+# and later runs are checked against it. Timings only compare on the same machine, so the
+# baseline stays in the (ignored) build directory and the check is skipped without one.
+# Extra arguments (--frames, --min-ms, --tolerance) go to both runs. Exits non-zero on a
+# failed check or a slowdown.
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+BUILD_DIR="$SCRIPT_DIR/build"
+CXX="${CXX:-c++}"
+SOURCES=("$SCRIPT_DIR/kernel_bench.cpp" "$SCRIPT_DIR/kernels.cpp")
+
+mkdir -p "$BUILD_DIR"
+status=0
+
+# Runs one target, against its baseline when there is one
+run() {
+  local target="$1"
+  shift
+  local baseline="$BUILD_DIR/kernel-bench.$target.baseline.json"
+  local args=("$@")
+  if [ -f "$baseline" ]; then
+    args+=(--baseline "$baseline")
+  fi
+  "${RUNNER[@]}" "${args[@]}" | tee "$BUILD_DIR/kernel-bench.$target.json" || status=1
+  if [ ! -f "$baseline" ]; then
+    echo "No $target baseline; copy kernel-bench.$target.json to $baseline to check later runs" >&2
+  fi
+}
+
+echo "Compiling kernel_bench.cpp kernels.cpp -> $BUILD_DIR/kernel-bench"
+"$CXX" -std=c++17 -O3 -Wall "${SOURCES[@]}" -o "$BUILD_DIR/kernel-bench"
+RUNNER=("$BUILD_DIR/kernel-bench")
+run native "$@"
+
+source /content/build_space/emsdk/emsdk_env.sh 2>/dev/null || source ./emsdk/emsdk_env.sh 2>/dev/null || true
+if command -v emcc >/dev/null && command -v node >/dev/null; then
+  echo "Compiling kernel_bench.cpp kernels.cpp -> $BUILD_DIR/kernel-bench.js (Node)"
+  emcc -std=c++17 -O3 -msimd128 "${SOURCES[@]}" \
+    -s ENVIRONMENT=node \
+    -s NODERAWFS=1 \
+    -s EXIT_RUNTIME=1 \
+    -s ALLOW_MEMORY_GROWTH=1 \
+    -o "$BUILD_DIR/kernel-bench.js"
+  RUNNER=(node "$BUILD_DIR/kernel-bench.js")
+  run wasm "$@"
+else
+  echo "emcc or node not found; skipping the WASM run" >&2
+fi
+
+exit $status
@@ -0,0 +1,22 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Native build and run of the engine test (engine_test.cpp). audio_engine.cpp is compiled
+# against the stand-in SDL and emscripten headers in test_stubs/ instead of emsdk, so this
+# needs only a C++17 compiler. Exits non-zero when the test fails.
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+BUILD_DIR="$SCRIPT_DIR/build"
+OUT="$BUILD_DIR/engine-test"
+CXX="${CXX:-c++}"
+
+mkdir -p "$BUILD_DIR"
+
+echo "Compiling engine_test.cpp audio_engine.cpp analysis.cpp waveform.cpp kernels.cpp -> $OUT"
+
+"$CXX" -std=c++17 -O2 -pthread -Wall -Wextra -I "$SCRIPT_DIR/test_stubs" \
+  "$SCRIPT_DIR/engine_test.cpp" "$SCRIPT_DIR/audio_engine.cpp" "$SCRIPT_DIR/analysis.cpp" \
+  "$SCRIPT_DIR/waveform.cpp" "$SCRIPT_DIR/kernels.cpp" \
+  -o "$OUT"
+
+"$OUT"
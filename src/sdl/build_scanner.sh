@@ -0,0 +1,22 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Native build of the library scanner (scanner.cpp). Unlike build.sh this needs no emsdk,
+# just a C++17 compiler; it shares the decoder and analysis sources with the engine build.
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+BUILD_DIR="$SCRIPT_DIR/build"
+OUT="$BUILD_DIR/flac-scan"
+CXX="${CXX:-c++}"
+
+mkdir -p "$BUILD_DIR"
+
+echo "Compiling scanner.cpp flac_decoder.cpp loudness.cpp waveform.cpp analysis.cpp track_index.cpp -> $OUT"
+
+"$CXX" -std=c++17 -O3 -pthread -Wall \
+  "$SCRIPT_DIR/scanner.cpp" "$SCRIPT_DIR/flac_decoder.cpp" "$SCRIPT_DIR/loudness.cpp" "$SCRIPT_DIR/waveform.cpp" \
+  "$SCRIPT_DIR/analysis.cpp" "$SCRIPT_DIR/track_index.cpp" \
+  -o "$OUT"
+
+echo "Build finished successfully."
+ls -lh "$OUT"
@@ -0,0 +1,257 @@
+// engine-test: drives audio_engine.cpp natively against a fake SDL audio device (the stubs
+// below, declared in test_stubs/SDL3/SDL.h). A device thread pulls from the bound stream and
+// runs its get callback the way SDL does, while the main thread loads, plays, pauses, stops
+// and detaches tracks, so the engine's locks are taken from both sides. build_engine_test.sh
+// builds and runs it.
+//
+// Exits non-zero when a check fails, and after a timeout if the engine hangs.
+
+#include <SDL3/SDL.h>
+
+#include "analysis.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+#include <unistd.h>
+
+extern "C" {
+int init_audio();
+void adopt_audio_data(float* data, int length, int channels, int sampleRate);
+void play();
+void pause_audio();
+void stop();
+int get_current_frame();
+float* detach_audio_data();
+SpectrumBlock* get_spectrum_ptr();
+StereoBlock* get_stereo_ptr();
+void cleanup();
+}
+
+// ---- Fake device ------------------------------------------------------------------------
+
+struct SDL_AudioStream {
+    SDL_AudioStreamCallback get = nullptr;
+    void* userdata = nullptr;
+    int queued = 0; // bytes
+};
+
+// Held while the device runs a callback, like SDL's stream lock; recursive because the
+// engine queries the stream from inside its callback
+static std::recursive_mutex g_deviceMutex;
+static SDL_AudioStream* g_bound = nullptr;
+static bool g_devicePaused = true;
+static std::atomic<int> g_pulls{0};
+
+// Bytes the device takes per pull: 512 stereo float frames
+static const int PULL_BYTES = 512 * 2 * sizeof(float);
+
+extern "C" {
+
+bool SDL_Init(SDL_InitFlags) { return true; }
+void SDL_Quit(void) {}
+const char* SDL_GetError(void) { return "stub"; }
+
+SDL_AudioDeviceID SDL_OpenAudioDevice(SDL_AudioDeviceID, const SDL_AudioSpec*) { return 1; }
+void SDL_CloseAudioDevice(SDL_AudioDeviceID) {}
+
+bool SDL_GetAudioDeviceFormat(SDL_AudioDeviceID, SDL_AudioSpec* spec, int* sample_frames) {
+    spec->format = SDL_AUDIO_F32;
+    spec->channels = 2;
+    spec->freq = 48000;
+    *sample_frames = 512;
+    return true;
+}
+
+bool SDL_PauseAudioDevice(SDL_AudioDeviceID) {
+    std::lock_guard<std::recursive_mutex> lock(g_deviceMutex);
+    g_devicePaused = true;
+    return true;
+}
+
+bool SDL_ResumeAudioDevice(SDL_AudioDeviceID) {
+    std::lock_guard<std::recursive_mutex> lock(g_deviceMutex);
+    g_devicePaused = false;
+    return true;
+}
+
+SDL_AudioStream* SDL_CreateAudioStream(const SDL_AudioSpec*, const SDL_AudioSpec*) {
+    return new SDL_AudioStream();
+}
+
+void SDL_DestroyAudioStream(SDL_AudioStream* stream) {
+    std::lock_guard<std::recursive_mutex> lock(g_deviceMutex);
+    if (g_bound == stream) g_bound = nullptr;
+    delete stream;
+}
+
+bool SDL_BindAudioStream(SDL_AudioDeviceID, SDL_AudioStream* stream) {
+    std::lock_guard<std::recursive_mutex> lock(g_deviceMutex);
+    g_bound = stream;
+    return true;
+}
+
+bool SDL_SetAudioStreamGetCallback(SDL_AudioStream* stream, SDL_AudioStreamCallback callback, void* userdata) {
+    std::lock_guard<std::recursive_mutex> lock(g_deviceMutex);
+    stream->get = callback;
+    stream->userdata = userdata;
+    return true;
+}
+
+bool SDL_PutAudioStreamData(SDL_AudioStream* stream, const void*, int len) {
+    std::lock_guard<std::recursive_mutex> lock(g_deviceMutex);
+    stream->queued += len;
+    return true;
+}
+
+bool SDL_ClearAudioStream(SDL_AudioStream* stream) {
+    std::lock_guard<std::recursive_mutex> lock(g_deviceMutex);
+    stream->queued = 0;
+    return true;
+}
+
+int SDL_GetAudioStreamAvailable(SDL_AudioStream* stream) {
+    std::lock_guard<std::recursive_mutex> lock(g_deviceMutex);
+    return stream->queued;
+}
+
+int SDL_GetAudioStreamQueued(SDL_AudioStream* stream) { return SDL_GetAudioStreamAvailable(stream); }
+
+bool SDL_SetAudioStreamGain(SDL_AudioStream*, float) { return true; }
+
+} // extern "C"
+
+// Pulls from the bound stream until `running` clears, calling its get callback each time
+static void run_device(const std::atomic<bool>& running) {
+    while (running.load()) {
+        {
+            std::lock_guard<std::recursive_mutex> lock(g_deviceMutex);
+            if (g_bound && !g_devicePaused) {
+                int take = std::min(g_bound->queued, PULL_BYTES);
+                g_bound->queued -= take;
+                if (g_bound->get) g_bound->get(g_bound->userdata, g_bound, take, take);
+                g_pulls.fetch_add(1);
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+// ---- Checks -----------------------------------------------------------------------------
+
+static int g_failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        ++g_failures;
+    }
+}
+
+// Seqlock reads, as the visualizer does them
+static float spectrum_level() {
+    const SpectrumBlock* block = get_spectrum_ptr();
+    for (;;) {
+        uint32_t before = block->seq.load(std::memory_order_acquire);
+        float level = block->level;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((before & 1) == 0 && block->seq.load(std::memory_order_relaxed) == before) return level;
+    }
+}
+
+static float stereo_correlation() {
+    const StereoBlock* block = get_stereo_ptr();
+    for (;;) {
+        uint32_t before = block->seq.load(std::memory_order_acquire);
+        float correlation = block->correlation;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((before & 1) == 0 && block->seq.load(std::memory_order_relaxed) == before) return correlation;
+    }
+}
+
+// Waits (bounded) until the device has pulled `count` more times
+static bool wait_for_pulls(int count) {
+    int target = g_pulls.load() + count;
+    for (int i = 0; i < 20000 && g_pulls.load() < target; ++i) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return g_pulls.load() >= target;
+}
+
+// One second of a 1 kHz tone, in phase on both channels, from malloc() as adopt requires
+static float* make_track(int frames, int sampleRate) {
+    float* data = (float*)std::malloc((size_t)frames * 2 * sizeof(float));
+    for (int i = 0; i < frames; ++i) {
+        float s = 0.5f * std::sin(2.0f * 3.14159265f * 1000.0f * i / sampleRate);
+        data[2 * i] = data[2 * i + 1] = s;
+    }
+    return data;
+}
+
+static void on_timeout(int) {
+    static const char message[] = "FAIL: engine hung (timeout)\n";
+    (void)!write(2, message, sizeof(message) - 1);
+    _exit(1);
+}
+
+int main() {
+    std::signal(SIGALRM, on_timeout);
+    alarm(60);
+
+    const int sampleRate = 48000;
+    const int frames = sampleRate;
+    const int rounds = 50;
+
+    check(init_audio() == 1, "init_audio");
+
+    std::atomic<bool> running{true};
+    std::thread device(run_device, std::cref(running));
+
+    for (int round = 0; round < rounds; ++round) {
+        float* track = make_track(frames, sampleRate);
+        adopt_audio_data(track, frames * 2, 2, sampleRate);
+
+        play();
+        check(wait_for_pulls(8), "device pulls while playing");
+        check(get_current_frame() > 0, "position advances while playing");
+        if (round == 0) {
+            check(spectrum_level() > 0.0f, "spectrum follows playback");
+            check(stereo_correlation() > 0.0f, "in-phase channels read as correlated");
+        }
+
+        // Pausing stops the device before resetting, so the silence has to stick
+        pause_audio();
+        check(spectrum_level() == 0.0f, "pause resets the spectrum");
+        check(stereo_correlation() == 0.0f, "pause resets the stereo analysis");
+
+        // Stop and detach race the callback, which keeps running after stop()
+        play();
+        check(wait_for_pulls(2), "device pulls after resuming");
+        stop();
+        check(get_current_frame() == 0, "stop rewinds");
+        play();
+        check(wait_for_pulls(2), "device pulls after restarting");
+
+        // Every other round hands the track back; the rest are replaced by the next load
+        if (round % 2 == 0) {
+            float* detached = detach_audio_data();
+            check(detached == track, "detach returns the adopted buffer");
+            std::free(detached);
+            check(detach_audio_data() == nullptr, "detach leaves the engine empty");
+        }
+    }
+
+    running.store(false);
+    device.join();
+    cleanup();
+
+    if (g_failures == 0) std::printf("engine-test: %d rounds passed\n", rounds);
+    return g_failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,354 @@
+#include "flac_decoder.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// MSB-first CRCs over the frame bytes, as the FLAC format defines them
+struct CrcTables {
+    uint8_t crc8[256];
+    uint16_t crc16[256];
+
+    CrcTables() {
+        for (int i = 0; i < 256; ++i) {
+            uint8_t c8 = (uint8_t)i;
+            for (int bit = 0; bit < 8; ++bit) c8 = (uint8_t)((c8 & 0x80) ? (c8 << 1) ^ 0x07 : c8 << 1);
+            crc8[i] = c8;
+            uint16_t c16 = (uint16_t)(i << 8);
+            for (int bit = 0; bit < 8; ++bit) c16 = (uint16_t)((c16 & 0x8000) ? (c16 << 1) ^ 0x8005 : c16 << 1);
+            crc16[i] = c16;
+        }
+    }
+};
+
+const CrcTables& crc_tables() {
+    static const CrcTables tables;
+    return tables;
+}
+
+uint8_t crc8(const uint8_t* data, size_t size) {
+    const CrcTables& t = crc_tables();
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; ++i) crc = t.crc8[crc ^ data[i]];
+    return crc;
+}
+
+uint16_t crc16(const uint8_t* data, size_t size) {
+    const CrcTables& t = crc_tables();
+    uint16_t crc = 0;
+    for (size_t i = 0; i < size; ++i) crc = (uint16_t)((crc << 8) ^ t.crc16[(crc >> 8) ^ data[i]]);
+    return crc;
+}
+
+// Big-endian bit reader over the whole file. Reads past the end return zeros and set
+// overrun(), which callers check once per frame rather than per read.
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size, size_t byteOffset)
+        : data_(data), size_(size), bitPos_(byteOffset * 8) {}
+
+    // Up to 57 bits
+    uint64_t read(int bits) {
+        if (bits == 0) return 0;
+        uint64_t window = load(bitPos_ >> 3) << (bitPos_ & 7);
+        bitPos_ += bits;
+        return window >> (64 - bits);
+    }
+
+    int64_t readSigned(int bits) {
+        if (bits == 0) return 0;
+        uint64_t value = read(bits);
+        return (int64_t)(value << (64 - bits)) >> (64 - bits);
+    }
+
+    // Zeros before the next 1 bit, which is consumed
+    uint32_t readUnary() {
+        uint32_t count = 0;
+        for (;;) {
+            int shift = (int)(bitPos_ & 7);
+            uint64_t window = load(bitPos_ >> 3) << shift;
+            if (window != 0) {
+                int zeros = __builtin_clzll(window);
+                bitPos_ += zeros + 1;
+                return count + zeros;
+            }
+            count += 64 - shift;
+            bitPos_ += 64 - shift;
+            if (overrun()) return count;
+        }
+    }
+
+    void alignToByte() { bitPos_ = (bitPos_ + 7) & ~(size_t)7; }
+    size_t bytePos() const { return bitPos_ >> 3; }
+    bool overrun() const { return bitPos_ > size_ * 8; }
+
+private:
+    uint64_t load(size_t byte) const {
+        if (byte + 8 <= size_) {
+            uint64_t v;
+            std::memcpy(&v, data_ + byte, 8);
+            return __builtin_bswap64(v);
+        }
+        uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) {
+            v <<= 8;
+            if (byte + i < size_) v |= data_[byte + i];
+        }
+        return v;
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t bitPos_;
+};
+
+uint32_t read_be(const uint8_t* p, int bytes) {
+    uint32_t v = 0;
+    for (int i = 0; i < bytes; ++i) v = (v << 8) | p[i];
+    return v;
+}
+
+// Residual of one subframe, written after the `order` warm-up samples
+bool decode_residual(BitReader& br, int64_t* out, uint32_t blockSize, int order) {
+    uint32_t method = (uint32_t)br.read(2);
+    if (method > 1) return false;
+    int paramBits = method == 0 ? 4 : 5;
+    uint32_t escape = method == 0 ? 15 : 31;
+    int partitionOrder = (int)br.read(4);
+    uint32_t partitionSize = blockSize >> partitionOrder;
+    if ((partitionSize << partitionOrder) != blockSize || partitionSize < (uint32_t)order) return false;
+
+    uint32_t i = (uint32_t)order;
+    for (uint32_t p = 0; p < (1u << partitionOrder); ++p) {
+        uint32_t end = (p + 1) * partitionSize;
+        uint32_t param = (uint32_t)br.read(paramBits);
+        if (param == escape) {
+            int bits = (int)br.read(5);
+            for (; i < end; ++i) out[i] = br.readSigned(bits);
+        } else {
+            for (; i < end; ++i) {
+                uint64_t value = ((uint64_t)br.readUnary() << param) | br.read((int)param);
+                out[i] = (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+            }
+        }
+        if (br.overrun()) return false;
+    }
+    return true;
+}
+
+bool decode_subframe(BitReader& br, int64_t* out, uint32_t blockSize, int bitsPerSample) {
+    if (br.read(1) != 0) return false;
+    uint32_t type = (uint32_t)br.read(6);
+    int wasted = 0;
+    if (br.read(1)) {
+        wasted = (int)br.readUnary() + 1;
+        if (wasted >= bitsPerSample) return false;
+        bitsPerSample -= wasted;
+    }
+
+    if (type == 0) {
+        int64_t value = br.readSigned(bitsPerSample);
+        for (uint32_t i = 0; i < blockSize; ++i) out[i] = value;
+    } else if (type == 1) {
+        for (uint32_t i = 0; i < blockSize; ++i) out[i] = br.readSigned(bitsPerSample);
+    } else if (type >= 8 && type <= 12) {
+        int order = (int)type - 8;
+        if ((uint32_t)order > blockSize) return false;
+        for (int i = 0; i < order; ++i) out[i] = br.readSigned(bitsPerSample);
+        if (!decode_residual(br, out, blockSize, order)) return false;
+        for (uint32_t i = (uint32_t)order; i < blockSize; ++i) {
+            switch (order) {
+            case 1: out[i] += out[i - 1]; break;
+            case 2: out[i] += 2 * out[i - 1] - out[i - 2]; break;
+            case 3: out[i] += 3 * out[i - 1] - 3 * out[i - 2] + out[i - 3]; break;
+            case 4: out[i] += 4 * out[i - 1] - 6 * out[i - 2] + 4 * out[i - 3] - out[i - 4]; break;
+            default: break;
+            }
+        }
+    } else if (type >= 32) {
+        int order = (int)(type & 31) + 1;
+        if ((uint32_t)order > blockSize) return false;
+        for (int i = 0; i < order; ++i) out[i] = br.readSigned(bitsPerSample);
+        int precision = (int)br.read(4) + 1;
+        if (precision == 16) return false;
+        int shift = (int)br.readSigned(5);
+        if (shift < 0) return false;
+        int64_t coefficients[32];
+        for (int i = 0; i < order; ++i) coefficients[i] = br.readSigned(precision);
+        if (!decode_residual(br, out, blockSize, order)) return false;
+        for (uint32_t i = (uint32_t)order; i < blockSize; ++i) {
+            int64_t sum = 0;
+            for (int j = 0; j < order; ++j) sum += coefficients[j] * out[i - 1 - j];
+            out[i] += sum >> shift;
+        }
+    } else {
+        return false;
+    }
+
+    if (wasted > 0) {
+        for (uint32_t i = 0; i < blockSize; ++i) out[i] *= (int64_t)1 << wasted;
+    }
+    return !br.overrun();
+}
+
+} // namespace
+
+bool FlacDecoder::fail(const char* message) {
+    error_ = message;
+    return false;
+}
+
+bool FlacDecoder::open(const uint8_t* data, size_t size) {
+    data_ = data;
+    size_ = size;
+    info_ = FlacStreamInfo();
+    error_.clear();
+
+    size_t offset = 0;
+    // Some taggers put an ID3v2 tag in front of the stream marker
+    if (size >= 10 && std::memcmp(data, "ID3", 3) == 0) {
+        offset = 10 + ((data[6] & 0x7f) << 21 | (data[7] & 0x7f) << 14 | (data[8] & 0x7f) << 7 | (data[9] & 0x7f));
+    }
+    if (offset + 4 > size || std::memcmp(data + offset, "fLaC", 4) != 0) return fail("not a FLAC file");
+    offset += 4;
+
+    bool haveStreamInfo = false;
+    bool last = false;
+    while (!last) {
+        if (offset + 4 > size) return fail("truncated metadata");
+        last = (data[offset] & 0x80) != 0;
+        int type = data[offset] & 0x7f;
+        uint32_t length = read_be(data + offset + 1, 3);
+        offset += 4;
+        if (offset + length > size) return fail("truncated metadata");
+
+        if (type == 0) {
+            if (length < 34) return fail("bad STREAMINFO");
+            const uint8_t* p = data + offset;
+            info_.minBlockSize = read_be(p, 2);
+            info_.maxBlockSize = read_be(p + 2, 2);
+            info_.sampleRate = read_be(p + 10, 3) >> 4;
+            info_.channels = ((p[12] >> 1) & 0x07) + 1;
+            info_.bitsPerSample = (((p[12] & 0x01) << 4) | (p[13] >> 4)) + 1;
+            info_.totalFrames = ((uint64_t)(p[13] & 0x0f) << 32) | read_be(p + 14, 4);
+            haveStreamInfo = true;
+        }
+        offset += length;
+    }
+    if (!haveStreamInfo) return fail("missing STREAMINFO");
+    if (info_.sampleRate == 0) return fail("bad sample rate");
+
+    audioOffset_ = offset;
+    rewind();
+    return true;
+}
+
+void FlacDecoder::rewind() {
+    nextOffset_ = audioOffset_;
+    decodedFrames_ = 0;
+    error_.clear();
+}
+
+bool FlacDecoder::decodeNext(std::vector<float>& interleaved, FlacFrameInfo* frame) {
+    if (!data_) return fail("not open");
+    if (!error_.empty()) return false;
+
+    // Trailing tags or padding after the last frame end the stream
+    size_t offset = nextOffset_;
+    if (offset + 2 > size_ || data_[offset] != 0xff || (data_[offset + 1] & 0xfe) != 0xf8) {
+        if (info_.totalFrames > 0 && decodedFrames_ != info_.totalFrames) return fail("frame count does not match STREAMINFO");
+        return false;
+    }
+    if (frame) *frame = {decodedFrames_, (uint64_t)offset};
+    if (!decodeFrame(offset, interleaved, decodedFrames_)) return false;
+    nextOffset_ = offset;
+    return true;
+}
+
+bool FlacDecoder::decodeFrame(size_t& offset, std::vector<float>& interleaved, uint64_t& decodedFrames) {
+    const size_t frameStart = offset;
+    BitReader br(data_, size_, offset);
+    br.read(16); // sync code, reserved bit and blocking strategy, checked by the caller
+
+    uint32_t blockSizeCode = (uint32_t)br.read(4);
+    uint32_t sampleRateCode = (uint32_t)br.read(4);
+    uint32_t channelCode = (uint32_t)br.read(4);
+    uint32_t sampleSizeCode = (uint32_t)br.read(3);
+    br.read(1);
+
+    // Frame or sample number, UTF-8 style; only its length matters here
+    uint32_t lead = (uint32_t)br.read(8);
+    int extra = 0;
+    while (extra < 8 && (lead & (0x80u >> extra))) ++extra;
+    if (extra == 1 || extra == 8) return fail("bad frame number");
+    if (extra > 0) br.read(8 * (extra - 1));
+
+    uint32_t blockSize = 0;
+    if (blockSizeCode == 1) blockSize = 192;
+    else if (blockSizeCode >= 2 && blockSizeCode <= 5) blockSize = 576u << (blockSizeCode - 2);
+    else if (blockSizeCode == 6) blockSize = (uint32_t)br.read(8) + 1;
+    else if (blockSizeCode == 7) blockSize = (uint32_t)br.read(16) + 1;
+    else if (blockSizeCode >= 8) blockSize = 256u << (blockSizeCode - 8);
+    else return fail("reserved block size");
+
+    if (sampleRateCode == 12) br.read(8);
+    else if (sampleRateCode == 13 || sampleRateCode == 14) br.read(16);
+    else if (sampleRateCode == 15) return fail("bad sample rate code");
+
+    size_t headerEnd = br.bytePos();
+    uint8_t headerCrc = (uint8_t)br.read(8);
+    if (br.overrun() || crc8(data_ + frameStart, headerEnd - frameStart) != headerCrc) return fail("frame header CRC mismatch");
+
+    int channels;
+    if (channelCode < 8) channels = (int)channelCode + 1;
+    else if (channelCode <= 10) channels = 2;
+    else return fail("reserved channel assignment");
+    if (channels != info_.channels) return fail("channel count changes mid-stream");
+
+    static const int kSampleSizes[8] = {0, 8, 12, 0, 16, 20, 24, 32};
+    int bitsPerSample = sampleSizeCode == 0 ? info_.bitsPerSample : kSampleSizes[sampleSizeCode];
+    if (bitsPerSample == 0) return fail("reserved sample size");
+
+    for (int ch = 0; ch < channels; ++ch) {
+        std::vector<int64_t>& samples = channelSamples_[ch];
+        if (samples.size() < blockSize) samples.resize(blockSize);
+        // The side channel carries one extra bit
+        bool side = (channelCode == 8 && ch == 1) || (channelCode == 9 && ch == 0) || (channelCode == 10 && ch == 1);
+        if (!decode_subframe(br, samples.data(), blockSize, bitsPerSample + (side ? 1 : 0))) {
+            return fail("corrupt subframe");
+        }
+    }
+
+    br.alignToByte();
+    size_t frameEnd = br.bytePos();
+    uint16_t frameCrc = (uint16_t)br.read(16);
+    if (br.overrun() || crc16(data_ + frameStart, frameEnd - frameStart) != frameCrc) return fail("frame CRC mismatch");
+    offset = br.bytePos();
+
+    int64_t* a = channelSamples_[0].data();
+    int64_t* b = channels > 1 ? channelSamples_[1].data() : nullptr;
+    if (channelCode == 8) {
+        for (uint32_t i = 0; i < blockSize; ++i) b[i] = a[i] - b[i];
+    } else if (channelCode == 9) {
+        for (uint32_t i = 0; i < blockSize; ++i) a[i] += b[i];
+    } else if (channelCode == 10) {
+        for (uint32_t i = 0; i < blockSize; ++i) {
+            int64_t mid = (a[i] * 2) | (b[i] & 1);
+            int64_t side = b[i];
+            a[i] = (mid + side) >> 1;
+            b[i] = (mid - side) >> 1;
+        }
+    }
+
+    const float scale = std::ldexp(1.0f, -(bitsPerSample - 1));
+    size_t base = interleaved.size();
+    interleaved.resize(base + (size_t)blockSize * channels);
+    float* dst = interleaved.data() + base;
+    for (int ch = 0; ch < channels; ++ch) {
+        const int64_t* src = channelSamples_[ch].data();
+        for (uint32_t i = 0; i < blockSize; ++i) dst[(size_t)i * channels + ch] = (float)src[i] * scale;
+    }
+    decodedFrames += blockSize;
+    return true;
+}
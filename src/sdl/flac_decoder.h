@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// FLAC decoder for native tools (see scanner.cpp). The player decodes in the browser; this
+// decodes files held in memory, a frame at a time, into the interleaved float layout the
+// engine's track buffer uses, so the analysis code runs on the same samples either way.
+//
+// Covers the full FLAC format: fixed and LPC subframes, Rice and Rice2 residuals with escape
+// partitions, wasted bits and all stereo decorrelation modes. Frame header CRC-8 and frame
+// CRC-16 are checked.
+
+struct FlacStreamInfo {
+    uint32_t sampleRate = 0;
+    int channels = 0;
+    int bitsPerSample = 0;
+    uint64_t totalFrames = 0; // 0 when the encoder didn't know
+    uint32_t minBlockSize = 0;
+    uint32_t maxBlockSize = 0;
+};
+
+// Where a FLAC frame starts: its first sample and its byte offset in the file
+struct FlacFrameInfo {
+    uint64_t firstFrame;
+    uint64_t byteOffset;
+};
+
+class FlacDecoder {
+public:
+    // Reads the metadata and positions decoding at the first audio frame; `data` must stay
+    // valid until decoding is done
+    bool open(const uint8_t* data, size_t size);
+
+    const FlacStreamInfo& info() const { return info_; }
+    // Byte offset of the first audio frame
+    size_t audioOffset() const { return audioOffset_; }
+
+    // Appends the next FLAC frame to `interleaved` (samples scaled to -1..1); `frame`, when
+    // given, receives where it starts. False once the stream is done, or on an error, which
+    // leaves error() set.
+    bool decodeNext(std::vector<float>& interleaved, FlacFrameInfo* frame = nullptr);
+
+    // Back to the first audio frame
+    void rewind();
+
+    // Why open() or decodeNext() failed; empty when decodeNext() simply reached the end
+    const std::string& error() const { return error_; }
+
+private:
+    bool fail(const char* message);
+    bool decodeFrame(size_t& offset, std::vector<float>& interleaved, uint64_t& decodedFrames);
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t audioOffset_ = 0;
+    // Where decodeNext() continues, and the frames it has produced so far
+    size_t nextOffset_ = 0;
+    uint64_t decodedFrames_ = 0;
+    FlacStreamInfo info_;
+    std::string error_;
+    // Per-channel scratch for one block; side channels need one extra bit, hence 64-bit
+    std::vector<int64_t> channelSamples_[8];
+};
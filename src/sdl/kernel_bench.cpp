@@ -0,0 +1,305 @@
+// kernel-bench: micro-benchmarks for the sample kernels in kernels.cpp. Every case runs on
+// fixed-seed input, is checked against a plain scalar reference, then timed; results go to
+// stdout as JSON, one case per line. GB/s counts bytes read plus bytes written. build_bench.sh
+// builds it natively and as WASM for Node, the two targets the kernels ship on.
+//
+//   kernel-bench [--frames N] [--min-ms N] [--baseline results.json] [--tolerance 0.15]
+//
+// Exits non-zero when a kernel disagrees with its reference, or, given a baseline from an
+// earlier run on the same machine, when a case got slower by more than the tolerance.
+
+#include "kernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kSeed = 0x2545f491;
+constexpr int kMaxChannels = 8;
+
+struct Options {
+    size_t frames = 1 << 16;
+    double minMs = 200.0;
+    std::string baseline;
+    double tolerance = 0.15;
+};
+
+struct Result {
+    std::string kernel;
+    std::string variant;
+    int channels;
+    bool ok;
+    size_t bytes;
+    double nsPerCall;
+};
+
+// xorshift32, so every target and run sees the same input
+class Random {
+public:
+    explicit Random(uint32_t seed) : state_(seed) {}
+    uint32_t next() {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 17;
+        state_ ^= state_ << 5;
+        return state_;
+    }
+    float sample() { return (float)((double)next() / 2147483648.0 - 1.0); }
+
+private:
+    uint32_t state_;
+};
+
+std::vector<float> random_samples(size_t count, uint32_t seed) {
+    Random random(seed);
+    std::vector<float> samples(count);
+    for (float& s : samples) s = random.sample();
+    return samples;
+}
+
+// Scalar references: the obvious loop, nothing clever
+
+void ref_int_to_float(const int32_t* src, float* dst, size_t count, int bitsPerSample) {
+    const float scale = 1.0f / (float)(1u << (bitsPerSample - 1));
+    for (size_t i = 0; i < count; ++i) dst[i] = (float)src[i] * scale;
+}
+
+void ref_interleave(const float* const* planes, int channels, size_t frames, float* dst) {
+    for (int ch = 0; ch < channels; ++ch) {
+        for (size_t f = 0; f < frames; ++f) dst[f * channels + ch] = planes[ch][f];
+    }
+}
+
+void ref_deinterleave(const float* src, int channels, size_t frames, float* const* planes) {
+    for (int ch = 0; ch < channels; ++ch) {
+        for (size_t f = 0; f < frames; ++f) planes[ch][f] = src[f * channels + ch];
+    }
+}
+
+// Data movement must be bit-exact; arithmetic may differ by rounding (FMA contraction)
+bool same_bits(const std::vector<float>& a, const std::vector<float>& b) {
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+}
+
+bool close_enough(const std::vector<float>& a, const std::vector<float>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::fabs(a[i] - b[i]) > 1e-6f * std::max(1.0f, std::fabs(b[i]))) return false;
+    }
+    return true;
+}
+
+// Best time per call over batches of at least a millisecond, for at least `minMs`
+template <typename Run>
+double time_per_call_ns(Run&& run, double minMs) {
+    using clock = std::chrono::steady_clock;
+    run();
+    double best = INFINITY;
+    size_t batch = 1;
+    const auto started = clock::now();
+    for (;;) {
+        auto t0 = clock::now();
+        for (size_t i = 0; i < batch; ++i) run();
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+        best = std::min(best, ns / batch);
+        if (ns < 1e6) batch *= 2;
+        if (std::chrono::duration<double, std::milli>(clock::now() - started).count() >= minMs) break;
+    }
+    return best;
+}
+
+std::vector<float*> plane_pointers(std::vector<float>& planar, int channels, size_t frames) {
+    std::vector<float*> planes;
+    for (int ch = 0; ch < channels; ++ch) planes.push_back(planar.data() + (size_t)ch * frames);
+    return planes;
+}
+
+Result bench_int_to_float(const Options& o, int bits) {
+    const int channels = 2;
+    const size_t count = o.frames * channels;
+    Random random(kSeed + bits);
+    std::vector<int32_t> src(count);
+    const int32_t limit = (int32_t)(1u << (bits - 1));
+    for (int32_t& s : src) s = (int32_t)(random.next() % (2u * limit)) - limit;
+
+    std::vector<float> out(count), ref(count);
+    int_to_float(src.data(), out.data(), count, bits);
+    ref_int_to_float(src.data(), ref.data(), count, bits);
+
+    double ns = time_per_call_ns([&] { int_to_float(src.data(), out.data(), count, bits); }, o.minMs);
+    return {"int_to_float", "s" + std::to_string(bits), channels, same_bits(out, ref), count * 8, ns};
+}
+
+Result bench_interleave(const Options& o, int channels) {
+    std::vector<float> planar = random_samples(o.frames * channels, kSeed + channels);
+    std::vector<float*> planes = plane_pointers(planar, channels, o.frames);
+    std::vector<const float*> sources(planes.begin(), planes.end());
+
+    std::vector<float> out(o.frames * channels), ref(o.frames * channels);
+    interleave(sources.data(), channels, o.frames, out.data());
+    ref_interleave(sources.data(), channels, o.frames, ref.data());
+
+    double ns = time_per_call_ns([&] { interleave(sources.data(), channels, o.frames, out.data()); }, o.minMs);
+    return {"interleave", "f32", channels, same_bits(out, ref), o.frames * channels * 8, ns};
+}
+
+Result bench_deinterleave(const Options& o, int channels) {
+    std::vector<float> src = random_samples(o.frames * channels, kSeed + 16 + channels);
+    std::vector<float> out(o.frames * channels), ref(o.frames * channels);
+    std::vector<float*> outPlanes = plane_pointers(out, channels, o.frames);
+    std::vector<float*> refPlanes = plane_pointers(ref, channels, o.frames);
+    deinterleave(src.data(), channels, o.frames, outPlanes.data());
+    ref_deinterleave(src.data(), channels, o.frames, refPlanes.data());
+
+    double ns = time_per_call_ns([&] { deinterleave(src.data(), channels, o.frames, outPlanes.data()); }, o.minMs);
+    return {"deinterleave", "f32", channels, same_bits(out, ref), o.frames * channels * 8, ns};
+}
+
+Result bench_gain(const Options& o) {
+    const int channels = 2;
+    const size_t count = o.frames * channels;
+    std::vector<float> out = random_samples(count, kSeed + 32);
+    std::vector<float> ref = out;
+    apply_gain(out.data(), count, 0.7f);
+    for (float& s : ref) s *= 0.7f;
+    bool ok = close_enough(out, ref);
+
+    // Alternating exact powers of two keep the samples from drifting into denormals
+    bool flip = false;
+    double ns = time_per_call_ns([&] { apply_gain(out.data(), count, (flip = !flip) ? 0.5f : 2.0f); }, o.minMs);
+    return {"apply_gain", "f32", channels, ok, count * 8, ns};
+}
+
+Result bench_mix(const Options& o) {
+    const int channels = 2;
+    const size_t count = o.frames * channels;
+    std::vector<float> src = random_samples(count, kSeed + 48);
+    std::vector<float> out = random_samples(count, kSeed + 49);
+    std::vector<float> ref = out;
+    mix_accumulate(out.data(), src.data(), count, 0.7f);
+    for (size_t i = 0; i < count; ++i) ref[i] += src[i] * 0.7f;
+    bool ok = close_enough(out, ref);
+
+    // Adding and then subtracting keeps the mix bounded however long it runs
+    bool flip = false;
+    double ns = time_per_call_ns([&] { mix_accumulate(out.data(), src.data(), count, (flip = !flip) ? 0.5f : -0.5f); },
+                                 o.minMs);
+    return {"mix_accumulate", "f32", channels, ok, count * 12, ns};
+}
+
+std::string case_key(const std::string& kernel, const std::string& variant, int channels) {
+    return kernel + "/" + variant + "/" + std::to_string(channels);
+}
+
+// Reads gbPerSecond per case back out of an earlier run's output (one case per line)
+bool load_baseline(const std::string& path, std::vector<std::pair<std::string, double>>& cases) {
+    std::ifstream in(path);
+    if (!in) return false;
+    auto field = [](const std::string& line, const char* name) -> std::string {
+        std::string key = std::string("\"") + name + "\":";
+        size_t at = line.find(key);
+        if (at == std::string::npos) return "";
+        at += key.size();
+        if (line[at] == '"') {
+            size_t end = line.find('"', at + 1);
+            return line.substr(at + 1, end - at - 1);
+        }
+        size_t end = line.find_first_of(",}", at);
+        return line.substr(at, end - at);
+    };
+    for (std::string line; std::getline(in, line);) {
+        std::string kernel = field(line, "kernel");
+        if (kernel.empty()) continue;
+        cases.push_back({case_key(kernel, field(line, "variant"), std::atoi(field(line, "channels").c_str())),
+                         std::atof(field(line, "gbPerSecond").c_str())});
+    }
+    return true;
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "%s needs a value\n", arg.c_str());
+            return false;
+        }
+        const char* value = argv[++i];
+        if (arg == "--frames") options.frames = std::max<size_t>(4, std::strtoul(value, nullptr, 10));
+        else if (arg == "--min-ms") options.minMs = std::atof(value);
+        else if (arg == "--baseline") options.baseline = value;
+        else if (arg == "--tolerance") options.tolerance = std::atof(value);
+        else {
+            std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        std::fprintf(stderr, "usage: kernel-bench [--frames N] [--min-ms N] [--baseline results.json] [--tolerance 0.15]\n");
+        return 2;
+    }
+
+    std::vector<Result> results;
+    results.push_back(bench_int_to_float(options, 16));
+    results.push_back(bench_int_to_float(options, 24));
+    for (int channels = 1; channels <= kMaxChannels; ++channels) results.push_back(bench_interleave(options, channels));
+    for (int channels = 1; channels <= kMaxChannels; ++channels) results.push_back(bench_deinterleave(options, channels));
+    results.push_back(bench_gain(options));
+    results.push_back(bench_mix(options));
+
+#ifdef __EMSCRIPTEN__
+    const char* target = "wasm";
+#else
+    const char* target = "native";
+#endif
+#if defined(__wasm_simd128__) || defined(__SSE2__) || defined(__ARM_NEON)
+    const bool simd = true;
+#else
+    const bool simd = false;
+#endif
+
+    std::vector<std::pair<std::string, double>> baseline;
+    if (!options.baseline.empty() && !load_baseline(options.baseline, baseline)) {
+        std::fprintf(stderr, "%s: cannot read baseline\n", options.baseline.c_str());
+        return 2;
+    }
+
+    int failures = 0;
+    std::printf("{\"target\":\"%s\",\"simd\":%s,\"frames\":%zu,\"results\":[\n", target, simd ? "true" : "false",
+                options.frames);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        double gbPerSecond = r.bytes / r.nsPerCall;
+        std::printf("{\"kernel\":\"%s\",\"variant\":\"%s\",\"channels\":%d,\"ok\":%s,\"bytes\":%zu,"
+                    "\"nsPerCall\":%.1f,\"nsPerFrame\":%.4f,\"gbPerSecond\":%.3f}%s\n",
+                    r.kernel.c_str(), r.variant.c_str(), r.channels, r.ok ? "true" : "false", r.bytes, r.nsPerCall,
+                    r.nsPerCall / options.frames, gbPerSecond, i + 1 < results.size() ? "," : "");
+
+        const std::string key = case_key(r.kernel, r.variant, r.channels);
+        if (!r.ok) {
+            std::fprintf(stderr, "%s: output differs from the scalar reference\n", key.c_str());
+            ++failures;
+        }
+        for (const auto& [name, before] : baseline) {
+            if (name == key && gbPerSecond < before * (1.0 - options.tolerance)) {
+                std::fprintf(stderr, "%s: %.3f GB/s, baseline %.3f GB/s\n", key.c_str(), gbPerSecond, before);
+                ++failures;
+            }
+        }
+    }
+    std::printf("]}\n");
+    return failures > 0 ? 1 : 0;
+}
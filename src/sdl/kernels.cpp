@@ -0,0 +1,74 @@
+#include "kernels.h"
+
+#include "simd.h"
+
+#include <cmath>
+#include <cstring>
+
+void int_to_float(const int32_t* src, float* dst, size_t count, int bitsPerSample) {
+    const float scale = std::ldexp(1.0f, -(bitsPerSample - 1));
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        store4(dst + i, __builtin_convertvector(load4(src + i), f32x4) * scale);
+    }
+    for (; i < count; ++i) dst[i] = (float)src[i] * scale;
+}
+
+void interleave(const float* const* planes, int channels, size_t frames, float* dst) {
+    if (channels == 1) {
+        std::memcpy(dst, planes[0], frames * sizeof(float));
+        return;
+    }
+
+    size_t f = 0;
+    if (channels == 2) {
+        const float* left = planes[0];
+        const float* right = planes[1];
+        for (; f + 4 <= frames; f += 4) {
+            f32x4 l = load4(left + f);
+            f32x4 r = load4(right + f);
+            store4(dst + f * 2, __builtin_shufflevector(l, r, 0, 4, 1, 5));
+            store4(dst + f * 2 + 4, __builtin_shufflevector(l, r, 2, 6, 3, 7));
+        }
+    }
+    // Writes stay sequential; the reads walk `channels` streams side by side
+    for (; f < frames; ++f) {
+        float* frame = dst + f * channels;
+        for (int ch = 0; ch < channels; ++ch) frame[ch] = planes[ch][f];
+    }
+}
+
+void deinterleave(const float* src, int channels, size_t frames, float* const* planes) {
+    if (channels == 1) {
+        std::memcpy(planes[0], src, frames * sizeof(float));
+        return;
+    }
+
+    size_t f = 0;
+    if (channels == 2) {
+        float* left = planes[0];
+        float* right = planes[1];
+        for (; f + 4 <= frames; f += 4) {
+            f32x4 a = load4(src + f * 2);
+            f32x4 b = load4(src + f * 2 + 4);
+            store4(left + f, __builtin_shufflevector(a, b, 0, 2, 4, 6));
+            store4(right + f, __builtin_shufflevector(a, b, 1, 3, 5, 7));
+        }
+    }
+    for (; f < frames; ++f) {
+        const float* frame = src + f * channels;
+        for (int ch = 0; ch < channels; ++ch) planes[ch][f] = frame[ch];
+    }
+}
+
+void apply_gain(float* samples, size_t count, float gain) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) store4(samples + i, load4(samples + i) * gain);
+    for (; i < count; ++i) samples[i] *= gain;
+}
+
+void mix_accumulate(float* dst, const float* src, size_t count, float gain) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) store4(dst + i, load4(dst + i) + load4(src + i) * gain);
+    for (; i < count; ++i) dst[i] += src[i] * gain;
+}
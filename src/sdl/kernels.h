@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Sample-format kernels: the per-sample loops that run over whole tracks. Kept apart from
+// their callers so kernel_bench.cpp measures exactly the code the engine ships, natively
+// and as WASM under Node.
+//
+// Buffers may not overlap unless noted. Counts are in samples, frames in sample frames
+// (one sample per channel).
+
+// Signed integer PCM (bitsPerSample significant bits, sign-extended) to -1..1
+void int_to_float(const int32_t* src, float* dst, size_t count, int bitsPerSample);
+
+// Planar channels to interleaved frames, and back
+void interleave(const float* const* planes, int channels, size_t frames, float* dst);
+void deinterleave(const float* src, int channels, size_t frames, float* const* planes);
+
+// samples *= gain, in place
+void apply_gain(float* samples, size_t count, float gain);
+
+// dst += src * gain
+void mix_accumulate(float* dst, const float* src, size_t count, float gain);
@@ -0,0 +1,116 @@
+#include "loudness.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kAbsoluteGate = -70.0;
+constexpr double kRelativeGate = -10.0;
+constexpr int kSubBlocksPerBlock = 4; // 400 ms blocks, 75% overlap
+
+double energy_to_lufs(double energy) {
+    return energy > 0.0 ? -0.691 + 10.0 * std::log10(energy) : -std::numeric_limits<double>::infinity();
+}
+
+} // namespace
+
+LoudnessMeter::LoudnessMeter(uint32_t sampleRate, int channels)
+    : channels_(channels),
+      weights_(channels, 1.0),
+      state_(channels, ChannelState{{0.0, 0.0}, {0.0, 0.0}}),
+      subBlockFrames_(std::max<size_t>(1, sampleRate / 10)) {
+    // K-weighting for any sample rate: the BS.1770 high shelf and high pass, derived from
+    // their analog prototypes (the 48 kHz coefficients in the spec are one instance)
+    const double fs = sampleRate;
+    double f0 = 1681.974450955533;
+    double gain = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = std::tan(kPi * f0 / fs);
+    double vh = std::pow(10.0, gain / 20.0);
+    double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    shelf_ = {(vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+              2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = std::tan(kPi * f0 / fs);
+    a0 = 1.0 + k / q + k * k;
+    highPass_ = {1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+
+    // Surround channels count 1.41x, LFE not at all (WAVE channel order)
+    if (channels == 5) {
+        for (int ch = 3; ch < 5; ++ch) weights_[ch] = 1.41;
+    } else if (channels >= 6) {
+        weights_[3] = 0.0;
+        for (int ch = 4; ch < channels; ++ch) weights_[ch] = 1.41;
+    }
+}
+
+void LoudnessMeter::process(const float* interleaved, size_t frames) {
+    const Biquad& s = shelf_;
+    const Biquad& h = highPass_;
+    for (size_t i = 0; i < frames; ++i) {
+        const float* frame = interleaved + i * channels_;
+        double energy = 0.0;
+        for (int ch = 0; ch < channels_; ++ch) {
+            float x = frame[ch];
+            peak_ = std::max(peak_, std::fabs(x));
+
+            // Two transposed direct form II stages
+            ChannelState& st = state_[ch];
+            double y = s.b0 * x + st.z1[0];
+            st.z1[0] = s.b1 * x - s.a1 * y + st.z2[0];
+            st.z2[0] = s.b2 * x - s.a2 * y;
+            double z = h.b0 * y + st.z1[1];
+            st.z1[1] = h.b1 * y - h.a1 * z + st.z2[1];
+            st.z2[1] = h.b2 * y - h.a2 * z;
+
+            energy += weights_[ch] * z * z;
+        }
+        subBlockEnergy_ += energy;
+        if (++framesInSubBlock_ == subBlockFrames_) {
+            subBlocks_.push_back(subBlockEnergy_ / subBlockFrames_);
+            subBlockEnergy_ = 0.0;
+            framesInSubBlock_ = 0;
+        }
+    }
+}
+
+double LoudnessMeter::integratedLoudness() const {
+    if (subBlocks_.size() < (size_t)kSubBlocksPerBlock) return -std::numeric_limits<double>::infinity();
+
+    std::vector<double> blocks;
+    blocks.reserve(subBlocks_.size() - kSubBlocksPerBlock + 1);
+    double window = 0.0;
+    for (size_t i = 0; i < subBlocks_.size(); ++i) {
+        window += subBlocks_[i];
+        if (i >= (size_t)kSubBlocksPerBlock) window -= subBlocks_[i - kSubBlocksPerBlock];
+        if (i + 1 >= (size_t)kSubBlocksPerBlock) blocks.push_back(window / kSubBlocksPerBlock);
+    }
+
+    double sum = 0.0;
+    size_t count = 0;
+    for (double e : blocks) {
+        if (energy_to_lufs(e) > kAbsoluteGate) {
+            sum += e;
+            ++count;
+        }
+    }
+    if (count == 0) return -std::numeric_limits<double>::infinity();
+
+    double relativeGate = energy_to_lufs(sum / count) + kRelativeGate;
+    sum = 0.0;
+    count = 0;
+    for (double e : blocks) {
+        double lufs = energy_to_lufs(e);
+        if (lufs > kAbsoluteGate && lufs > relativeGate) {
+            sum += e;
+            ++count;
+        }
+    }
+    return count > 0 ? energy_to_lufs(sum / count) : -std::numeric_limits<double>::infinity();
+}
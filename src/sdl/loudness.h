@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Integrated loudness (ITU-R BS.1770-4 / EBU R128) and sample peak of a whole track, for
+// the library scanner. K-weighting per channel, 400 ms blocks on a 100 ms hop, absolute
+// gate at -70 LUFS and relative gate 10 LU below the ungated mean.
+
+class LoudnessMeter {
+public:
+    LoudnessMeter(uint32_t sampleRate, int channels);
+
+    // Feeds interleaved frames; may be called in pieces of any size
+    void process(const float* interleaved, size_t frames);
+
+    // LUFS; -infinity for silence or anything shorter than one block
+    double integratedLoudness() const;
+    // Largest absolute sample, linear
+    float samplePeak() const { return peak_; }
+
+private:
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+    struct ChannelState {
+        double z1[2];
+        double z2[2];
+    };
+
+    Biquad shelf_;
+    Biquad highPass_;
+    int channels_;
+    std::vector<double> weights_;
+    std::vector<ChannelState> state_;
+    // Weighted mean-square energy of each finished 100 ms sub-block
+    std::vector<double> subBlocks_;
+    size_t subBlockFrames_;
+    size_t framesInSubBlock_ = 0;
+    double subBlockEnergy_ = 0.0;
+    float peak_ = 0.0f;
+};
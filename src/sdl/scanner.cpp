@@ -0,0 +1,404 @@
+// flac-scan: native library scanner. Walks a directory tree, decodes every FLAC with the
+// same decoder and analysis code the engine build uses, and writes per-track sidecars so the
+// player has durations, loudness, seek points and waveforms without computing them on load.
+//
+//   flac-scan <directory> [--threads N] [--io-threads N] [--read-ahead MB] [--force]
+//
+// I/O threads read whole files into memory ahead of the decoders (bounded by --read-ahead)
+// and ask the kernel to start reading the files after that; decoder threads never touch the
+// disk except to write sidecars, and decode a chunk at a time rather than whole tracks.
+//
+// Next to each track.flac it writes track.flac.idx: stream info, integrated loudness, sample
+// peak, silence bounds, seek points, the waveform pyramid and a thumbnail spectrogram, in
+// the layout the player reads in place (see track_index.h).
+
+#include "flac_decoder.h"
+#include "loudness.h"
+#include "track_index.h"
+#include "waveform.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// One seek point per this many seconds of audio: the FLAC frame containing that time
+constexpr double kSeekIntervalSeconds = 1.0;
+// Files to hint to the kernel beyond the one being read
+constexpr size_t kHintAhead = 8;
+// Decoded audio a worker gathers before handing it to the analyses
+constexpr size_t kDecodeChunkFrames = 1 << 16;
+
+struct Options {
+    fs::path root;
+    unsigned threads = 0;
+    unsigned ioThreads = 2;
+    size_t readAheadBytes = 256u << 20;
+    bool force = false;
+};
+
+struct Job {
+    fs::path path;
+    std::vector<uint8_t> bytes;
+};
+
+// Read files waiting for a decoder. Bounded by bytes rather than count, so a run of large
+// files can't fill memory; a single file larger than the bound still goes through.
+class JobQueue {
+public:
+    explicit JobQueue(size_t maxBytes) : maxBytes_(maxBytes) {}
+
+    void push(Job job) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        spaceFree_.wait(lock, [&] { return jobs_.empty() || queuedBytes_ + job.bytes.size() <= maxBytes_; });
+        queuedBytes_ += job.bytes.size();
+        jobs_.push_back(std::move(job));
+        jobReady_.notify_one();
+    }
+
+    // False once the queue is closed and drained
+    bool pop(Job& job) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        jobReady_.wait(lock, [&] { return !jobs_.empty() || closed_; });
+        if (jobs_.empty()) return false;
+        job = std::move(jobs_.front());
+        jobs_.pop_front();
+        queuedBytes_ -= job.bytes.size();
+        spaceFree_.notify_all();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        jobReady_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable jobReady_;
+    std::condition_variable spaceFree_;
+    std::deque<Job> jobs_;
+    size_t queuedBytes_ = 0;
+    size_t maxBytes_;
+    bool closed_ = false;
+};
+
+struct Stats {
+    std::atomic<size_t> done{0};
+    std::atomic<size_t> failed{0};
+    std::atomic<uint64_t> bytesRead{0};
+    // Decoded audio, in milliseconds, for the realtime factor
+    std::atomic<uint64_t> audioMs{0};
+};
+
+// Starts kernel read-ahead for a file the I/O threads will get to soon
+void hint_read_ahead(const fs::path& path) {
+#ifdef POSIX_FADV_WILLNEED
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    ::close(fd);
+#else
+    (void)path;
+#endif
+}
+
+bool read_file(const fs::path& path, std::vector<uint8_t>& bytes) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    std::error_code ec;
+    uintmax_t size = fs::file_size(path, ec);
+    bytes.resize(ec ? 0 : (size_t)size);
+    size_t filled = 0;
+    while (filled < bytes.size()) {
+        ssize_t n = ::read(fd, bytes.data() + filled, bytes.size() - filled);
+        if (n <= 0) break;
+        filled += (size_t)n;
+    }
+    ::close(fd);
+    bytes.resize(filled);
+    return filled == size;
+}
+
+// Writes through a temporary name, so a reader never sees half a sidecar
+bool write_file(const fs::path& path, const void* data, size_t size) {
+    fs::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(static_cast<const char*>(data), (std::streamsize)size);
+        if (!out) return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    return !ec;
+}
+
+fs::path sidecar(const fs::path& track, const char* extension) {
+    fs::path path = track;
+    path += extension;
+    return path;
+}
+
+bool is_flac(const fs::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return ext == ".flac";
+}
+
+// An index at least as new as the track means it was already scanned
+bool up_to_date(const fs::path& track) {
+    std::error_code ec;
+    auto trackTime = fs::last_write_time(track, ec);
+    if (ec) return false;
+    auto sidecarTime = fs::last_write_time(sidecar(track, ".idx"), ec);
+    return !ec && sidecarTime >= trackTime;
+}
+
+// Frames counted without keeping any audio, for streams whose STREAMINFO leaves the length
+// out (the pyramid and the spectrogram need it before the first sample)
+bool count_frames(FlacDecoder& decoder, uint64_t& frames) {
+    std::vector<float> scratch;
+    FlacFrameInfo frame;
+    frames = 0;
+    while (decoder.decodeNext(scratch, &frame)) {
+        frames = frame.firstFrame + scratch.size() / decoder.info().channels;
+        scratch.clear();
+    }
+    decoder.rewind();
+    return decoder.error().empty();
+}
+
+// Decodes the track a chunk of FLAC frames at a time and feeds each chunk to every
+// analysis, so a worker holds at most kDecodeChunkFrames of decoded audio whatever the
+// track length
+bool scan_track(const Job& job, Stats& stats, std::string& error) {
+    FlacDecoder decoder;
+    if (!decoder.open(job.bytes.data(), job.bytes.size())) {
+        error = decoder.error();
+        return false;
+    }
+    const FlacStreamInfo& info = decoder.info();
+    uint64_t totalFrames = info.totalFrames;
+    if (totalFrames == 0 && !count_frames(decoder, totalFrames)) {
+        error = decoder.error();
+        return false;
+    }
+    if (totalFrames == 0) {
+        error = "no audio";
+        return false;
+    }
+
+    TrackIndexContent index;
+    index.sampleRate = info.sampleRate;
+    index.channels = info.channels;
+    index.bitsPerSample = info.bitsPerSample;
+    index.totalFrames = totalFrames;
+    index.seekIntervalFrames = (uint64_t)std::llround(kSeekIntervalSeconds * info.sampleRate);
+
+    LoudnessMeter meter(info.sampleRate, info.channels);
+    WaveformPyramid pyramid;
+    pyramid.begin(totalFrames, info.channels);
+    SilenceScan silence;
+    SpectrogramBuilder spectrogram(totalFrames);
+
+    std::vector<float> chunk;
+    chunk.reserve((kDecodeChunkFrames + info.maxBlockSize) * info.channels);
+    auto feed = [&] {
+        size_t frames = chunk.size() / info.channels;
+        meter.process(chunk.data(), frames);
+        pyramid.append(chunk.data(), frames);
+        silence.process(chunk.data(), frames, info.channels);
+        spectrogram.process(chunk.data(), frames, info.channels);
+        chunk.clear();
+    };
+
+    // The FLAC frame holding each whole second, so a seek can start decoding right there
+    uint64_t nextSeekTarget = 0;
+    FlacFrameInfo frame;
+    for (size_t decoded = 0; decoder.decodeNext(chunk, &frame); decoded = chunk.size()) {
+        uint64_t frameEnd = frame.firstFrame + (chunk.size() - decoded) / info.channels;
+        for (; nextSeekTarget < frameEnd; nextSeekTarget += index.seekIntervalFrames) {
+            index.seekPoints.push_back({(double)frame.firstFrame, (double)frame.byteOffset});
+        }
+        if (chunk.size() >= kDecodeChunkFrames * (size_t)info.channels) feed();
+    }
+    if (!decoder.error().empty()) {
+        error = decoder.error();
+        return false;
+    }
+    feed();
+
+    index.integratedLufs = (float)meter.integratedLoudness();
+    index.samplePeak = meter.samplePeak();
+    index.waveform = pyramid.header();
+    index.waveformBytes = pyramid.byteLength();
+    index.silenceStart = silence.start();
+    index.silenceEnd = silence.end();
+    index.spectrogram = spectrogram.finish();
+
+    std::vector<uint8_t> file = build_track_index(index);
+    if (!write_file(sidecar(job.path, ".idx"), file.data(), file.size())) {
+        error = "could not write index";
+        return false;
+    }
+
+    stats.audioMs += (uint64_t)(totalFrames * 1000 / info.sampleRate);
+    return true;
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](const char* name) -> const char* {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "%s needs a value\n", name);
+                return nullptr;
+            }
+            return argv[++i];
+        };
+        if (arg == "--threads" || arg == "--io-threads" || arg == "--read-ahead") {
+            const char* v = value(arg.c_str());
+            if (!v) return false;
+            unsigned long n = std::strtoul(v, nullptr, 10);
+            if (arg == "--threads") options.threads = (unsigned)n;
+            else if (arg == "--io-threads") options.ioThreads = std::max(1u, (unsigned)n);
+            else options.readAheadBytes = (size_t)n << 20;
+        } else if (arg == "--force") {
+            options.force = true;
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        } else {
+            options.root = arg;
+        }
+    }
+    return !options.root.empty();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        std::fprintf(stderr, "usage: flac-scan <directory> [--threads N] [--io-threads N] [--read-ahead MB] [--force]\n");
+        return 2;
+    }
+    if (options.threads == 0) options.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<fs::path> files;
+    size_t skipped = 0;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(options.root, fs::directory_options::skip_permission_denied, ec), end;
+         it != end; it.increment(ec)) {
+        if (ec) break;
+        if (!it->is_regular_file(ec) || !is_flac(it->path())) continue;
+        if (!options.force && up_to_date(it->path())) {
+            ++skipped;
+            continue;
+        }
+        files.push_back(it->path());
+    }
+    if (ec) {
+        std::fprintf(stderr, "%s: %s\n", options.root.c_str(), ec.message().c_str());
+        return 1;
+    }
+    // Directory order keeps reads on a NAS close together
+    std::sort(files.begin(), files.end());
+    std::fprintf(stderr, "%zu files to scan, %zu up to date\n", files.size(), skipped);
+
+    Stats stats;
+    JobQueue queue(options.readAheadBytes);
+    std::mutex logMutex;
+    const auto started = std::chrono::steady_clock::now();
+
+    std::atomic<size_t> nextFile{0};
+    std::vector<std::thread> readers;
+    for (unsigned t = 0; t < options.ioThreads; ++t) {
+        readers.emplace_back([&] {
+            for (size_t i; (i = nextFile.fetch_add(1)) < files.size();) {
+                if (i + kHintAhead < files.size()) hint_read_ahead(files[i + kHintAhead]);
+                Job job{files[i], {}};
+                if (!read_file(job.path, job.bytes)) {
+                    std::lock_guard<std::mutex> lock(logMutex);
+                    std::fprintf(stderr, "%s: read failed\n", job.path.c_str());
+                    ++stats.failed;
+                    continue;
+                }
+                stats.bytesRead += job.bytes.size();
+                queue.push(std::move(job));
+            }
+        });
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < options.threads; ++t) {
+        workers.emplace_back([&] {
+            Job job;
+            std::string error;
+            while (queue.pop(job)) {
+                if (scan_track(job, stats, error)) {
+                    ++stats.done;
+                } else {
+                    std::lock_guard<std::mutex> lock(logMutex);
+                    std::fprintf(stderr, "%s: %s\n", job.path.c_str(), error.c_str());
+                    ++stats.failed;
+                }
+                job = Job();
+            }
+        });
+    }
+
+    auto report = [&](const char* prefix, const char* suffix) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        size_t finished = stats.done + stats.failed;
+        std::lock_guard<std::mutex> lock(logMutex);
+        std::fprintf(stderr, "%s%zu/%zu files (%zu failed), %.1f files/s, %.1f MB/s, %.0fx realtime%s",
+                     prefix, finished, files.size(), stats.failed.load(),
+                     seconds > 0 ? stats.done / seconds : 0.0,
+                     seconds > 0 ? stats.bytesRead / 1e6 / seconds : 0.0,
+                     seconds > 0 ? stats.audioMs / 1000.0 / seconds : 0.0, suffix);
+    };
+
+    // Progress line while the pool works
+    std::atomic<bool> finished{false};
+    std::thread progress([&] {
+        if (!isatty(STDERR_FILENO)) return;
+        for (int tick = 1; !finished; ++tick) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (tick % 10 == 0 && !finished) report("\r", "   ");
+        }
+    });
+
+    for (std::thread& t : readers) t.join();
+    queue.close();
+    for (std::thread& t : workers) t.join();
+    finished = true;
+    progress.join();
+
+    report(isatty(STDERR_FILENO) ? "\r" : "", "\n");
+    return stats.failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Four lanes of float; GCC/Clang vector extensions, lowered to WASM SIMD with -msimd128
+// and to SSE/NEON natively
+typedef float f32x4 __attribute__((vector_size(16)));
+typedef int32_t i32x4 __attribute__((vector_size(16)));
+
+inline f32x4 load4(const float* p) {
+    f32x4 v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline i32x4 load4(const int32_t* p) {
+    i32x4 v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void store4(float* p, f32x4 v) {
+    std::memcpy(p, &v, sizeof(v));
+}
+
+inline float sum4(f32x4 v) {
+    return v[0] + v[1] + v[2] + v[3];
+}
@@ -0,0 +1,51 @@
+// Stand-in for the slice of the SDL3 audio API audio_engine.cpp uses, so the engine can be
+// built and driven natively by engine_test.cpp (which also defines these functions). The
+// names, types and signatures follow SDL3; nothing here plays sound.
+#pragma once
+
+#include <cstdint>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t SDL_InitFlags;
+typedef uint32_t SDL_AudioDeviceID;
+typedef enum SDL_AudioFormat { SDL_AUDIO_F32 = 0x8120u } SDL_AudioFormat;
+
+#define SDL_INIT_AUDIO 0x00000010u
+#define SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK ((SDL_AudioDeviceID)0xFFFFFFFFu)
+
+typedef struct SDL_AudioSpec {
+    SDL_AudioFormat format;
+    int channels;
+    int freq;
+} SDL_AudioSpec;
+
+typedef struct SDL_AudioStream SDL_AudioStream;
+typedef void (*SDL_AudioStreamCallback)(void* userdata, SDL_AudioStream* stream, int additional_amount,
+                                        int total_amount);
+
+bool SDL_Init(SDL_InitFlags flags);
+void SDL_Quit(void);
+const char* SDL_GetError(void);
+
+SDL_AudioDeviceID SDL_OpenAudioDevice(SDL_AudioDeviceID devid, const SDL_AudioSpec* spec);
+void SDL_CloseAudioDevice(SDL_AudioDeviceID devid);
+bool SDL_GetAudioDeviceFormat(SDL_AudioDeviceID devid, SDL_AudioSpec* spec, int* sample_frames);
+bool SDL_PauseAudioDevice(SDL_AudioDeviceID devid);
+bool SDL_ResumeAudioDevice(SDL_AudioDeviceID devid);
+
+SDL_AudioStream* SDL_CreateAudioStream(const SDL_AudioSpec* src_spec, const SDL_AudioSpec* dst_spec);
+void SDL_DestroyAudioStream(SDL_AudioStream* stream);
+bool SDL_BindAudioStream(SDL_AudioDeviceID devid, SDL_AudioStream* stream);
+bool SDL_SetAudioStreamGetCallback(SDL_AudioStream* stream, SDL_AudioStreamCallback callback, void* userdata);
+bool SDL_PutAudioStreamData(SDL_AudioStream* stream, const void* buf, int len);
+bool SDL_ClearAudioStream(SDL_AudioStream* stream);
+int SDL_GetAudioStreamAvailable(SDL_AudioStream* stream);
+int SDL_GetAudioStreamQueued(SDL_AudioStream* stream);
+bool SDL_SetAudioStreamGain(SDL_AudioStream* stream, float gain);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,7 @@
+// Stand-in for <emscripten.h> in the native engine test: exports are plain functions and
+// EM_JS bodies are replaced by a function returning 0 (only engine_clock_now uses it).
+#pragma once
+
+#define EMSCRIPTEN_KEEPALIVE
+#define EM_JS(ret, name, params, ...) \
+    ret name params { return 0; }
@@ -0,0 +1,145 @@
+#include "track_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+size_t align8(size_t offset) {
+    return (offset + 7) & ~(size_t)7;
+}
+
+} // namespace
+
+std::vector<uint8_t> build_track_index(const TrackIndexContent& content) {
+    TrackIndexHeader header = {};
+    header.magic = TRACK_INDEX_MAGIC;
+    header.version = TRACK_INDEX_VERSION;
+    header.headerBytes = sizeof(TrackIndexHeader);
+    header.sampleRate = content.sampleRate;
+    header.channels = (uint32_t)content.channels;
+    header.bitsPerSample = (uint32_t)content.bitsPerSample;
+    header.seekCount = (uint32_t)content.seekPoints.size();
+    header.totalFrames = (double)content.totalFrames;
+    header.silenceStart = (double)content.silenceStart;
+    header.silenceEnd = (double)content.silenceEnd;
+    header.seekIntervalFrames = (double)content.seekIntervalFrames;
+    header.integratedLufs = content.integratedLufs;
+    header.samplePeak = content.samplePeak;
+    header.spectrogramColumns = TRACK_INDEX_SPECTROGRAM_COLUMNS;
+    header.spectrogramBands = TRACK_INDEX_SPECTROGRAM_BANDS;
+
+    const size_t sizes[TRACK_INDEX_SECTIONS] = {
+        content.seekPoints.size() * sizeof(TrackIndexSeekPoint),
+        content.waveformBytes,
+        content.spectrogram.size(),
+    };
+    size_t offset = sizeof(TrackIndexHeader);
+    for (uint32_t s = 0; s < TRACK_INDEX_SECTIONS; ++s) {
+        offset = align8(offset);
+        header.sections[s] = {(uint32_t)offset, (uint32_t)sizes[s]};
+        offset += sizes[s];
+    }
+    header.fileBytes = (uint32_t)offset;
+
+    std::vector<uint8_t> file(offset, 0);
+    std::memcpy(file.data(), &header, sizeof(header));
+    if (sizes[TRACK_INDEX_SEEK] > 0) {
+        std::memcpy(file.data() + header.sections[TRACK_INDEX_SEEK].offset, content.seekPoints.data(), sizes[TRACK_INDEX_SEEK]);
+    }
+    if (content.waveform) {
+        std::memcpy(file.data() + header.sections[TRACK_INDEX_WAVEFORM].offset, content.waveform, sizes[TRACK_INDEX_WAVEFORM]);
+    }
+    if (sizes[TRACK_INDEX_SPECTROGRAM] > 0) {
+        std::memcpy(file.data() + header.sections[TRACK_INDEX_SPECTROGRAM].offset, content.spectrogram.data(),
+                    sizes[TRACK_INDEX_SPECTROGRAM]);
+    }
+    return file;
+}
+
+void SilenceScan::process(const float* interleaved, size_t frames, int channels) {
+    for (size_t f = 0; f < frames; ++f) {
+        const float* src = interleaved + f * channels;
+        for (int ch = 0; ch < channels; ++ch) {
+            if (std::fabs(src[ch]) > TRACK_INDEX_SILENCE_THRESHOLD) {
+                if (!found_) first_ = seen_ + f;
+                found_ = true;
+                last_ = seen_ + f + 1;
+                break;
+            }
+        }
+    }
+    seen_ += frames;
+}
+
+SpectrogramBuilder::SpectrogramBuilder(uint64_t totalFrames)
+    : totalFrames_(totalFrames),
+      analyzer_(0.0f),
+      thumbnail_((size_t)TRACK_INDEX_SPECTROGRAM_COLUMNS * TRACK_INDEX_SPECTROGRAM_BANDS, 0) {
+    // Band edges in bins, log-spaced so the bottom octaves aren't squeezed into one band
+    edges_[0] = 1;
+    for (int b = 1; b <= TRACK_INDEX_SPECTROGRAM_BANDS; ++b) {
+        int edge = (int)std::lround(std::pow((double)SPECTRUM_BINS, (double)b / TRACK_INDEX_SPECTROGRAM_BANDS));
+        edges_[b] = std::min(SPECTRUM_BINS, std::max(edge, edges_[b - 1] + 1));
+    }
+}
+
+// A window centered on the middle of the column's stretch of the track, cut off at its end
+int64_t SpectrogramBuilder::windowEnd(int column) const {
+    uint64_t center = (uint64_t)(((double)column + 0.5) * totalFrames_ / TRACK_INDEX_SPECTROGRAM_COLUMNS);
+    return (int64_t)std::min<uint64_t>(totalFrames_, center + SPECTRUM_FFT_SIZE / 2);
+}
+
+void SpectrogramBuilder::process(const float* interleaved, size_t frames, int channels) {
+    const int64_t first = (int64_t)seen_;
+    const int64_t last = first + (int64_t)frames;
+    seen_ += frames;
+
+    // Open every window that starts before this piece ends
+    while (nextColumn_ < TRACK_INDEX_SPECTROGRAM_COLUMNS && windowEnd(nextColumn_) - SPECTRUM_FFT_SIZE < last) {
+        std::vector<float> mono;
+        if (!spare_.empty()) {
+            mono = std::move(spare_.back());
+            spare_.pop_back();
+        }
+        mono.assign(SPECTRUM_FFT_SIZE, 0.0f);
+        open_.push_back({nextColumn_, windowEnd(nextColumn_) - SPECTRUM_FFT_SIZE, std::move(mono)});
+        ++nextColumn_;
+    }
+
+    const float channelScale = 1.0f / channels;
+    for (size_t w = 0; w < open_.size();) {
+        Window& window = open_[w];
+        const int64_t windowLast = window.start + SPECTRUM_FFT_SIZE;
+        for (int64_t f = std::max(first, window.start); f < std::min(last, windowLast); ++f) {
+            const float* src = interleaved + (size_t)(f - first) * channels;
+            float sample = 0.0f;
+            for (int ch = 0; ch < channels; ++ch) sample += src[ch];
+            window.mono[(size_t)(f - window.start)] = sample * channelScale;
+        }
+        if (windowLast <= last) {
+            analyse(window);
+            spare_.push_back(std::move(window.mono));
+            open_.erase(open_.begin() + (long)w);
+        } else {
+            ++w;
+        }
+    }
+}
+
+std::vector<uint8_t> SpectrogramBuilder::finish() {
+    for (Window& window : open_) analyse(window);
+    open_.clear();
+    spare_.clear();
+    return std::move(thumbnail_);
+}
+
+void SpectrogramBuilder::analyse(Window& window) {
+    analyzer_.update(window.mono.data(), SPECTRUM_FFT_SIZE, 1, SPECTRUM_FFT_SIZE);
+    const uint8_t* bins = analyzer_.block()->bins;
+    uint8_t* column = thumbnail_.data() + (size_t)window.column * TRACK_INDEX_SPECTROGRAM_BANDS;
+    for (int b = 0; b < TRACK_INDEX_SPECTROGRAM_BANDS; ++b) {
+        column[b] = *std::max_element(bins + edges_[b], bins + edges_[b + 1]);
+    }
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "analysis.h"
+#include "waveform.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per-track index written by the library scanner as `track.flac.idx` and fetched by the
+// player next to the audio. Everything the player would otherwise compute on load is laid
+// out so it can be used where it lies: the header and every section sit at fixed, aligned
+// offsets, so a fetched ArrayBuffer (or an mmap'd file) is read through typed views with
+// no parsing pass (see src/trackIndex.ts).
+//
+// All fields are little-endian. Sections start on 8-byte boundaries.
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "track index files are little-endian; writing them needs byte swapping on this target"
+#endif
+
+constexpr uint32_t TRACK_INDEX_MAGIC = 0x58444946; // "FIDX"
+constexpr uint32_t TRACK_INDEX_VERSION = 1;
+
+// Thumbnail spectrogram: columns across the whole track, log-spaced bands per column
+constexpr int TRACK_INDEX_SPECTROGRAM_COLUMNS = 256;
+constexpr int TRACK_INDEX_SPECTROGRAM_BANDS = 64;
+// Silence bounds: first and last frame with any channel above this level (-60 dBFS)
+constexpr float TRACK_INDEX_SILENCE_THRESHOLD = 0.001f;
+
+enum TrackIndexSection : uint32_t {
+    TRACK_INDEX_SEEK = 0,        // f64 (frame, byteOffset) pairs, ascending
+    TRACK_INDEX_WAVEFORM = 1,    // WaveformHeader + levels, as in WASM memory, complete
+    TRACK_INDEX_SPECTROGRAM = 2, // u8 [columns][bands], AnalyserNode byte scale, low band first
+    TRACK_INDEX_SECTIONS = 3,
+};
+
+struct TrackIndexSectionRef {
+    uint32_t offset; // bytes from the start of the file
+    uint32_t bytes;
+};
+
+// Layout mirrors src/trackIndex.ts. Frame counts and positions are f64 so they are exact
+// past 2^32 and readable from a Float64Array without combining halves.
+struct TrackIndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerBytes;
+    uint32_t fileBytes;
+    uint32_t sampleRate;
+    uint32_t channels;
+    uint32_t bitsPerSample;
+    uint32_t seekCount;
+    double totalFrames;
+    double silenceStart; // first audible frame
+    double silenceEnd;   // one past the last audible frame; equal to silenceStart if none
+    double seekIntervalFrames;
+    float integratedLufs; // -infinity for silence or tracks shorter than 400 ms
+    float samplePeak;     // linear
+    uint32_t spectrogramColumns;
+    uint32_t spectrogramBands;
+    TrackIndexSectionRef sections[TRACK_INDEX_SECTIONS];
+    uint32_t reserved[6];
+};
+static_assert(sizeof(TrackIndexHeader) == 128, "TrackIndexHeader layout is shared with JS");
+
+struct TrackIndexSeekPoint {
+    double frame;
+    double byteOffset;
+};
+static_assert(sizeof(TrackIndexSeekPoint) == 16, "seek points are read as a Float64Array");
+
+// Everything measured about a track, gathered by the caller
+struct TrackIndexContent {
+    uint32_t sampleRate = 0;
+    int channels = 0;
+    int bitsPerSample = 0;
+    uint64_t totalFrames = 0;
+    uint64_t silenceStart = 0;
+    uint64_t silenceEnd = 0;
+    uint64_t seekIntervalFrames = 0;
+    float integratedLufs = 0.0f;
+    float samplePeak = 0.0f;
+    std::vector<TrackIndexSeekPoint> seekPoints;
+    const WaveformHeader* waveform = nullptr; // a finished pyramid
+    size_t waveformBytes = 0;
+    std::vector<uint8_t> spectrogram; // TRACK_INDEX_SPECTROGRAM_COLUMNS * _BANDS bytes
+};
+
+// Serializes `content` into the index file layout
+std::vector<uint8_t> build_track_index(const TrackIndexContent& content);
+
+// The analyses below take the track as it is decoded: interleaved pieces, in order, of a
+// track whose length is known up front. Only what they report is kept, never the track.
+
+// First and last audible frame of a track
+class SilenceScan {
+public:
+    void process(const float* interleaved, size_t frames, int channels);
+
+    // The audible range [start, end) in frames; both are the track length for silence
+    uint64_t start() const { return found_ ? first_ : seen_; }
+    uint64_t end() const { return found_ ? last_ : seen_; }
+
+private:
+    uint64_t seen_ = 0;
+    uint64_t first_ = 0;
+    uint64_t last_ = 0;
+    bool found_ = false;
+};
+
+// Thumbnail spectrogram, TRACK_INDEX_SPECTROGRAM_COLUMNS columns of
+// TRACK_INDEX_SPECTROGRAM_BANDS bands, each the loudest AnalyserNode bin in the band. Each
+// column analyses the SPECTRUM_FFT_SIZE frames around the middle of its stretch of the
+// track; those windows are collected (downmixed) as the track goes by, so at most a few
+// are held at once.
+class SpectrogramBuilder {
+public:
+    explicit SpectrogramBuilder(uint64_t totalFrames);
+
+    void process(const float* interleaved, size_t frames, int channels);
+
+    // [columns][bands]; columns the track never reached stay silent
+    std::vector<uint8_t> finish();
+
+private:
+    struct Window {
+        int column;
+        int64_t start; // may be before the track: that part stays zero
+        std::vector<float> mono;
+    };
+
+    int64_t windowEnd(int column) const;
+    void analyse(Window& window);
+
+    uint64_t totalFrames_;
+    uint64_t seen_ = 0;
+    int nextColumn_ = 0;
+    std::vector<Window> open_;
+    std::vector<std::vector<float>> spare_;
+    int edges_[TRACK_INDEX_SPECTROGRAM_BANDS + 1];
+    SpectrumAnalyzer analyzer_;
+    std::vector<uint8_t> thumbnail_;
+};
@@ -0,0 +1,142 @@
+#include "waveform.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+int8_t quantize(float sample) {
+    float scaled = std::round(std::clamp(sample, -1.0f, 1.0f) * 127.0f);
+    return (int8_t)scaled;
+}
+
+} // namespace
+
+void WaveformPyramid::begin(const float* interleaved, size_t frames, int channels) {
+    if (!interleaved) {
+        reset();
+        return;
+    }
+    begin(frames, channels);
+    samples_ = interleaved;
+}
+
+void WaveformPyramid::begin(size_t frames, int channels) {
+    reset();
+    if (frames == 0 || channels <= 0) return;
+
+    WaveformHeader layout = {};
+    layout.bucketFrames = WAVEFORM_BUCKET_FRAMES;
+    layout.totalFrames = (uint32_t)frames;
+
+    size_t offset = sizeof(WaveformHeader);
+    uint32_t buckets = (uint32_t)((frames + WAVEFORM_BUCKET_FRAMES - 1) / WAVEFORM_BUCKET_FRAMES);
+    int count = 0;
+    while (count < WAVEFORM_MAX_LEVELS) {
+        layout.levelOffset[count] = (uint32_t)offset;
+        layout.levelBuckets[count] = buckets;
+        offset += (size_t)buckets * 2;
+        ++count;
+        if (buckets <= 1) break;
+        buckets = (buckets + 1) / 2;
+    }
+    layout.levelCount = (uint32_t)count;
+
+    storage_.assign(offset, 0);
+    std::memcpy(storage_.data(), &layout, sizeof(layout));
+    channels_ = channels;
+}
+
+bool WaveformPyramid::step(size_t maxFrames) {
+    if (empty()) return true;
+    WaveformHeader* h = header();
+    if (h->builtFrames >= h->totalFrames || !samples_) return h->builtFrames >= h->totalFrames;
+
+    // Whole level-0 buckets only, except for the track's last one
+    size_t start = h->builtFrames;
+    size_t end = std::min<size_t>(h->totalFrames, start + std::max<size_t>(maxFrames, WAVEFORM_BUCKET_FRAMES));
+    if (end < h->totalFrames) end -= end % WAVEFORM_BUCKET_FRAMES;
+
+    int8_t* base = level(0);
+    for (size_t bucketStart = start; bucketStart < end; bucketStart += WAVEFORM_BUCKET_FRAMES) {
+        size_t bucketEnd = std::min<size_t>(end, bucketStart + WAVEFORM_BUCKET_FRAMES);
+        const float* src = samples_ + bucketStart * channels_;
+        const float* srcEnd = samples_ + bucketEnd * channels_;
+        float lo = src[0], hi = src[0];
+        for (const float* p = src; p < srcEnd; ++p) {
+            lo = std::min(lo, *p);
+            hi = std::max(hi, *p);
+        }
+        size_t bucket = bucketStart / WAVEFORM_BUCKET_FRAMES;
+        base[bucket * 2] = quantize(lo);
+        base[bucket * 2 + 1] = quantize(hi);
+    }
+    h->builtFrames = (uint32_t)end;
+
+    bool complete = end >= h->totalFrames;
+    propagate(complete);
+    if (complete) samples_ = nullptr;
+    return complete;
+}
+
+bool WaveformPyramid::append(const float* interleaved, size_t frames) {
+    if (empty()) return true;
+    WaveformHeader* h = header();
+    int8_t* base = level(0);
+    while (frames > 0 && h->builtFrames < h->totalFrames) {
+        if (pendingFrames_ == 0) {
+            pendingLo_ = interleaved[0];
+            pendingHi_ = interleaved[0];
+        }
+        size_t bucketEnd = std::min<size_t>(h->totalFrames, (size_t)h->builtFrames + WAVEFORM_BUCKET_FRAMES);
+        size_t take = std::min(frames, bucketEnd - h->builtFrames - pendingFrames_);
+        for (const float *p = interleaved, *end = interleaved + take * channels_; p < end; ++p) {
+            pendingLo_ = std::min(pendingLo_, *p);
+            pendingHi_ = std::max(pendingHi_, *p);
+        }
+        interleaved += take * channels_;
+        frames -= take;
+        pendingFrames_ += (uint32_t)take;
+
+        if (h->builtFrames + pendingFrames_ < bucketEnd) break;
+        size_t bucket = h->builtFrames / WAVEFORM_BUCKET_FRAMES;
+        base[bucket * 2] = quantize(pendingLo_);
+        base[bucket * 2 + 1] = quantize(pendingHi_);
+        h->builtFrames = (uint32_t)bucketEnd;
+        pendingFrames_ = 0;
+    }
+
+    bool complete = h->builtFrames >= h->totalFrames;
+    propagate(complete);
+    return complete;
+}
+
+// Derives each level's newly complete buckets from pairs in the level below
+void WaveformPyramid::propagate(bool complete) {
+    WaveformHeader* h = header();
+    uint32_t below = complete ? h->levelBuckets[0] : h->builtFrames / WAVEFORM_BUCKET_FRAMES;
+    derived_[0] = below;
+    for (uint32_t l = 1; l < h->levelCount; ++l) {
+        uint32_t ready = complete ? h->levelBuckets[l] : below / 2;
+        const int8_t* src = level(l - 1);
+        int8_t* dst = level(l);
+        for (uint32_t b = derived_[l]; b < ready; ++b) {
+            uint32_t left = b * 2;
+            uint32_t right = std::min(left + 1, h->levelBuckets[l - 1] - 1);
+            dst[b * 2] = std::min(src[left * 2], src[right * 2]);
+            dst[b * 2 + 1] = std::max(src[left * 2 + 1], src[right * 2 + 1]);
+        }
+        derived_[l] = ready;
+        below = ready;
+    }
+}
+
+void WaveformPyramid::reset() {
+    storage_.clear();
+    storage_.shrink_to_fit();
+    samples_ = nullptr;
+    channels_ = 0;
+    pendingFrames_ = 0;
+    std::fill(std::begin(derived_), std::end(derived_), 0u);
+}
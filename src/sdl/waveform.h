@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Min/max overview of the loaded track for the waveform seek bar. Level 0 holds one
+// (min, max) pair per WAVEFORM_BUCKET_FRAMES frames, each level above halves the count, up to
+// a single bucket. The UI picks the level closest to its pixel width and reads it straight
+// out of WASM memory (see src/waveformPyramid.ts, which also builds the same layout in JS).
+//
+// The pyramid is built in steps so a long track never blocks the main thread for long; every
+// level is valid up to `builtFrames` after each step.
+
+constexpr int WAVEFORM_BUCKET_FRAMES = 256;
+constexpr int WAVEFORM_MAX_LEVELS = 24;
+
+// Layout mirrors src/waveformPyramid.ts:
+//   u32 levelCount | u32 bucketFrames | u32 totalFrames | u32 builtFrames |
+//   u32 levelOffset[24] | u32 levelBuckets[24] | i8 data[]
+// Offsets are in bytes from the start of the header; each bucket is an i8 (min, max) pair
+// of samples scaled to -127..127, taken across all channels.
+struct WaveformHeader {
+    uint32_t levelCount;
+    uint32_t bucketFrames;
+    uint32_t totalFrames;
+    uint32_t builtFrames;
+    uint32_t levelOffset[WAVEFORM_MAX_LEVELS];
+    uint32_t levelBuckets[WAVEFORM_MAX_LEVELS];
+};
+static_assert(sizeof(WaveformHeader) == 16 + 8 * WAVEFORM_MAX_LEVELS, "WaveformHeader layout is shared with JS");
+
+class WaveformPyramid {
+public:
+    // Sizes the pyramid for a track; the samples must stay valid until the build is done
+    void begin(const float* interleaved, size_t frames, int channels);
+
+    // Summarizes up to `maxFrames` more frames; returns true once the whole track is done
+    bool step(size_t maxFrames);
+
+    // The same without the track in memory (the scanner decodes a piece at a time): sizes the
+    // pyramid for `frames` frames, which then arrive in order through append()
+    void begin(size_t frames, int channels);
+    // Summarizes the next `frames` frames; pieces may end mid-bucket. Returns true once the
+    // whole track is done.
+    bool append(const float* interleaved, size_t frames);
+
+    void reset();
+
+    bool empty() const { return storage_.empty(); }
+    WaveformHeader* header() { return reinterpret_cast<WaveformHeader*>(storage_.data()); }
+    // Header and all levels
+    size_t byteLength() const { return storage_.size(); }
+
+private:
+    int8_t* level(int index) { return reinterpret_cast<int8_t*>(storage_.data() + header()->levelOffset[index]); }
+    void propagate(bool complete);
+
+    // Header and level data in one block, so JS sees a single pointer
+    std::vector<uint8_t> storage_;
+    const float* samples_ = nullptr;
+    int channels_ = 0;
+    // Buckets already derived per level, for incremental propagation
+    uint32_t derived_[WAVEFORM_MAX_LEVELS] = {};
+    // append(): the level-0 bucket still being filled
+    uint32_t pendingFrames_ = 0;
+    float pendingLo_ = 0.0f;
+    float pendingHi_ = 0.0f;
+};
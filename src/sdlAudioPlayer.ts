@@ -1,17 +1,42 @@
 import { FlacDecoder } from './flacDecoder';
 import { PlayerState } from './audioPlayer';
+import { PlayerStateSnapshot, PlayerStateSource, StateBlockLocation, StateBlockView } from './playerStateBlock';
+import {
+  EngineCommandQueue, CommandStats,
+  CMD_PLAY, CMD_PAUSE, CMD_STOP, CMD_SEEK, CMD_SET_VOLUME
+} from './engineCommands';
+import { PipelineClient } from './pipelineClient';
+import { DecodeService } from './decodeService';
+import { TrackHandoff, TrackHandoffTarget } from './decodedTrackStore';
+import { EngineSpectrumSource, SpectrumSource } from './spectrumSource';
+import { StereoSource } from './stereoSource';
+import { TrackIndex, indexForTrack } from './trackIndex';
+import { WaveformView, buildInSlices } from './waveformPyramid';
 
 // Define the Emscripten module interface
 interface SdlModule {
   _init_audio(): number;
   _set_audio_data(dataPtr: number, length: number, channels: number, sampleRate: number): void;
+  _adopt_audio_data(dataPtr: number, length: number, channels: number, sampleRate: number): void;
   _play(): void;
   _pause_audio(): void;
   _resume_audio(): void;
   _stop(): void;
   _seek(time: number): void;
+  _seek_frame(frame: number): void;
   _get_current_time(): number;
+  _get_current_frame(): number;
+  _detach_audio_data(): number;
+  _deinterleave_frames(interleavedPtr: number, channels: number, startFrame: number, frames: number, planarPtr: number): number;
   _set_volume(volume: number): void;
+  _get_status_ptr(): number;
+  _get_spectrum_ptr(): number;
+  _get_stereo_ptr(): number;
+  _waveform_begin(): number;
+  _waveform_step(maxFrames: number): number;
+  _set_loading(loading: number): void;
+  _get_command_buffer_ptr(): number;
+  _flush_commands(): number;
   _cleanup(): void;
   _malloc(size: number): number;
   _free(ptr: number): void;
@@ -26,20 +51,44 @@ declare global {
   function createSdlAudioModule(): Promise<SdlModule>;
 }
 
-export class SdlAudioPlayer {
+// Most recent engine startup, reported through window.__playerUiStats
+const startupStats = { engineStartupMs: 0, engineWarmStart: false };
+
+export function getEngineStartupStats(): { engineStartupMs: number; engineWarmStart: boolean } {
+  return { ...startupStats };
+}
+
+// Frames split per engine call when detaching a track (1 MB of scratch per stereo slab)
+const DETACH_SLAB_FRAMES = 1 << 17;
+
+export class SdlAudioPlayer implements PlayerStateSource, TrackHandoffTarget {
   private module: SdlModule | null = null;
   private isReady: boolean = false;
+  private ready: Promise<void>;
   private isPlaying: boolean = false;
   private duration: number = 0;
   private onStateChange?: (state: PlayerState) => void;
-  private pollInterval: number | null = null;
   private lastVolume: number = 1.0;
+  private stateBlock: StateBlockView | null = null;
+  private commands: EngineCommandQueue | null = null;
+  private spectrum: SpectrumSource | null = null;
+  private stereo: StereoSource | null = null;
+  private waveform: WaveformView | null = null;
+  private cancelWaveform: (() => void) | null = null;
+  private trackIndex: TrackIndex | null = null;
+  // Layout of the track the engine currently owns, needed to take it back out
+  private trackChannels: number = 0;
+  private trackSampleRate: number = 0;
+  private trackFrames: number = 0;
 
   constructor() {
-    this.initializeModule();
+    DecodeService.get().acquire();
+    this.ready = this.initializeModule();
   }
 
   private async initializeModule() {
+    const loadStartedAt = performance.now();
+
     // Load the ScriptProcessor->AudioWorklet shim first (best-effort). This enables environments
     // where ScriptProcessorNode is missing/deprecated to still work via AudioWorkletNode.
     if (!(window as any).__sdl_script_processor_shim_loaded) {
@@ -73,14 +122,29 @@ export class SdlAudioPlayer {
       if (!success) {
         console.error('Failed to initialize SDL audio');
       } else {
+        const module = this.module;
+        this.commands = new EngineCommandQueue({
+          heapBuffer: () => this.getHeapBuffer(),
+          bufferPtr: () => module._get_command_buffer_ptr(),
+          flush: () => module._flush_commands()
+        });
         this.isReady = true;
-        this.startPolling();
+        this.reportStartupTiming(loadStartedAt);
       }
     } catch (err) {
       console.error('Error initializing SDL module:', err);
     }
   }
 
+  // Cold vs warm start: with the service worker in control the shim, sdl-audio.js and the
+  // .wasm come from the precache, so this measures script load + compile + SDL init only.
+  private reportStartupTiming(loadStartedAt: number) {
+    const elapsed = performance.now() - loadStartedAt;
+    performance.measure?.('sdl-engine-startup', { start: loadStartedAt, duration: elapsed });
+    startupStats.engineStartupMs = elapsed;
+    startupStats.engineWarmStart = !!navigator.serviceWorker?.controller;
+  }
+
   setStateChangeCallback(callback: (state: PlayerState) => void): void {
     this.onStateChange = callback;
   }
@@ -91,137 +155,138 @@ export class SdlAudioPlayer {
     }
   }
 
-  // Poll for playback position updates
-  private startPolling() {
-    if (this.pollInterval) window.clearInterval(this.pollInterval);
-    this.pollInterval = window.setInterval(() => {
-      if (this.isPlaying && this.module) {
-        this.notifyStateChange();
-      }
-    }, 100);
-  }
-
-  async loadAudio(arrayBuffer: ArrayBuffer): Promise<void> {
-    if (!this.module || !this.isReady) {
-        // Retry init if not ready? or wait?
-        // For simplicity, assume initialized by the time user clicks load.
-        if (!this.module) throw new Error('SDL Module not initialized');
-    }
+  async loadAudio(arrayBuffer: ArrayBuffer, index: TrackIndex | null = null): Promise<void> {
+    await this.ready;
+    if (!this.module) throw new Error('SDL Module not initialized');
 
     this.stop();
+    this.trackIndex = null;
     this.notifyStateChange();
 
     try {
+      // Decoded at the file's native rate; the SDL stream converts to the device rate
       const decoder = new FlacDecoder();
       const result = await decoder.decode(arrayBuffer);
+      this.trackIndex = indexForTrack(index, result.samples[0].length, result.sampleRate);
+      await this.uploadTrack(result.samples, result.sampleRate);
+      this.notifyStateChange();
 
-      this.duration = result.duration;
-
-      // Interleave samples
-      const channels = result.channels;
-      const length = result.samples[0].length;
-      const interleavedLength = length * channels;
-      const interleaved = new Float32Array(interleavedLength);
+    } catch (error) {
+      console.error('Error loading audio in SDL player:', error);
+      throw error;
+    }
+  }
 
-      for (let i = 0; i < length; i++) {
-        for (let ch = 0; ch < channels; ch++) {
-          interleaved[i * channels + ch] = result.samples[ch][i];
-        }
+  // Interleaves planar PCM into a malloc'd block and hands it to the engine. The channel
+  // arrays are transferred to the pipeline worker where possible, so callers give them up.
+  private async uploadTrack(samples: Float32Array[], sampleRate: number): Promise<void> {
+    const channels = samples.length;
+    const frames = samples[0].length;
+    const interleavedLength = frames * channels;
+    const byteLength = interleavedLength * Float32Array.BYTES_PER_ELEMENT;
+    const pipeline = PipelineClient.get();
+
+    // Allocate the track in WASM (in bytes). The engine adopts this block, so on success it must not be freed here.
+    this.dropWaveform();
+    const ptr = this.module._malloc(byteLength);
+    this.duration = frames / sampleRate;
+    this.trackChannels = channels;
+    this.trackSampleRate = sampleRate;
+    this.trackFrames = frames;
+
+    if (!ptr || ptr === 0) {
+      // Malloc failed: fall back to ccall copy (note: ccall -> writeArrayToMemory may hit RangeError if it writes into a stale view)
+      console.warn('WASM malloc failed (returned 0). Trying ccall fallback that copies the array into WASM memory.');
+      const interleaved = await pipeline.interleave(samples, null);
+      try {
+        this.commands?.flush();
+        (this.module as any).ccall('set_audio_data', null, ['array', 'number', 'number', 'number'], [interleaved, interleavedLength, channels, sampleRate]);
+      } catch (ccErr) {
+        console.error('Fallback ccall set_audio_data failed:', ccErr);
+        throw ccErr;
       }
-
-      // Allocate memory in WASM (in bytes) and write safely to the current WASM buffer
-      const byteLength = interleaved.byteLength;
-      const ptr = (this.module as any)._malloc(byteLength);
-
-      if (!ptr || ptr === 0) {
-        // Malloc failed: fall back to ccall copy (note: ccall -> writeArrayToMemory may hit RangeError if it writes into a stale view)
-        console.warn('WASM malloc failed (returned 0). Trying ccall fallback that copies the array into WASM memory.');
-        try {
-          (this.module as any).ccall('set_audio_data', null, ['array', 'number', 'number', 'number'], [interleaved, interleavedLength, channels, result.sampleRate]);
-        } catch (ccErr) {
-          console.error('Fallback ccall set_audio_data failed:', ccErr);
-          throw ccErr;
+    } else {
+      try {
+        const memoryBuffer = this.getHeapBuffer();
+
+        if (typeof SharedArrayBuffer !== 'undefined' && memoryBuffer instanceof SharedArrayBuffer) {
+          // Threaded build: the worker interleaves straight into the malloc'd block
+          await pipeline.interleave(samples, { memory: memoryBuffer, byteOffset: ptr });
+        } else {
+          const interleaved = await pipeline.interleave(samples, null);
+          // Re-read the heap after the await: memory may have grown and detached the old buffer
+          new Float32Array(this.getHeapBuffer(), ptr, interleavedLength).set(interleaved!);
         }
-      } else {
-        try {
-          // Critical fix: always use HEAPU8.buffer (or wasmMemory.buffer) to create a fresh Float32Array view.
-          // _malloc() can grow WebAssembly memory; accessing stale Module.HEAPF32 may throw RangeError.
-          let memoryBuffer: ArrayBufferLike;
-
-          if ((this.module as any).HEAPU8 && (this.module as any).HEAPU8.buffer) {
-            memoryBuffer = (this.module as any).HEAPU8.buffer;
-          } else if ((this.module as any).wasmMemory && (this.module as any).wasmMemory.buffer) {
-            memoryBuffer = (this.module as any).wasmMemory.buffer;
-          } else if ((this.module as any).HEAP8 && (this.module as any).HEAP8.buffer) {
-             memoryBuffer = (this.module as any).HEAP8.buffer;
-          } else {
-             // Debug log to help identify available properties if all else fails
-             console.error('Available module properties:', Object.keys(this.module as any));
-             throw new Error('Cannot find WASM memory buffer (HEAPU8, wasmMemory, or HEAP8 are missing)');
-          }
 
-          const destination = new Float32Array(memoryBuffer, ptr, interleavedLength);
-          destination.set(interleaved);
-
-          // Send to C++ (direct call, faster and avoids writeArrayToMemory)
-          (this.module as any)._set_audio_data(ptr, interleavedLength, channels, result.sampleRate);
-        } catch (err) {
-          const heapByteLength = (this.module as any).HEAPU8?.buffer?.byteLength ||
-                                 (this.module as any).wasmMemory?.buffer?.byteLength ||
-                                 undefined;
-
-          console.error('Failed to write audio data into WASM heap:', err, { ptr, byteLength, heapByteLength });
-
-          // Try fallback ccall if direct write fails (covers browser-specific edge cases)
-          try {
-            (this.module as any).ccall('set_audio_data', null, ['array', 'number', 'number', 'number'], [interleaved, interleavedLength, channels, result.sampleRate]);
-          } catch (ccErr) {
-            console.error('Fallback ccall set_audio_data also failed:', ccErr);
-            // Free pointer and rethrow original error
-            (this.module as any)._free && (this.module as any)._free(ptr);
-            throw err;
-          }
-        } finally {
-          // Free malloc'd memory (the C++ copy made its own copy into g_state.audioBuffer)
-          (this.module as any)._free && (this.module as any)._free(ptr);
-        }
+        // Hand ownership of the block to C++ (no second copy on the main thread).
+        // Pending commands (the stop above) must land before the new track does.
+        this.commands?.flush();
+        this.module._adopt_audio_data(ptr, interleavedLength, channels, sampleRate);
+      } catch (err) {
+        const heapByteLength = (this.module as any).HEAPU8?.buffer?.byteLength ||
+                               (this.module as any).wasmMemory?.buffer?.byteLength ||
+                               undefined;
+
+        console.error('Failed to write audio data into WASM heap:', err, { ptr, byteLength, heapByteLength });
+        this.module._free(ptr);
+        throw err;
       }
+    }
+  }
 
-      this.notifyStateChange();
-
-    } catch (error) {
-      console.error('Error loading audio in SDL player:', error);
-      throw error;
+  // Always go through HEAPU8.buffer (or wasmMemory.buffer) to build fresh views.
+  // _malloc() can grow WebAssembly memory; accessing a stale Module.HEAPF32 may throw RangeError.
+  private getHeapBuffer(): ArrayBufferLike {
+    const module = this.module as any;
+
+    if (module.HEAPU8 && module.HEAPU8.buffer) {
+      return module.HEAPU8.buffer;
+    } else if (module.wasmMemory && module.wasmMemory.buffer) {
+      return module.wasmMemory.buffer;
+    } else if (module.HEAP8 && module.HEAP8.buffer) {
+      return module.HEAP8.buffer;
     }
+
+    // Debug log to help identify available properties if all else fails
+    console.error('Available module properties:', Object.keys(module));
+    throw new Error('Cannot find WASM memory buffer (HEAPU8, wasmMemory, or HEAP8 are missing)');
   }
 
+  // Transport and volume changes are queued and applied once per frame (see engineCommands.ts)
   play(): void {
-    if (!this.module) return;
-    this.module._play();
+    if (!this.commands) return;
+    this.commands.enqueue(CMD_PLAY);
+    // Flushed right away: resuming the audio device must happen inside the user gesture
+    this.commands.flush();
     this.isPlaying = true;
     this.notifyStateChange();
   }
 
   pause(): void {
-    if (!this.module) return;
-    this.module._pause_audio();
+    if (!this.commands) return;
+    this.commands.enqueue(CMD_PAUSE);
     this.isPlaying = false;
     this.notifyStateChange();
   }
 
   stop(): void {
-    if (!this.module) return;
-    this.module._stop();
+    if (!this.commands) return;
+    this.commands.enqueue(CMD_STOP);
     this.isPlaying = false;
     this.notifyStateChange();
   }
 
   seek(time: number): void {
-    if (!this.module) return;
-    this.module._seek(time);
+    if (!this.commands) return;
+    this.commands.enqueue(CMD_SEEK, time);
     this.notifyStateChange();
   }
 
+  // Commands enqueued vs. WASM calls made; the difference is the per-event call overhead saved
+  getCommandStats(): CommandStats | null {
+    return this.commands ? this.commands.stats : null;
+  }
+
   getCurrentTime(): number {
     if (!this.module) return 0;
     return this.module._get_current_time();
@@ -240,29 +305,192 @@ export class SdlAudioPlayer {
     };
   }
 
+  setLoading(loading: boolean): void {
+    if (this.module) {
+      this.module._set_loading(loading ? 1 : 0);
+    }
+  }
+
+  // Reads the status block the engine publishes from its stream callback. Views are rebuilt
+  // when the heap buffer changes (memory growth), the block itself never moves.
+  readState(out: PlayerStateSnapshot): number {
+    if (!this.module || !this.isReady) return out.seq;
+
+    const heap = this.getHeapBuffer();
+    if (!this.stateBlock || this.stateBlock.buffer !== heap) {
+      this.stateBlock = new StateBlockView(heap, this.module._get_status_ptr());
+    }
+    return this.stateBlock.read(out);
+  }
+
+  // The engine's block in WASM memory; it never moves, so the current heap buffer maps it
+  stateBlockLocation(): StateBlockLocation | null {
+    if (!this.module || !this.isReady) return null;
+    return { buffer: this.getHeapBuffer(), byteOffset: this.module._get_status_ptr() };
+  }
+
   setVolume(volume: number): void {
     this.lastVolume = volume;
-    if (this.module) {
-      this.module._set_volume(volume);
+    if (this.commands) {
+      this.commands.enqueue(CMD_SET_VOLUME, volume);
+    }
+  }
+
+  // The engine analyses what it plays and publishes the spectrum in WASM memory; the
+  // visualizer reads it there, no AnalyserNode involved. Resolves once the engine is up.
+  async getSpectrumSource(): Promise<SpectrumSource | null> {
+    await this.ready;
+    if (!this.module || !this.isReady) return null;
+    if (!this.spectrum) {
+      this.spectrum = new EngineSpectrumSource(() => this.getHeapBuffer(), this.module._get_spectrum_ptr());
+    }
+    return this.spectrum;
+  }
+
+  // Correlation, vectorscope and scope feed, published next to the spectrum
+  async getStereoSource(): Promise<StereoSource | null> {
+    await this.ready;
+    if (!this.module || !this.isReady) return null;
+    if (!this.stereo) {
+      this.stereo = new StereoSource(() => this.getHeapBuffer(), this.module._get_stereo_ptr());
     }
+    return this.stereo;
   }
 
-  getAnalyser(): AnalyserNode {
-    // SDL player doesn't support Web Audio AnalyserNode integration yet
-    // Return a dummy analyser to satisfy interface if needed, or throw/return null and handle in UI
-    // The UI handles null but the type signature says AnalyserNode.
-    // We'll cast null or create a dummy one.
-    // Creating a dummy one requires AudioContext.
-    const ctx = new AudioContext();
-    const analyser = ctx.createAnalyser();
-    return analyser;
+  // Overview for the seek bar. A scanned track brings it in its index; otherwise the engine
+  // summarizes its own track buffer in WASM memory, a few milliseconds per task, and the
+  // view reads the levels in place.
+  getWaveform(): WaveformView | null {
+    if (!this.module || !this.isReady || this.trackFrames === 0) return null;
+    if (this.trackIndex) return this.trackIndex.waveform;
+    if (!this.waveform) {
+      const ptr = this.module._waveform_begin();
+      if (!ptr) return null;
+      const module = this.module;
+      this.cancelWaveform = buildInSlices((maxFrames) => module._waveform_step(maxFrames) === 1);
+      this.waveform = new WaveformView(() => this.getHeapBuffer(), ptr, this.trackSampleRate);
+    }
+    return this.waveform;
+  }
+
+  // Must run before the engine lets go of the track the pyramid is built from
+  private dropWaveform(): void {
+    this.cancelWaveform?.();
+    this.cancelWaveform = null;
+    this.waveform = null;
+  }
+
+  // Takes the track back out of the engine. Letting go is cheap: the engine's interleaved
+  // buffer simply stays in WASM memory (which outlives destroy()), and the one copy into a
+  // planar AudioBuffer happens only when the next player asks for the audio, a slab at a
+  // time between tasks instead of inside React's effect cleanup.
+  detachTrack(): TrackHandoff | null {
+    if (!this.module || !this.isReady || this.trackFrames === 0) return null;
+
+    this.commands?.flush();
+    const frame = this.module._get_current_frame();
+    const wasPlaying = this.isPlaying;
+    this.dropWaveform();
+    const ptr = this.module._detach_audio_data();
+    this.isPlaying = false;
+    if (!ptr) return null;
+
+    const channels = this.trackChannels;
+    const frames = this.trackFrames;
+    const sampleRate = this.trackSampleRate;
+    let copy: Promise<AudioBuffer> | null = null;
+    let freed = false;
+    const audio = () => {
+      if (!copy) {
+        copy = this.copyOutOfEngine(ptr, channels, frames, sampleRate).finally(() => {
+          this.module!._free(ptr);
+          freed = true;
+        });
+      }
+      return copy;
+    };
+    const dispose = () => {
+      if (copy || freed) return;
+      freed = true;
+      this.module!._free(ptr);
+    };
+
+    const index = this.trackIndex;
+    this.trackFrames = 0;
+    this.trackIndex = null;
+    this.duration = 0;
+    this.notifyStateChange();
+    return { audio, encoded: null, frame, sampleRate, wasPlaying, index, dispose };
+  }
+
+  // The engine's deinterleave kernel splits the track into a small scratch block a slab at a
+  // time, and each slab is copied into the AudioBuffer
+  private async copyOutOfEngine(ptr: number, channels: number, frames: number, sampleRate: number): Promise<AudioBuffer> {
+    const module = this.module!;
+    const audio = new AudioBuffer({ numberOfChannels: channels, length: frames, sampleRate });
+    const slab = Math.min(frames, DETACH_SLAB_FRAMES);
+    const scratch = module._malloc(slab * channels * Float32Array.BYTES_PER_ELEMENT);
+    try {
+      for (let start = 0; start < frames; start += slab) {
+        const count = Math.min(slab, frames - start);
+        // The strided JS copy covers a failed scratch allocation or a slab the kernel refused
+        if (scratch && module._deinterleave_frames(ptr, channels, start, count, scratch)) {
+          const heap = this.getHeapBuffer();
+          for (let ch = 0; ch < channels; ch++) {
+            audio.copyToChannel(new Float32Array(heap, scratch + ch * count * Float32Array.BYTES_PER_ELEMENT, count), ch, start);
+          }
+        } else {
+          const interleaved = new Float32Array(this.getHeapBuffer(), ptr, frames * channels);
+          for (let ch = 0; ch < channels; ch++) {
+            const out = audio.getChannelData(ch);
+            for (let i = start, j = start * channels + ch; i < start + count; i++, j += channels) {
+              out[i] = interleaved[j];
+            }
+          }
+        }
+        await new Promise(resolve => setTimeout(resolve, 0));
+      }
+    } finally {
+      if (scratch) module._free(scratch);
+    }
+    return audio;
+  }
+
+  async adoptTrack(handoff: TrackHandoff): Promise<void> {
+    await this.ready;
+    if (!this.module) throw new Error('SDL Module not initialized');
+
+    this.stop();
+    const audio = handoff.audio ? await handoff.audio() : await new FlacDecoder().decodeToAudioBuffer(handoff.encoded!);
+    const samples: Float32Array[] = [];
+    for (let ch = 0; ch < audio.numberOfChannels; ch++) {
+      samples.push(audio.getChannelData(ch));
+    }
+    this.trackIndex = handoff.index;
+    await this.uploadTrack(samples, audio.sampleRate);
+
+    // Rates match unless the streaming player handed over its encoded file
+    this.module._seek_frame(Math.round(handoff.frame * audio.sampleRate / handoff.sampleRate));
+    if (handoff.wasPlaying) {
+      this.play();
+    }
+    this.notifyStateChange();
   }
 
   destroy(): void {
     this.stop();
-    if (this.pollInterval) clearInterval(this.pollInterval);
+    this.dropWaveform();
+    this.stateBlock = null;
+    if (this.commands) {
+      this.commands.flush();
+      this.commands.dispose();
+      this.commands = null;
+    }
     if (this.module) {
       this.module._cleanup();
     }
+    this.spectrum = null;
+    this.stereo = null;
+    DecodeService.get().release();
   }
 }
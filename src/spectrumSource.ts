@@ -0,0 +1,105 @@
+// What the visualizer draws from. Web Audio players wrap their AnalyserNode; the SDL engine
+// publishes the same AnalyserNode-style byte spectrum in WASM memory (src/sdl/analysis.h),
+// which is read in place. A block in shared memory can be read from the visualizer worker too.
+
+// SpectrumBlock layout: u32 seq | u32 binCount | f32 level | u32 reserved | u8 bins[binCount]
+const SPECTRUM_HEADER_BYTES = 16;
+
+// Where a SpectrumBlock lives in shared memory
+export interface SharedSpectrumBlock {
+  buffer: SharedArrayBuffer;
+  byteOffset: number;
+}
+
+export interface SpectrumSource {
+  readonly binCount: number;
+  // Latest magnitudes, 0..255 per bin with AnalyserNode.getByteFrequencyData scaling.
+  // May be a view straight into shared memory: read it before the next call, don't keep it.
+  frequencyBytes(): Uint8Array;
+  // The block the bins are read from, if it is shared memory another thread can read
+  sharedBlock(): SharedSpectrumBlock | null;
+}
+
+export class AnalyserSpectrumSource implements SpectrumSource {
+  readonly binCount: number;
+  private analyser: AnalyserNode;
+  private bytes: Uint8Array;
+
+  constructor(analyser: AnalyserNode) {
+    this.analyser = analyser;
+    this.binCount = analyser.frequencyBinCount;
+    this.bytes = new Uint8Array(this.binCount);
+  }
+
+  frequencyBytes(): Uint8Array {
+    this.analyser.getByteFrequencyData(this.bytes);
+    return this.bytes;
+  }
+
+  // AnalyserNode only answers on the main thread; see SpectrumMirror
+  sharedBlock(): SharedSpectrumBlock | null {
+    return null;
+  }
+}
+
+// Copies a main-thread source into a shared SpectrumBlock once per call to copy(), for a
+// reader on another thread. The copy stops while the main thread is stalled; the reader
+// keeps the last bins.
+export class SpectrumMirror {
+  readonly block: SharedSpectrumBlock;
+  private source: SpectrumSource;
+  private seq: Int32Array;
+  private bins: Uint8Array;
+
+  constructor(source: SpectrumSource) {
+    this.source = source;
+    const buffer = new SharedArrayBuffer(SPECTRUM_HEADER_BYTES + source.binCount);
+    this.block = { buffer, byteOffset: 0 };
+    this.seq = new Int32Array(buffer, 0, 1);
+    new Uint32Array(buffer, 0, 2)[1] = source.binCount;
+    this.bins = new Uint8Array(buffer, SPECTRUM_HEADER_BYTES, source.binCount);
+  }
+
+  copy(): void {
+    // Odd while writing, as the engine's seqlock; readers tolerate a torn frame of bins
+    Atomics.add(this.seq, 0, 1);
+    this.bins.set(this.source.frequencyBytes());
+    Atomics.add(this.seq, 0, 1);
+  }
+}
+
+// Reads a SpectrumBlock in place: the engine's in WASM memory, or a SpectrumMirror's from a worker
+export class EngineSpectrumSource implements SpectrumSource {
+  readonly binCount: number;
+  private heapBuffer: () => ArrayBufferLike;
+  private blockPtr: number;
+  private buffer: ArrayBufferLike | null = null;
+  private bins: Uint8Array | null = null;
+
+  constructor(heapBuffer: () => ArrayBufferLike, blockPtr: number) {
+    this.heapBuffer = heapBuffer;
+    this.blockPtr = blockPtr;
+    this.binCount = new Uint32Array(heapBuffer(), blockPtr, 2)[1];
+  }
+
+  // Views are only rebuilt when memory growth replaced the heap buffer
+  private views(): void {
+    const heap = this.heapBuffer();
+    if (heap !== this.buffer) {
+      this.buffer = heap;
+      this.bins = new Uint8Array(heap, this.blockPtr + SPECTRUM_HEADER_BYTES, this.binCount);
+    }
+  }
+
+  frequencyBytes(): Uint8Array {
+    this.views();
+    return this.bins!;
+  }
+
+  // The block never moves: memory growth only appends to the heap
+  sharedBlock(): SharedSpectrumBlock | null {
+    const heap = this.heapBuffer();
+    if (typeof SharedArrayBuffer === 'undefined' || !(heap instanceof SharedArrayBuffer)) return null;
+    return { buffer: heap, byteOffset: this.blockPtr };
+  }
+}
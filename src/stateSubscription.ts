@@ -0,0 +1,99 @@
+// Reads a player's status block once per animation frame and reports only real changes.
+// Replaces timer polling: no work is scheduled beyond the display's own frame callbacks.
+//
+// Changes are split in two. Discrete status (play/pause, loading, a new duration) goes to
+// `onStatus`, which is what React state is for. Position moves every frame while playing,
+// so it goes to `onPosition`, which is expected to write to the DOM through refs without
+// re-rendering anything.
+import { PlayerStateSnapshot, PlayerStateSource, createSnapshot } from './playerStateBlock';
+
+export interface PlayerStatus {
+  isPlaying: boolean;
+  isLoading: boolean;
+  duration: number;
+}
+
+export interface PlayerStateHandlers {
+  onStatus: (status: PlayerStatus) => void;
+  onPosition?: (snapshot: PlayerStateSnapshot) => void;
+}
+
+// Main-thread cost of the subscription, for comparing UI update strategies
+export interface SubscriptionStats {
+  frames: number;
+  statusUpdates: number;
+  positionUpdates: number;
+  // Time spent inside tick (block read plus both handlers, including any React work they trigger synchronously)
+  callbackMs: number;
+  // Seconds of playback observed, to normalise the counters per minute
+  playbackSeconds: number;
+}
+
+const stats: SubscriptionStats = {
+  frames: 0,
+  statusUpdates: 0,
+  positionUpdates: 0,
+  callbackMs: 0,
+  playbackSeconds: 0
+};
+
+export function getSubscriptionStats(): SubscriptionStats {
+  return { ...stats };
+}
+
+export function subscribePlayerState(
+  getSource: () => PlayerStateSource | null,
+  handlers: PlayerStateHandlers
+): () => void {
+  const snapshot: PlayerStateSnapshot = createSnapshot();
+  let lastSource: PlayerStateSource | null = null;
+  let lastSeq = -1;
+  let lastPlaying = false;
+  let lastLoading = false;
+  let lastDuration = -1;
+  let lastFrameAt = 0;
+  let frameId = 0;
+
+  const tick = (now: number) => {
+    const source = getSource();
+    if (source) {
+      const started = performance.now();
+      const seq = source.readState(snapshot);
+      const sourceChanged = source !== lastSource;
+
+      if (sourceChanged || seq !== lastSeq) {
+        lastSource = source;
+        lastSeq = seq;
+
+        if (sourceChanged || snapshot.isPlaying !== lastPlaying ||
+            snapshot.isLoading !== lastLoading || snapshot.duration !== lastDuration) {
+          lastPlaying = snapshot.isPlaying;
+          lastLoading = snapshot.isLoading;
+          lastDuration = snapshot.duration;
+          stats.statusUpdates++;
+          handlers.onStatus({
+            isPlaying: snapshot.isPlaying,
+            isLoading: snapshot.isLoading,
+            duration: snapshot.duration
+          });
+        }
+
+        if (handlers.onPosition) {
+          stats.positionUpdates++;
+          handlers.onPosition(snapshot);
+        }
+      }
+
+      stats.frames++;
+      stats.callbackMs += performance.now() - started;
+      if (snapshot.isPlaying && lastFrameAt > 0) {
+        stats.playbackSeconds += (now - lastFrameAt) / 1000;
+      }
+    }
+    lastFrameAt = now;
+    frameId = requestAnimationFrame(tick);
+  };
+
+  frameId = requestAnimationFrame(tick);
+  return () => cancelAnimationFrame(frameId);
+}
@@ -0,0 +1,51 @@
+// Stereo-field feed for the visualizer's stereo mode. The SDL engine publishes a running L/R
+// correlation, a mid/side point cloud and a zero-crossing-triggered scope window in WASM
+// memory (src/sdl/analysis.h); this reads the block in place and hands it to the GPU as-is.
+// Web Audio modes have no engine-side analysis and no stereo feed.
+
+// StereoBlock layout: u32 seq | u32 pointCount | u32 scopeSamples | f32 correlation |
+//                     f32 points[pointCount][2] (side, mid) | f32 scope[scopeSamples]
+const STEREO_HEADER_BYTES = 16;
+
+// Where a StereoBlock lives in shared memory
+export interface SharedStereoBlock {
+  buffer: SharedArrayBuffer;
+  byteOffset: number;
+}
+
+export class StereoSource {
+  readonly pointCount: number;
+  readonly scopeSamples: number;
+  readonly byteLength: number;
+  private heapBuffer: () => ArrayBufferLike;
+  private blockPtr: number;
+  private buffer: ArrayBufferLike | null = null;
+  private bytes: Uint8Array | null = null;
+
+  constructor(heapBuffer: () => ArrayBufferLike, blockPtr: number) {
+    this.heapBuffer = heapBuffer;
+    this.blockPtr = blockPtr;
+    const header = new Uint32Array(heapBuffer(), blockPtr, 3);
+    this.pointCount = header[1];
+    this.scopeSamples = header[2];
+    this.byteLength = STEREO_HEADER_BYTES + this.pointCount * 8 + this.scopeSamples * 4;
+  }
+
+  // The whole block, header included. A view into shared memory: upload it before the next
+  // call, don't keep it. A frame may be torn; the next one replaces it.
+  blockBytes(): Uint8Array {
+    const heap = this.heapBuffer();
+    if (heap !== this.buffer) {
+      this.buffer = heap;
+      this.bytes = new Uint8Array(heap, this.blockPtr, this.byteLength);
+    }
+    return this.bytes!;
+  }
+
+  // The block never moves: memory growth only appends to the heap
+  sharedBlock(): SharedStereoBlock | null {
+    const heap = this.heapBuffer();
+    if (typeof SharedArrayBuffer === 'undefined' || !(heap instanceof SharedArrayBuffer)) return null;
+    return { buffer: heap, byteOffset: this.blockPtr };
+  }
+}
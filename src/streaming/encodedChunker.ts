@@ -0,0 +1,347 @@
+// Splits an encoded FLAC or WAV file into small, independently decodable pieces.
+// Each piece is a minimal header plus whole frames (FLAC) or whole sample blocks (WAV),
+// so decodeAudioData can turn a second or two of audio into PCM at a time instead of
+// materializing the whole track.
+import { TrackIndex } from '../trackIndex';
+
+export interface EncodedPiece {
+  bytes: ArrayBuffer;
+  startFrame: number;
+}
+
+export interface EncodedChunker {
+  readonly sampleRate: number;
+  readonly channels: number;
+  // 0 when the stream doesn't declare its length
+  readonly totalFrames: number;
+  // Returns the next piece and advances the cursor, or null at the end of the stream
+  nextPiece(): EncodedPiece | null;
+  // Moves the cursor to the piece containing `frame`; returns the first frame of that piece
+  seek(frame: number): number;
+  // Seeks from the scanner's seek points from now on, where the format needs a search
+  setIndex(index: TrackIndex): void;
+}
+
+// Pieces start small so playback can begin after a tiny decode, then grow to amortize
+// the per-call decodeAudioData overhead.
+const FIRST_PIECE_BYTES = 64 * 1024;
+const PIECE_BYTES = 256 * 1024;
+
+export function createChunker(arrayBuffer: ArrayBuffer): EncodedChunker | null {
+  if (arrayBuffer.byteLength < 12) return null;
+  const view = new DataView(arrayBuffer);
+  if (view.getUint32(0) === 0x664c6143) return FlacChunker.parse(arrayBuffer); // "fLaC"
+  if (view.getUint32(0) === 0x52494646 && view.getUint32(8) === 0x57415645) return WavChunker.parse(arrayBuffer); // "RIFF" "WAVE"
+  return null;
+}
+
+// ---------------------------------------------------------------- FLAC
+
+interface FlacFrameHeader {
+  offset: number;
+  sample: number;
+  blockSize: number;
+}
+
+const CRC8_TABLE = (() => {
+  const table = new Uint8Array(256);
+  for (let i = 0; i < 256; i++) {
+    let c = i;
+    for (let b = 0; b < 8; b++) c = (c & 0x80) ? ((c << 1) ^ 0x07) & 0xff : (c << 1) & 0xff;
+    table[i] = c;
+  }
+  return table;
+})();
+
+class FlacChunker implements EncodedChunker {
+  readonly sampleRate: number;
+  readonly channels: number;
+  readonly totalFrames: number;
+
+  private bytes: Uint8Array;
+  private streamInfoHeader: Uint8Array;
+  private firstFrameOffset: number;
+  private minFrameBytes: number;
+  private maxFrameBytes: number;
+  private fixedBlockSize: number;
+  private cursor: FlacFrameHeader | null;
+  private piecesEmitted: number = 0;
+  private index: TrackIndex | null = null;
+
+  static parse(arrayBuffer: ArrayBuffer): FlacChunker | null {
+    const bytes = new Uint8Array(arrayBuffer);
+    let offset = 4;
+    let streamInfo: Uint8Array | null = null;
+
+    // Metadata blocks: 1 byte last-flag/type, 3 bytes length
+    for (;;) {
+      if (offset + 4 > bytes.length) return null;
+      const isLast = (bytes[offset] & 0x80) !== 0;
+      const type = bytes[offset] & 0x7f;
+      const length = (bytes[offset + 1] << 16) | (bytes[offset + 2] << 8) | bytes[offset + 3];
+      if (type === 0 && length >= 34) streamInfo = bytes.subarray(offset + 4, offset + 4 + 34);
+      offset += 4 + length;
+      if (isLast) break;
+    }
+    if (!streamInfo || offset >= bytes.length) return null;
+
+    return new FlacChunker(bytes, streamInfo, offset);
+  }
+
+  private constructor(bytes: Uint8Array, streamInfo: Uint8Array, firstFrameOffset: number) {
+    const info = new DataView(streamInfo.buffer, streamInfo.byteOffset, streamInfo.byteLength);
+    const maxBlockSize = info.getUint16(2);
+    this.minFrameBytes = (streamInfo[4] << 16) | (streamInfo[5] << 8) | streamInfo[6];
+    this.maxFrameBytes = (streamInfo[7] << 16) | (streamInfo[8] << 8) | streamInfo[9];
+    this.sampleRate = (info.getUint32(10) >>> 12) & 0xfffff;
+    this.channels = ((streamInfo[12] >> 1) & 0x07) + 1;
+    // 36-bit total sample count: low 4 bits of byte 13 and bytes 14..17
+    this.totalFrames = (streamInfo[13] & 0x0f) * 2 ** 32 + info.getUint32(14);
+    this.fixedBlockSize = maxBlockSize;
+
+    this.bytes = bytes;
+    this.firstFrameOffset = firstFrameOffset;
+
+    // Minimal header prepended to every piece: "fLaC" + STREAMINFO as the last block, with
+    // the total length and MD5 zeroed (unknown) because each piece is only part of the stream
+    const header = new Uint8Array(4 + 4 + 34);
+    header.set([0x66, 0x4c, 0x61, 0x43, 0x80, 0x00, 0x00, 34]);
+    header.set(streamInfo, 8);
+    header[8 + 13] &= 0xf0;
+    header.fill(0, 8 + 14, 8 + 18);
+    header.fill(0, 8 + 18, 8 + 34);
+    this.streamInfoHeader = header;
+
+    this.cursor = this.findFrame(firstFrameOffset, -1);
+  }
+
+  nextPiece(): EncodedPiece | null {
+    const start = this.cursor;
+    if (!start) return null;
+
+    const target = this.piecesEmitted === 0 ? FIRST_PIECE_BYTES : PIECE_BYTES;
+    const end = this.findFrame(start.offset + target, start.sample);
+    const endOffset = end ? end.offset : this.bytes.length;
+
+    const piece = new Uint8Array(this.streamInfoHeader.length + (endOffset - start.offset));
+    piece.set(this.streamInfoHeader, 0);
+    piece.set(this.bytes.subarray(start.offset, endOffset), this.streamInfoHeader.length);
+
+    this.cursor = end;
+    this.piecesEmitted++;
+    return { bytes: piece.buffer, startFrame: start.sample };
+  }
+
+  setIndex(index: TrackIndex): void {
+    this.index = index;
+  }
+
+  // Starts from the scanner's seek point when there is one, otherwise bisects on byte
+  // offsets using frame headers as landmarks; then walks forward to the frame containing
+  // `frame`. Neither needs a seek table in the file.
+  seek(frame: number): number {
+    const known = this.seekPointHeader(frame);
+    let lo = known ?? this.findFrame(this.firstFrameOffset, -1);
+    if (!lo) {
+      this.cursor = null;
+      return 0;
+    }
+    // A seek point is at most one interval short of the target: no bisection needed
+    let hiOffset = known ? known.offset : this.bytes.length;
+
+    while (hiOffset - lo.offset > 64 * 1024) {
+      const mid = lo.offset + Math.floor((hiOffset - lo.offset) / 2);
+      const probe = this.findFrame(mid, lo.sample);
+      if (!probe || probe.sample > frame) {
+        hiOffset = mid;
+      } else {
+        lo = probe;
+      }
+    }
+
+    for (;;) {
+      const next = this.findFrame(lo.offset + 1, lo.sample);
+      if (!next || next.sample > frame) break;
+      lo = next;
+    }
+
+    this.cursor = lo;
+    return lo.sample;
+  }
+
+  // Header of the frame at the index's seek point for `frame`, if the index has one and it
+  // matches this file
+  private seekPointHeader(frame: number): FlacFrameHeader | null {
+    const point = this.index?.seekPointFor(frame);
+    if (!point) return null;
+    const offset = point.byteOffset;
+    const bytes = this.bytes;
+    if (offset < this.firstFrameOffset || offset + 6 > bytes.length) return null;
+    if (bytes[offset] !== 0xff || (bytes[offset + 1] & 0xfe) !== 0xf8) return null;
+    const header = this.parseFrameHeader(offset);
+    return header && header.sample === point.frame ? header : null;
+  }
+
+  // First frame header at or after `from` whose sample number is past `afterSample`.
+  // A candidate is only accepted when the next header follows where its block size says it
+  // should, which rules out sync-code look-alikes inside compressed data.
+  private findFrame(from: number, afterSample: number): FlacFrameHeader | null {
+    const bytes = this.bytes;
+    for (let i = Math.max(from, this.firstFrameOffset); i + 6 <= bytes.length; i++) {
+      if (bytes[i] !== 0xff || (bytes[i + 1] & 0xfe) !== 0xf8) continue;
+      const header = this.parseFrameHeader(i);
+      if (!header || header.sample <= afterSample) continue;
+      if (this.confirmFrame(header)) return header;
+    }
+    return null;
+  }
+
+  private confirmFrame(header: FlacFrameHeader): boolean {
+    const bytes = this.bytes;
+    const expected = header.sample + header.blockSize;
+    if (this.totalFrames > 0 && expected >= this.totalFrames) return true; // last frame
+
+    const searchStart = header.offset + Math.max(this.minFrameBytes, 2);
+    const searchEnd = Math.min(bytes.length - 2, header.offset + (this.maxFrameBytes || 1 << 20) + 16);
+    for (let i = searchStart; i <= searchEnd; i++) {
+      if (bytes[i] !== 0xff || (bytes[i + 1] & 0xfe) !== 0xf8) continue;
+      const next = this.parseFrameHeader(i);
+      if (next && next.sample === expected) return true;
+    }
+    // Nothing follows within a frame's reach: only valid if the stream ends there
+    return searchEnd >= bytes.length - 2;
+  }
+
+  private parseFrameHeader(offset: number): FlacFrameHeader | null {
+    const bytes = this.bytes;
+    const variableBlockSize = (bytes[offset + 1] & 0x01) !== 0;
+    const blockSizeCode = bytes[offset + 2] >> 4;
+    const sampleRateCode = bytes[offset + 2] & 0x0f;
+    const channelCode = bytes[offset + 3] >> 4;
+    const sampleSizeCode = (bytes[offset + 3] >> 1) & 0x07;
+
+    if (blockSizeCode === 0 || sampleRateCode === 0x0f || channelCode > 10 ||
+        sampleSizeCode === 3 || (bytes[offset + 3] & 0x01) !== 0) {
+      return null;
+    }
+    const frameChannels = channelCode < 8 ? channelCode + 1 : 2;
+    if (frameChannels !== this.channels) return null;
+
+    // UTF-8 style coded frame/sample number
+    let p = offset + 4;
+    const lead = bytes[p++];
+    let extra: number;
+    let value: number;
+    if (lead < 0x80) { value = lead; extra = 0; }
+    else if ((lead & 0xe0) === 0xc0) { value = lead & 0x1f; extra = 1; }
+    else if ((lead & 0xf0) === 0xe0) { value = lead & 0x0f; extra = 2; }
+    else if ((lead & 0xf8) === 0xf0) { value = lead & 0x07; extra = 3; }
+    else if ((lead & 0xfc) === 0xf8) { value = lead & 0x03; extra = 4; }
+    else if ((lead & 0xfe) === 0xfc) { value = lead & 0x01; extra = 5; }
+    else if (lead === 0xfe) { value = 0; extra = 6; }
+    else return null;
+    for (let k = 0; k < extra; k++) {
+      const b = bytes[p++];
+      if ((b & 0xc0) !== 0x80) return null;
+      value = value * 64 + (b & 0x3f);
+    }
+
+    let blockSize: number;
+    if (blockSizeCode === 1) blockSize = 192;
+    else if (blockSizeCode <= 5) blockSize = 576 << (blockSizeCode - 2);
+    else if (blockSizeCode === 6) blockSize = bytes[p++] + 1;
+    else if (blockSizeCode === 7) { blockSize = ((bytes[p] << 8) | bytes[p + 1]) + 1; p += 2; }
+    else blockSize = 256 << (blockSizeCode - 8);
+
+    if (sampleRateCode === 12) p += 1;
+    else if (sampleRateCode === 13 || sampleRateCode === 14) p += 2;
+
+    if (p >= bytes.length) return null;
+    let crc = 0;
+    for (let k = offset; k < p; k++) crc = CRC8_TABLE[crc ^ bytes[k]];
+    if (crc !== bytes[p]) return null;
+
+    const sample = variableBlockSize ? value : value * this.fixedBlockSize;
+    if (this.totalFrames > 0 && sample >= this.totalFrames) return null;
+    return { offset, sample, blockSize };
+  }
+}
+
+// ---------------------------------------------------------------- WAV
+
+class WavChunker implements EncodedChunker {
+  readonly sampleRate: number;
+  readonly channels: number;
+  readonly totalFrames: number;
+
+  private bytes: Uint8Array;
+  private fmtChunk: Uint8Array;
+  private dataOffset: number;
+  private blockAlign: number;
+  private cursorFrame: number = 0;
+  private piecesEmitted: number = 0;
+
+  static parse(arrayBuffer: ArrayBuffer): WavChunker | null {
+    const view = new DataView(arrayBuffer);
+    let offset = 12;
+    let fmt: { start: number; size: number } | null = null;
+
+    while (offset + 8 <= arrayBuffer.byteLength) {
+      const id = view.getUint32(offset);
+      const size = view.getUint32(offset + 4, true);
+      if (id === 0x666d7420) { // "fmt "
+        fmt = { start: offset, size };
+      } else if (id === 0x64617461 && fmt) { // "data"
+        const dataBytes = Math.min(size, arrayBuffer.byteLength - offset - 8);
+        return new WavChunker(new Uint8Array(arrayBuffer), fmt.start, fmt.size, offset + 8, dataBytes);
+      }
+      offset += 8 + size + (size & 1);
+    }
+    return null;
+  }
+
+  private constructor(bytes: Uint8Array, fmtStart: number, fmtSize: number, dataOffset: number, dataBytes: number) {
+    const view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+    this.bytes = bytes;
+    this.fmtChunk = bytes.subarray(fmtStart, fmtStart + 8 + fmtSize);
+    this.channels = view.getUint16(fmtStart + 10, true);
+    this.sampleRate = view.getUint32(fmtStart + 12, true);
+    this.blockAlign = Math.max(1, view.getUint16(fmtStart + 20, true));
+    this.dataOffset = dataOffset;
+    this.totalFrames = Math.floor(dataBytes / this.blockAlign);
+  }
+
+  nextPiece(): EncodedPiece | null {
+    if (this.cursorFrame >= this.totalFrames) return null;
+
+    const target = this.piecesEmitted === 0 ? FIRST_PIECE_BYTES : PIECE_BYTES;
+    const frames = Math.min(this.totalFrames - this.cursorFrame, Math.max(1, Math.floor(target / this.blockAlign)));
+    const dataBytes = frames * this.blockAlign;
+    const start = this.dataOffset + this.cursorFrame * this.blockAlign;
+
+    // "RIFF" size "WAVE" + original fmt chunk + "data" size + samples
+    const piece = new Uint8Array(12 + this.fmtChunk.length + 8 + dataBytes);
+    const view = new DataView(piece.buffer);
+    view.setUint32(0, 0x52494646);
+    view.setUint32(4, piece.length - 8, true);
+    view.setUint32(8, 0x57415645);
+    piece.set(this.fmtChunk, 12);
+    const dataHeader = 12 + this.fmtChunk.length;
+    view.setUint32(dataHeader, 0x64617461);
+    view.setUint32(dataHeader + 4, dataBytes, true);
+    piece.set(this.bytes.subarray(start, start + dataBytes), dataHeader + 8);
+
+    const startFrame = this.cursorFrame;
+    this.cursorFrame += frames;
+    this.piecesEmitted++;
+    return { bytes: piece.buffer, startFrame };
+  }
+
+  // WAV seeks by arithmetic
+  setIndex(): void {}
+
+  seek(frame: number): number {
+    this.cursorFrame = Math.max(0, Math.min(Math.floor(frame), this.totalFrames));
+    return this.cursorFrame;
+  }
+}
@@ -0,0 +1,93 @@
+// Sources of planar PCM chunks for the streaming player's ring.
+import { DecodeService } from '../decodeService';
+import { EncodedChunker } from './encodedChunker';
+
+export interface PcmChunk {
+  channels: Float32Array[];
+  // First frame of `channels` to use (non-zero right after a seek into the middle of a piece)
+  offset: number;
+  // Track frame corresponding to channels[*][offset]
+  startFrame: number;
+}
+
+export interface PcmProducer {
+  readonly sampleRate: number;
+  readonly channels: number;
+  readonly totalFrames: number;
+  // Resolves with the next chunk, or null at the end. The cursor advances before any await,
+  // so a seek issued while a decode is in flight is never overwritten by it.
+  next(): Promise<PcmChunk | null>;
+  seek(frame: number): void;
+}
+
+// Decodes an encoded file piece by piece at its native rate
+export class EncodedPcmProducer implements PcmProducer {
+  readonly sampleRate: number;
+  readonly channels: number;
+  readonly totalFrames: number;
+
+  private chunker: EncodedChunker;
+  private skipFrames: number = 0;
+
+  constructor(chunker: EncodedChunker) {
+    this.chunker = chunker;
+    this.sampleRate = chunker.sampleRate;
+    this.channels = chunker.channels;
+    this.totalFrames = chunker.totalFrames;
+  }
+
+  async next(): Promise<PcmChunk | null> {
+    const piece = this.chunker.nextPiece();
+    if (!piece) return null;
+    const skip = this.skipFrames;
+    this.skipFrames = 0;
+
+    const audio = await DecodeService.get().decode(piece.bytes, this.sampleRate);
+    const channels: Float32Array[] = [];
+    for (let ch = 0; ch < audio.numberOfChannels; ch++) {
+      channels.push(audio.getChannelData(ch));
+    }
+    return { channels, offset: Math.min(skip, audio.length), startFrame: piece.startFrame + skip };
+  }
+
+  seek(frame: number): void {
+    const pieceStart = this.chunker.seek(frame);
+    this.skipFrames = Math.max(0, frame - pieceStart);
+  }
+}
+
+// Serves slices of an already decoded AudioBuffer (formats the chunker can't split,
+// or a track handed over from another output mode). Slices are views, not copies.
+export class AudioBufferPcmProducer implements PcmProducer {
+  readonly sampleRate: number;
+  readonly channels: number;
+  readonly totalFrames: number;
+  readonly audioBuffer: AudioBuffer;
+
+  private data: Float32Array[] = [];
+  private cursor: number = 0;
+  private sliceFrames: number;
+
+  constructor(audioBuffer: AudioBuffer) {
+    this.audioBuffer = audioBuffer;
+    this.sampleRate = audioBuffer.sampleRate;
+    this.channels = audioBuffer.numberOfChannels;
+    this.totalFrames = audioBuffer.length;
+    for (let ch = 0; ch < audioBuffer.numberOfChannels; ch++) {
+      this.data.push(audioBuffer.getChannelData(ch));
+    }
+    this.sliceFrames = Math.max(1024, audioBuffer.sampleRate);
+  }
+
+  async next(): Promise<PcmChunk | null> {
+    if (this.cursor >= this.totalFrames) return null;
+    const start = this.cursor;
+    const end = Math.min(this.totalFrames, start + this.sliceFrames);
+    this.cursor = end;
+    return { channels: this.data.map(ch => ch.subarray(start, end)), offset: 0, startFrame: start };
+  }
+
+  seek(frame: number): void {
+    this.cursor = Math.max(0, Math.min(Math.floor(frame), this.totalFrames));
+  }
+}
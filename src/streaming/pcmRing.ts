@@ -0,0 +1,135 @@
+// Single-producer/single-consumer PCM ring in a SharedArrayBuffer. The main thread writes
+// decoded planar frames, public/pcm-ring-processor.js reads them on the audio thread.
+// Counters are free-running u32 frame counts, so the capacity must be a power of two.
+//
+// Layout: Int32 header[16] | channel 0 Float32[capacity] | channel 1 ... (see the worklet)
+
+export const RING_WRITE = 0;          // frames written (producer)
+export const RING_READ = 1;           // frames consumed (consumer)
+export const RING_DISCARD_UNTIL = 2;  // consumer skips ahead to this write count (seek)
+export const RING_PAUSED = 3;         // non-zero: output silence without consuming
+export const RING_END = 4;            // non-zero: producer has written the last frame
+export const RING_UNDERRUNS = 5;      // quanta that ran dry before the end (consumer)
+export const RING_STEP = 6;           // Float32: source frames per output frame (rate ratio)
+export const RING_DISCARD_PENDING = 7; // non-zero: RING_DISCARD_UNTIL not yet applied (consumer clears)
+export const RING_CLOSED = 8;         // non-zero: the track is gone, the processor ends itself
+export const RING_HEADER_INTS = 16;
+
+export class PcmRing {
+  readonly buffer: SharedArrayBuffer;
+  readonly channels: number;
+  readonly capacity: number;
+  readonly header: Int32Array;
+  private headerFloats: Float32Array;
+  private data: Float32Array[] = [];
+
+  constructor(channels: number, minFrames: number) {
+    let capacity = 1024;
+    while (capacity < minFrames) capacity *= 2;
+
+    this.channels = channels;
+    this.capacity = capacity;
+    this.buffer = new SharedArrayBuffer(RING_HEADER_INTS * 4 + channels * capacity * 4);
+    this.header = new Int32Array(this.buffer, 0, RING_HEADER_INTS);
+    this.headerFloats = new Float32Array(this.buffer, 0, RING_HEADER_INTS);
+    for (let ch = 0; ch < channels; ch++) {
+      this.data.push(new Float32Array(this.buffer, RING_HEADER_INTS * 4 + ch * capacity * 4, capacity));
+    }
+  }
+
+  setStep(step: number): void {
+    this.headerFloats[RING_STEP] = step;
+  }
+
+  setPaused(paused: boolean): void {
+    Atomics.store(this.header, RING_PAUSED, paused ? 1 : 0);
+  }
+
+  setEnded(ended: boolean): void {
+    Atomics.store(this.header, RING_END, ended ? 1 : 0);
+  }
+
+  // Lets the processor return false from process() so the node and this buffer can be collected
+  close(): void {
+    Atomics.store(this.header, RING_CLOSED, 1);
+  }
+
+  isEnded(): boolean {
+    return Atomics.load(this.header, RING_END) !== 0;
+  }
+
+  written(): number {
+    return Atomics.load(this.header, RING_WRITE) >>> 0;
+  }
+
+  read(): number {
+    return Atomics.load(this.header, RING_READ) >>> 0;
+  }
+
+  underruns(): number {
+    return Atomics.load(this.header, RING_UNDERRUNS) >>> 0;
+  }
+
+  // Frames queued and not yet consumed (anything before a pending discard doesn't count)
+  queued(): number {
+    const write = Atomics.load(this.header, RING_WRITE);
+    const read = Atomics.load(this.header, RING_READ);
+    let effectiveRead = read;
+    if (Atomics.load(this.header, RING_DISCARD_PENDING) !== 0) {
+      const discard = Atomics.load(this.header, RING_DISCARD_UNTIL);
+      if (((discard - read) | 0) > 0) effectiveRead = discard;
+    }
+    return (write - effectiveRead) | 0;
+  }
+
+  freeFrames(): number {
+    return this.capacity - this.queued();
+  }
+
+  // Copies up to `frames` frames starting at `offset` of each source channel; returns how many fit
+  write(source: Float32Array[], offset: number, frames: number): number {
+    const count = Math.min(frames, this.freeFrames());
+    if (count <= 0) return 0;
+
+    const mask = this.capacity - 1;
+    const write = Atomics.load(this.header, RING_WRITE) >>> 0;
+    const start = write & mask;
+    const firstPart = Math.min(count, this.capacity - start);
+
+    for (let ch = 0; ch < this.channels; ch++) {
+      const src = source[Math.min(ch, source.length - 1)];
+      const dst = this.data[ch];
+      dst.set(src.subarray(offset, offset + firstPart), start);
+      if (firstPart < count) {
+        dst.set(src.subarray(offset + firstPart, offset + count), 0);
+      }
+    }
+
+    // Publish the frames only after the samples are in place
+    Atomics.store(this.header, RING_WRITE, (write + count) | 0);
+    return count;
+  }
+
+  // Drops everything queued so far: the consumer jumps straight to the current write count.
+  // The target only counts while the pending flag is up, so a target the consumer has long
+  // passed can't look "ahead" again once the counters move 2^31 frames on.
+  discardQueued(): number {
+    const write = Atomics.load(this.header, RING_WRITE);
+    Atomics.store(this.header, RING_DISCARD_UNTIL, write);
+    Atomics.store(this.header, RING_DISCARD_PENDING, 1);
+    return write >>> 0;
+  }
+
+  // Resolves once the consumer has moved (or after `timeoutMs`), without a message or timer
+  // on the audio thread: the worklet calls Atomics.notify on the read counter each quantum.
+  waitForConsumer(timeoutMs: number): Promise<void> {
+    const lastRead = Atomics.load(this.header, RING_READ);
+    const waitAsync = (Atomics as any).waitAsync as
+      ((array: Int32Array, index: number, value: number, timeout?: number) => { async: boolean; value: any }) | undefined;
+    if (waitAsync) {
+      const result = waitAsync(this.header, RING_READ, lastRead, timeoutMs);
+      return result.async ? result.value.then(() => undefined) : Promise.resolve();
+    }
+    return new Promise(resolve => setTimeout(resolve, timeoutMs));
+  }
+}
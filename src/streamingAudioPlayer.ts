@@ -0,0 +1,383 @@
+// Web Audio player that streams: pieces of the file are decoded on demand into a
+// SharedArrayBuffer ring and played by an AudioWorklet (public/pcm-ring-processor.js).
+// Keeps AudioPlayer's GainNode -> AnalyserNode chain, but PCM memory is bounded by the
+// ring size and playback starts as soon as the first piece is decoded.
+import { PlayerState } from './audioPlayer';
+import { DecodeService } from './decodeService';
+import { PlayerStateSnapshot, PlayerStateSource, StateBlockLocation, StateBlockView, allocateStateBlock, outputLatencyOf } from './playerStateBlock';
+import { EncodedChunker, createChunker } from './streaming/encodedChunker';
+import { PcmRing } from './streaming/pcmRing';
+import { AudioBufferPcmProducer, EncodedPcmProducer, PcmChunk, PcmProducer } from './streaming/pcmProducer';
+import { TrackHandoff, TrackHandoffTarget, decodedAudio } from './decodedTrackStore';
+import { AnalyserSpectrumSource, SpectrumSource } from './spectrumSource';
+import { StereoSource } from './stereoSource';
+import { TrackIndex, indexForTrack } from './trackIndex';
+import { WaveformView } from './waveformPyramid';
+
+const WORKLET_URL = 'pcm-ring-processor.js';
+// Seconds of source audio the ring holds; this is the whole PCM footprint of a track
+const RING_SECONDS = 8;
+const CONSUMER_WAIT_MS = 250;
+
+export class StreamingAudioPlayer implements PlayerStateSource, TrackHandoffTarget {
+  private audioContext: AudioContext;
+  private gainNode: GainNode;
+  private analyser: AnalyserNode;
+  private workletReady: Promise<void>;
+  private node: AudioWorkletNode | null = null;
+  private ring: PcmRing | null = null;
+  private producer: PcmProducer | null = null;
+  // The encoded file being streamed (kept for handing the track to another output mode)
+  private encoded: ArrayBuffer | null = null;
+  private trackIndex: TrackIndex | null = null;
+
+  // Bumped on every load/seek/stop; a pump loop exits as soon as its generation is stale
+  private generation: number = 0;
+  private pending: PcmChunk | null = null;
+  private pendingOffset: number = 0;
+
+  // Track frame that ring write count `seekIndex` corresponds to
+  private seekFrame: number = 0;
+  private seekIndex: number = 0;
+
+  private isPlaying: boolean = false;
+  private isLoading: boolean = false;
+  private onStateChange?: (state: PlayerState) => void;
+  private stateBlock: StateBlockView = allocateStateBlock();
+  private spectrum: SpectrumSource | null = null;
+
+  constructor() {
+    this.audioContext = new AudioContext();
+    this.gainNode = this.audioContext.createGain();
+    this.analyser = this.audioContext.createAnalyser();
+    this.analyser.fftSize = 2048;
+
+    this.gainNode.connect(this.analyser);
+    this.analyser.connect(this.audioContext.destination);
+
+    this.workletReady = this.audioContext.audioWorklet.addModule(WORKLET_URL);
+    DecodeService.get().acquire();
+  }
+
+  setStateChangeCallback(callback: (state: PlayerState) => void): void {
+    this.onStateChange = callback;
+  }
+
+  private notifyStateChange(): void {
+    if (this.onStateChange) {
+      this.onStateChange(this.getState());
+    }
+  }
+
+  async loadAudio(arrayBuffer: ArrayBuffer, index: TrackIndex | null = null): Promise<void> {
+    if (typeof SharedArrayBuffer === 'undefined') {
+      throw new Error('Streaming playback needs SharedArrayBuffer (serve the app cross-origin isolated)');
+    }
+
+    this.isPlaying = false;
+    this.releaseTrack();
+
+    try {
+      const chunker = createChunker(arrayBuffer);
+      let producer: PcmProducer;
+      if (chunker) {
+        producer = new EncodedPcmProducer(chunker);
+        this.encoded = arrayBuffer;
+      } else {
+        // Not FLAC/WAV: decode once and stream from the decoded buffer
+        const decoded = await DecodeService.get().decode(arrayBuffer);
+        producer = new AudioBufferPcmProducer(decoded);
+      }
+      this.useIndex(indexForTrack(index, producer.totalFrames, producer.sampleRate), chunker);
+
+      await this.startProducer(producer, 0);
+      this.notifyStateChange();
+    } catch (error) {
+      console.error('Error loading audio for streaming:', error);
+      throw error;
+    }
+  }
+
+  // The index's seek points save the chunker its bisection, and its waveform gives this mode
+  // a seek bar overview it couldn't build itself
+  private useIndex(index: TrackIndex | null, chunker: EncodedChunker | null): void {
+    this.trackIndex = index;
+    if (index && chunker) chunker.setIndex(index);
+  }
+
+  // Playback can start once the first piece is in the ring
+  private async startProducer(producer: PcmProducer, startFrame: number): Promise<void> {
+    await this.workletReady;
+    this.attachProducer(producer);
+    if (startFrame > 0) {
+      producer.seek(startFrame);
+      this.seekFrame = startFrame;
+    }
+    await this.fillFirstChunk(this.generation);
+  }
+
+  private attachProducer(producer: PcmProducer): void {
+    this.producer = producer;
+    this.ring = new PcmRing(producer.channels, producer.sampleRate * RING_SECONDS);
+    this.ring.setStep(producer.sampleRate / this.audioContext.sampleRate);
+    this.ring.setPaused(true);
+
+    // One node per track so the output channel count matches the source
+    this.node = new AudioWorkletNode(this.audioContext, 'pcm-ring-processor', {
+      numberOfInputs: 0,
+      numberOfOutputs: 1,
+      outputChannelCount: [producer.channels],
+      processorOptions: { buffer: this.ring.buffer, channels: producer.channels, capacity: this.ring.capacity }
+    });
+    this.node.connect(this.gainNode);
+
+    this.seekFrame = 0;
+    this.seekIndex = 0;
+    this.generation++;
+  }
+
+  private async fillFirstChunk(generation: number): Promise<void> {
+    await this.pumpOnce(generation);
+    this.pump(generation);
+  }
+
+  // Decodes (if needed) and writes one chunk's worth; returns false when there is nothing left
+  private async pumpOnce(generation: number): Promise<boolean> {
+    const ring = this.ring;
+    const producer = this.producer;
+    if (!ring || !producer) return false;
+
+    if (!this.pending) {
+      const chunk = await producer.next();
+      if (generation !== this.generation) return false;
+      if (!chunk) {
+        ring.setEnded(true);
+        return false;
+      }
+      this.pending = chunk;
+      this.pendingOffset = chunk.offset;
+    }
+
+    const chunkFrames = this.pending.channels[0].length;
+    this.pendingOffset += ring.write(this.pending.channels, this.pendingOffset, chunkFrames - this.pendingOffset);
+    if (this.pendingOffset >= chunkFrames) {
+      this.pending = null;
+    }
+    return true;
+  }
+
+  private async pump(generation: number): Promise<void> {
+    try {
+      while (generation === this.generation && this.ring) {
+        if (this.pending && this.ring.freeFrames() === 0) {
+          await this.ring.waitForConsumer(CONSUMER_WAIT_MS);
+          continue;
+        }
+        if (!(await this.pumpOnce(generation))) return;
+      }
+    } catch (error) {
+      console.error('Streaming decode failed:', error);
+      this.ring?.setEnded(true);
+    }
+  }
+
+  play(): void {
+    if (!this.ring) {
+      console.error('No audio loaded');
+      return;
+    }
+    if (this.isPlaying) return;
+
+    // Resume audio context if suspended
+    if (this.audioContext.state === 'suspended') {
+      this.audioContext.resume();
+    }
+    this.ring.setPaused(false);
+    this.isPlaying = true;
+    this.notifyStateChange();
+  }
+
+  pause(): void {
+    if (!this.isPlaying || !this.ring) return;
+    this.ring.setPaused(true);
+    this.isPlaying = false;
+    this.notifyStateChange();
+  }
+
+  stop(): void {
+    if (this.ring) {
+      this.ring.setPaused(true);
+      this.isPlaying = false;
+      this.seek(0);
+    }
+    this.isPlaying = false;
+    this.notifyStateChange();
+  }
+
+  seek(time: number): void {
+    const ring = this.ring;
+    const producer = this.producer;
+    if (!ring || !producer) return;
+
+    const maxFrame = producer.totalFrames > 0 ? producer.totalFrames : Number.MAX_SAFE_INTEGER;
+    const frame = Math.max(0, Math.min(Math.floor(time * producer.sampleRate), maxFrame));
+
+    this.generation++;
+    this.pending = null;
+    producer.seek(frame);
+    ring.setEnded(false);
+    this.seekIndex = ring.discardQueued();
+    this.seekFrame = frame;
+
+    this.pump(this.generation);
+    this.notifyStateChange();
+  }
+
+  private currentFrame(): number {
+    if (!this.ring) return 0;
+    const consumed = (this.ring.read() - this.seekIndex) | 0;
+    return this.seekFrame + Math.max(0, consumed);
+  }
+
+  getCurrentTime(): number {
+    if (!this.producer) return 0;
+    return Math.min(this.currentFrame() / this.producer.sampleRate, this.getDuration() || Infinity);
+  }
+
+  getDuration(): number {
+    if (!this.producer || this.producer.totalFrames === 0) return 0;
+    return this.producer.totalFrames / this.producer.sampleRate;
+  }
+
+  getState(): PlayerState {
+    return {
+      isPlaying: this.isPlaying,
+      currentTime: this.getCurrentTime(),
+      duration: this.getDuration(),
+      isLoading: this.isLoading
+    };
+  }
+
+  setLoading(loading: boolean): void {
+    this.isLoading = loading;
+  }
+
+  readState(out: PlayerStateSnapshot): number {
+    // The ring drained after the last frame: behave like AudioPlayer's onended
+    if (this.isPlaying && this.ring && this.ring.isEnded() && this.ring.queued() <= 0) {
+      this.stop();
+    }
+
+    const currentTime = this.getCurrentTime();
+    const bufferedAhead = this.ring && this.producer ? Math.max(0, this.ring.queued()) / this.producer.sampleRate : 0;
+    this.stateBlock.write(
+      { isPlaying: this.isPlaying, currentTime, duration: this.getDuration(), isLoading: this.isLoading },
+      bufferedAhead,
+      outputLatencyOf(this.audioContext)
+    );
+    return this.stateBlock.read(out);
+  }
+
+  stateBlockLocation(): StateBlockLocation {
+    return this.stateBlock;
+  }
+
+  // Quanta the worklet had to pad with silence (decode fell behind)
+  getUnderruns(): number {
+    return this.ring ? this.ring.underruns() : 0;
+  }
+
+  setVolume(volume: number): void {
+    this.gainNode.gain.value = Math.max(0, Math.min(1, volume));
+  }
+
+  getAnalyser(): AnalyserNode {
+    return this.analyser;
+  }
+
+  getSpectrumSource(): SpectrumSource {
+    if (!this.spectrum) {
+      this.spectrum = new AnalyserSpectrumSource(this.analyser);
+    }
+    return this.spectrum;
+  }
+
+  // Stereo analysis runs in the SDL engine only
+  getStereoSource(): StereoSource | null {
+    return null;
+  }
+
+  // The track is decoded a window at a time and never held whole, so there is nothing to
+  // summarize: only a scanned track (one with an index) has an overview in this mode, and
+  // the player keeps the plain seek slider otherwise
+  getWaveform(): WaveformView | null {
+    return this.producer ? this.trackIndex?.waveform ?? null : null;
+  }
+
+  // Hands over the decoded buffer when there is one, otherwise the encoded file; either
+  // way nothing is re-downloaded
+  detachTrack(): TrackHandoff | null {
+    const producer = this.producer;
+    if (!producer) return null;
+
+    const audio = producer instanceof AudioBufferPcmProducer ? producer.audioBuffer : null;
+    const handoff: TrackHandoff = {
+      audio: audio ? decodedAudio(audio) : null,
+      encoded: audio ? null : this.encoded,
+      frame: this.currentFrame(),
+      sampleRate: producer.sampleRate,
+      wasPlaying: this.isPlaying,
+      index: this.trackIndex
+    };
+    this.isPlaying = false;
+    this.releaseTrack();
+    this.notifyStateChange();
+    return handoff;
+  }
+
+  async adoptTrack(handoff: TrackHandoff): Promise<void> {
+    this.isPlaying = false;
+    this.releaseTrack();
+
+    let producer: PcmProducer;
+    const chunker = handoff.encoded ? createChunker(handoff.encoded) : null;
+    if (handoff.audio) {
+      producer = new AudioBufferPcmProducer(await handoff.audio());
+    } else if (chunker) {
+      producer = new EncodedPcmProducer(chunker);
+      this.encoded = handoff.encoded;
+    } else {
+      throw new Error('Nothing to stream in the handed over track');
+    }
+    this.useIndex(handoff.index, handoff.audio ? null : chunker);
+
+    await this.startProducer(producer, Math.round(handoff.frame * producer.sampleRate / handoff.sampleRate));
+    if (handoff.wasPlaying) {
+      this.play();
+    }
+    this.notifyStateChange();
+  }
+
+  private releaseTrack(): void {
+    this.generation++;
+    this.pending = null;
+    this.producer = null;
+    this.encoded = null;
+    this.trackIndex = null;
+    this.ring?.close();
+    this.ring = null;
+    if (this.node) {
+      this.node.disconnect();
+      this.node = null;
+    }
+  }
+
+  destroy(): void {
+    this.isPlaying = false;
+    this.releaseTrack();
+    this.gainNode.disconnect();
+    this.analyser.disconnect();
+    this.audioContext.close();
+    DecodeService.get().release();
+  }
+}
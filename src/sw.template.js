@@ -0,0 +1,86 @@
+/* eslint-disable no-restricted-globals */
+// Precaching service worker for the app shell and the SDL/WASM engine files.
+// The build replaces the two placeholders below with the list of emitted assets and their
+// content hashes (see PrecacheManifestPlugin in webpack.config.js), so every deploy that
+// changes a file produces a new worker script and therefore a new cache.
+const PRECACHE_MANIFEST = self.__PRECACHE_MANIFEST;
+const PRECACHE_VERSION = self.__PRECACHE_VERSION;
+
+const CACHE_PREFIX = 'flac-player-precache-';
+const CACHE_NAME = CACHE_PREFIX + PRECACHE_VERSION;
+
+// The app may be deployed under a sub-path, so resolve everything against the worker scope
+const scopeUrl = new URL(self.registration.scope);
+const toAbsolute = (url) => new URL(url, scopeUrl).href;
+
+// Cache keys carry the content hash, which lets an update reuse unchanged entries
+// (typically the large sdl-audio.wasm) from the previous version's cache.
+const cacheKeyFor = (url, revision) => `${toAbsolute(url)}?__precache=${revision}`;
+
+const precachedKeys = new Map(
+  PRECACHE_MANIFEST.map(({ url, revision }) => [toAbsolute(url), cacheKeyFor(url, revision)])
+);
+const appShellEntry = PRECACHE_MANIFEST.find(({ url }) => url === 'index.html');
+const APP_SHELL_KEY = appShellEntry ? cacheKeyFor(appShellEntry.url, appShellEntry.revision) : null;
+
+self.addEventListener('install', (event) => {
+  event.waitUntil((async () => {
+    const cache = await caches.open(CACHE_NAME);
+
+    await Promise.all(PRECACHE_MANIFEST.map(async ({ url, revision }) => {
+      const key = cacheKeyFor(url, revision);
+
+      // Same content hash already cached by an older version: copy instead of re-downloading
+      const previous = await caches.match(key);
+      if (previous) {
+        await cache.put(key, previous);
+        return;
+      }
+
+      // Bypass the HTTP cache so a stale intermediate copy can't be stored under a new hash
+      const response = await fetch(new Request(toAbsolute(url), { cache: 'reload', credentials: 'same-origin' }));
+      if (!response.ok) {
+        throw new Error(`Precache of ${url} failed: ${response.status} ${response.statusText}`);
+      }
+      await cache.put(key, response);
+    }));
+  })());
+
+  // Deliberately no skipWaiting(): a new version waits until every tab running the old one
+  // is closed, so an update takes effect on the next visit and never mixes bundle versions.
+});
+
+self.addEventListener('activate', (event) => {
+  event.waitUntil((async () => {
+    const names = await caches.keys();
+    await Promise.all(
+      names
+        .filter((name) => name.startsWith(CACHE_PREFIX) && name !== CACHE_NAME)
+        .map((name) => caches.delete(name))
+    );
+    // Take control of the first visit too, so the engine scripts requested right after
+    // registration are already served from the cache on the following load.
+    await self.clients.claim();
+  })());
+});
+
+self.addEventListener('fetch', (event) => {
+  const request = event.request;
+  if (request.method !== 'GET') return;
+
+  const url = new URL(request.url);
+  if (url.origin !== scopeUrl.origin) return; // audio sources and APIs always go to the network
+
+  let key = precachedKeys.get(url.origin + url.pathname);
+  if (!key && request.mode === 'navigate') {
+    // Single-page app: every navigation resolves to the cached shell (mirrors the host rewrites)
+    key = APP_SHELL_KEY;
+  }
+  if (!key) return;
+
+  event.respondWith((async () => {
+    const cache = await caches.open(CACHE_NAME);
+    const cached = await cache.match(key);
+    return cached || fetch(request);
+  })());
+});
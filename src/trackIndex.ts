@@ -0,0 +1,134 @@
+// Reader for the per-track index the library scanner writes next to each file
+// (`track.flac.idx`, see src/sdl/track_index.h). Every section sits at an aligned offset,
+// so all of it is used in place through typed views over the fetched ArrayBuffer: there is
+// no parsing pass, only a bounds check of the header. Typed arrays use the platform's byte
+// order, which is little-endian everywhere browsers run.
+//
+// Header (128 bytes, little-endian):
+//   u32 magic "FIDX" | u32 version | u32 headerBytes | u32 fileBytes |
+//   u32 sampleRate | u32 channels | u32 bitsPerSample | u32 seekCount |
+//   f64 totalFrames | f64 silenceStart | f64 silenceEnd | f64 seekIntervalFrames |
+//   f32 integratedLufs | f32 samplePeak | u32 spectrogramColumns | u32 spectrogramBands |
+//   (u32 offset, u32 bytes) sections[3] | u32 reserved[6]
+// Sections: f64 (frame, byteOffset) seek pairs | waveform pyramid | u8 [columns][bands]
+// The pyramid's own header is checked too: its levels must lie inside its section.
+import { WaveformView, waveformFits } from './waveformPyramid';
+
+const MAGIC = 0x58444946; // "FIDX"
+const VERSION = 1;
+const HEADER_BYTES = 128;
+
+// u32 word indices
+const U32_MAGIC = 0;
+const U32_VERSION = 1;
+const U32_HEADER_BYTES = 2;
+const U32_FILE_BYTES = 3;
+const U32_SAMPLE_RATE = 4;
+const U32_CHANNELS = 5;
+const U32_BITS = 6;
+const U32_SEEK_COUNT = 7;
+const U32_COLUMNS = 18;
+const U32_BANDS = 19;
+const U32_SECTIONS = 20;
+// f64 indices
+const F64_TOTAL_FRAMES = 4;
+const F64_SILENCE_START = 5;
+const F64_SILENCE_END = 6;
+const F64_SEEK_INTERVAL = 7;
+// f32 indices
+const F32_LUFS = 16;
+const F32_PEAK = 17;
+
+const SECTION_SEEK = 0;
+const SECTION_WAVEFORM = 1;
+const SECTION_SPECTROGRAM = 2;
+const SECTION_COUNT = 3;
+
+export class TrackIndex {
+  readonly buffer: ArrayBuffer;
+  private u32: Uint32Array;
+  private f64: Float64Array;
+  private f32: Float32Array;
+  // (frame, byteOffset) pairs, ascending by frame
+  readonly seekPoints: Float64Array;
+  // Complete min/max pyramid, the layout the engine builds in WASM memory
+  readonly waveform: WaveformView;
+  // [columns][bands] bytes on AnalyserNode's scale, lowest band first
+  readonly spectrogram: Uint8Array;
+
+  // Null when the buffer isn't an index this build understands, or is damaged
+  static from(buffer: ArrayBuffer): TrackIndex | null {
+    if (buffer.byteLength < HEADER_BYTES) return null;
+    const u32 = new Uint32Array(buffer, 0, HEADER_BYTES / 4);
+    if (u32[U32_MAGIC] !== MAGIC || u32[U32_VERSION] !== VERSION) return null;
+    if (u32[U32_HEADER_BYTES] < HEADER_BYTES || u32[U32_FILE_BYTES] > buffer.byteLength) return null;
+    for (let s = 0; s < SECTION_COUNT; s++) {
+      const offset = u32[U32_SECTIONS + s * 2];
+      if (offset % 8 !== 0 || offset + u32[U32_SECTIONS + s * 2 + 1] > u32[U32_FILE_BYTES]) return null;
+    }
+    if (u32[U32_SECTIONS + SECTION_SEEK * 2 + 1] !== u32[U32_SEEK_COUNT] * 16) return null;
+    if (u32[U32_SECTIONS + SECTION_SPECTROGRAM * 2 + 1] !== u32[U32_COLUMNS] * u32[U32_BANDS]) return null;
+    const waveformRef = U32_SECTIONS + SECTION_WAVEFORM * 2;
+    if (!waveformFits(buffer, u32[waveformRef], u32[waveformRef + 1])) return null;
+    return new TrackIndex(buffer, u32);
+  }
+
+  private constructor(buffer: ArrayBuffer, u32: Uint32Array) {
+    this.buffer = buffer;
+    this.u32 = u32;
+    this.f64 = new Float64Array(buffer, 0, HEADER_BYTES / 8);
+    this.f32 = new Float32Array(buffer, 0, HEADER_BYTES / 4);
+    this.seekPoints = new Float64Array(buffer, this.sectionOffset(SECTION_SEEK), u32[U32_SEEK_COUNT] * 2);
+    this.waveform = new WaveformView(() => buffer, this.sectionOffset(SECTION_WAVEFORM), u32[U32_SAMPLE_RATE]);
+    this.spectrogram = new Uint8Array(buffer, this.sectionOffset(SECTION_SPECTROGRAM), u32[U32_COLUMNS] * u32[U32_BANDS]);
+  }
+
+  private sectionOffset(section: number): number {
+    return this.u32[U32_SECTIONS + section * 2];
+  }
+
+  get sampleRate(): number { return this.u32[U32_SAMPLE_RATE]; }
+  get channels(): number { return this.u32[U32_CHANNELS]; }
+  get bitsPerSample(): number { return this.u32[U32_BITS]; }
+  get totalFrames(): number { return this.f64[F64_TOTAL_FRAMES]; }
+  get duration(): number { return this.totalFrames / this.sampleRate; }
+  // Audible range in frames; start === end for a silent track
+  get silenceStart(): number { return this.f64[F64_SILENCE_START]; }
+  get silenceEnd(): number { return this.f64[F64_SILENCE_END]; }
+  get seekIntervalFrames(): number { return this.f64[F64_SEEK_INTERVAL]; }
+  // -Infinity for silence or tracks shorter than one 400 ms block
+  get integratedLufs(): number { return this.f32[F32_LUFS]; }
+  get samplePeak(): number { return this.f32[F32_PEAK]; }
+  get spectrogramColumns(): number { return this.u32[U32_COLUMNS]; }
+  get spectrogramBands(): number { return this.u32[U32_BANDS]; }
+
+  // Whether this index was made from the track that was actually loaded. Players decoding at
+  // another rate compare durations, which resampling keeps within a frame.
+  describes(frames: number, sampleRate: number): boolean {
+    return Math.abs(frames / sampleRate - this.duration) < 0.001;
+  }
+
+  // Byte offset of the FLAC frame to start decoding from to reach `frame`, and the first
+  // frame it holds; null without seek points
+  seekPointFor(frame: number): { frame: number; byteOffset: number } | null {
+    const points = this.seekPoints;
+    const count = points.length / 2;
+    if (count === 0) return null;
+    let lo = 0;
+    let hi = count - 1;
+    while (lo < hi) {
+      const mid = (lo + hi + 1) >> 1;
+      if (points[mid * 2] <= frame) lo = mid;
+      else hi = mid - 1;
+    }
+    return { frame: points[lo * 2], byteOffset: points[lo * 2 + 1] };
+  }
+}
+
+// `index` if it was made from the loaded track, else null. A stale index (the file changed
+// after the scan) is dropped with a warning rather than drawn over the wrong audio.
+export function indexForTrack(index: TrackIndex | null, frames: number, sampleRate: number): TrackIndex | null {
+  if (!index || index.describes(frames, sampleRate)) return index;
+  console.warn(`Ignoring track index: it describes ${index.duration.toFixed(3)} s, the track is ${(frames / sampleRate).toFixed(3)} s`);
+  return null;
+}
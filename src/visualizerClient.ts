@@ -0,0 +1,197 @@
+// Page-side handle for the visualizer running in src/workers/visualizer.worker.ts.
+// Same surface as WebGPUVisualizer, so the player can use either.
+import { FrameStats } from './frameStats';
+import { FramePacer } from './framePacer';
+import { AudioClock } from './audioClock';
+import { GpuResources } from './gpuResources';
+import { StateBlockLocation } from './playerStateBlock';
+import { SharedSpectrumBlock, SpectrumMirror, SpectrumSource } from './spectrumSource';
+import { StereoSource } from './stereoSource';
+import { VisualizerMode, VisualizerStats } from './webgpuVisualizer';
+import { VisualizerRequest, VisualizerResponse } from './workers/visualizerProtocol';
+
+export class OffscreenVisualizer {
+  private worker: Worker;
+  private canvas: HTMLCanvasElement;
+  // Resolves to whether the worker has WebGPU; the first initialize() asks, and hands over
+  // the canvas if so. Until then the page can still draw to it.
+  private probe: Promise<boolean> | null = null;
+  private transferred: boolean = false;
+  private nextId: number = 1;
+  private pending = new Map<number, (ok: boolean) => void>();
+  private stats: VisualizerStats = {
+    ...new FrameStats().snapshot(), ...new FramePacer().snapshot(), ...new AudioClock().snapshot(),
+    ...new GpuResources().snapshot()
+  };
+  private batteryFpsCap: number = 30;
+  private onTogglePlay: (() => void) | null = null;
+  // Analyser-backed sources are copied into shared memory from the page's own frame loop
+  private mirror: SpectrumMirror | null = null;
+  private mirrorFrameId: number | null = null;
+
+  private onMouseDown = (e: MouseEvent) => this.post({ type: 'pointer', kind: 'down', x: e.clientX, y: e.clientY });
+  private onMouseMove = (e: MouseEvent) => this.post({ type: 'pointer', kind: 'move', x: e.clientX, y: e.clientY });
+  private onMouseUp = () => this.post({ type: 'pointer', kind: 'up', x: 0, y: 0 });
+  private copyMirror = () => {
+    this.mirror!.copy();
+    this.mirrorFrameId = requestAnimationFrame(this.copyMirror);
+  };
+
+  // Needs a canvas that can be transferred and shared memory to read the spectrum from
+  static isSupported(): boolean {
+    return typeof HTMLCanvasElement !== 'undefined' &&
+      'transferControlToOffscreen' in HTMLCanvasElement.prototype &&
+      typeof SharedArrayBuffer !== 'undefined' &&
+      self.crossOriginIsolated === true;
+  }
+
+  // The canvas is handed to the worker by the first initialize() that finds WebGPU there,
+  // and can't be drawn from the page afterwards
+  constructor(canvas: HTMLCanvasElement) {
+    this.canvas = canvas;
+    this.worker = new Worker(new URL('./workers/visualizer.worker.ts', import.meta.url));
+    this.worker.onmessage = (e: MessageEvent<VisualizerResponse>) => this.handleResponse(e.data);
+    this.worker.onerror = (e) => {
+      console.error('Visualizer worker failed:', e.message);
+      this.pending.forEach(resolve => resolve(false));
+      this.pending.clear();
+    };
+
+    canvas.addEventListener('mousedown', this.onMouseDown);
+    window.addEventListener('mousemove', this.onMouseMove);
+    window.addEventListener('mouseup', this.onMouseUp);
+  }
+
+  setMode(mode: VisualizerMode) {
+    this.post({ type: 'mode', mode });
+  }
+
+  setVisible(visible: boolean) {
+    this.post({ type: 'visible', visible });
+  }
+
+  setPlaying(playing: boolean) {
+    this.post({ type: 'playing', playing });
+  }
+
+  setOnBattery(onBattery: boolean) {
+    this.post({ type: 'battery', onBattery, fpsCap: this.batteryFpsCap });
+  }
+
+  // Takes effect with the next setOnBattery
+  setBatteryFpsCap(fps: number) {
+    this.batteryFpsCap = fps;
+  }
+
+  setTogglePlayCallback(cb: () => void) {
+    this.onTogglePlay = cb;
+  }
+
+  async initialize(
+    spectrum: SpectrumSource | null, clock: StateBlockLocation | null = null, stereo: StereoSource | null = null
+  ): Promise<boolean> {
+    this.stopMirror();
+    this.mirror = null;
+
+    let block: SharedSpectrumBlock | null = null;
+    if (spectrum) {
+      block = spectrum.sharedBlock();
+      if (!block) {
+        this.mirror = new SpectrumMirror(spectrum);
+        block = this.mirror.block;
+      }
+    }
+
+    // Without WebGPU in the worker the canvas stays on the page for WebGPUVisualizer
+    let canvas: OffscreenCanvas | null = null;
+    const first = !this.probe;
+    if (!this.probe) this.probe = this.request((id) => ({ type: 'probe', id }));
+    if (!await this.probe) return false;
+    if (first) {
+      canvas = this.canvas.transferControlToOffscreen();
+      this.transferred = true;
+    }
+
+    // A block in a plain ArrayBuffer would only reach the worker as a stale copy
+    const sharedClock = clock && clock.buffer instanceof SharedArrayBuffer
+      ? { buffer: clock.buffer, byteOffset: clock.byteOffset }
+      : null;
+    // Only the engine's block is in shared memory; without one the stereo view stays empty
+    const sharedStereo = stereo ? stereo.sharedBlock() : null;
+    return this.request(
+      (id) => ({ type: 'initialize', id, canvas, spectrum: block, clock: sharedClock, stereo: sharedStereo }),
+      canvas ? [canvas] : []
+    );
+  }
+
+  // Whether the worker has the canvas; if not, a failed initialize() leaves it free for
+  // a main-thread WebGPUVisualizer
+  ownsCanvas(): boolean {
+    return this.transferred;
+  }
+
+  startAnimation(): void {
+    this.post({ type: 'start' });
+    this.stopMirror();
+    if (this.mirror) this.mirrorFrameId = requestAnimationFrame(this.copyMirror);
+  }
+
+  stopAnimation(): void {
+    this.post({ type: 'stop' });
+    this.stopMirror();
+  }
+
+  // Last snapshot the worker posted; at most half a second old
+  getStats(): VisualizerStats {
+    return this.stats;
+  }
+
+  destroy(): void {
+    this.stopMirror();
+    this.post({ type: 'destroy' });
+    this.worker.terminate();
+    this.pending.forEach(resolve => resolve(false));
+    this.pending.clear();
+    this.canvas.removeEventListener('mousedown', this.onMouseDown);
+    window.removeEventListener('mousemove', this.onMouseMove);
+    window.removeEventListener('mouseup', this.onMouseUp);
+  }
+
+  private stopMirror(): void {
+    if (this.mirrorFrameId !== null) {
+      cancelAnimationFrame(this.mirrorFrameId);
+      this.mirrorFrameId = null;
+    }
+  }
+
+  private post(message: VisualizerRequest): void {
+    this.worker.postMessage(message);
+  }
+
+  // Posts a request the worker answers with `ok` under the same id
+  private request(build: (id: number) => VisualizerRequest, transfer: Transferable[] = []): Promise<boolean> {
+    const id = this.nextId++;
+    return new Promise<boolean>((resolve) => {
+      this.pending.set(id, resolve);
+      this.worker.postMessage(build(id), transfer);
+    });
+  }
+
+  private handleResponse(response: VisualizerResponse): void {
+    switch (response.type) {
+      case 'probed':
+      case 'initialized': {
+        const resolve = this.pending.get(response.id);
+        this.pending.delete(response.id);
+        resolve?.(response.ok);
+        break;
+      }
+      case 'stats':
+        this.stats = response.stats;
+        break;
+      case 'togglePlay':
+        this.onTogglePlay?.();
+        break;
+    }
+  }
+}
@@ -0,0 +1,237 @@
+// Min/max overview pyramid for the waveform seek bar. The SDL engine builds it in WASM memory
+// (src/sdl/waveform.h); Web Audio mode builds the same layout here from the AudioBuffer.
+// Either way it is built in time slices and read through WaveformView while it fills in.
+//
+// Layout: u32 levelCount | u32 bucketFrames | u32 totalFrames | u32 builtFrames |
+//         u32 levelOffset[24] | u32 levelBuckets[24] | i8 (min, max) pairs per bucket
+
+export const WAVEFORM_BUCKET_FRAMES = 256;
+const MAX_LEVELS = 24;
+const HEADER_BYTES = 16 + 8 * MAX_LEVELS;
+
+const LEVEL_COUNT = 0;
+const BUCKET_FRAMES = 1;
+const TOTAL_FRAMES = 2;
+const BUILT_FRAMES = 3;
+const LEVEL_OFFSET = 4;
+const LEVEL_BUCKETS = 4 + MAX_LEVELS;
+
+// Frames per build step, and how long one slice of steps may hold the main thread
+const STEP_FRAMES = 1 << 18;
+const SLICE_MS = 4;
+
+// Whether the pyramid at `byteOffset` lies within the `byteLength` bytes from there: the
+// header and every level it points at. Views are only built over pyramids that pass.
+export function waveformFits(buffer: ArrayBufferLike, byteOffset: number, byteLength: number): boolean {
+  if (byteOffset % 4 !== 0 || byteLength < HEADER_BYTES || byteOffset + byteLength > buffer.byteLength) return false;
+  const header = new Uint32Array(buffer, byteOffset, HEADER_BYTES / 4);
+  if (header[LEVEL_COUNT] > MAX_LEVELS) return false;
+  for (let l = 0; l < header[LEVEL_COUNT]; l++) {
+    const offset = header[LEVEL_OFFSET + l];
+    if (offset < HEADER_BYTES || offset + header[LEVEL_BUCKETS + l] * 2 > byteLength) return false;
+  }
+  return true;
+}
+
+export class WaveformView {
+  readonly sampleRate: number;
+  private memory: () => ArrayBufferLike;
+  private byteOffset: number;
+  private buffer: ArrayBufferLike | null = null;
+  private header: Uint32Array | null = null;
+  private levels: Int8Array[] = [];
+
+  constructor(memory: () => ArrayBufferLike, byteOffset: number, sampleRate: number) {
+    this.memory = memory;
+    this.byteOffset = byteOffset;
+    this.sampleRate = sampleRate;
+  }
+
+  // Views are only rebuilt when the backing buffer was replaced (WASM memory growth). A
+  // header pointing outside the buffer reads as an empty pyramid.
+  private views(): Uint32Array {
+    const buffer = this.memory();
+    if (buffer !== this.buffer) {
+      this.buffer = buffer;
+      this.levels = [];
+      if (!waveformFits(buffer, this.byteOffset, buffer.byteLength - this.byteOffset)) {
+        console.error(`Waveform pyramid at byte ${this.byteOffset} runs past its ${buffer.byteLength} byte buffer`);
+        this.header = new Uint32Array(HEADER_BYTES / 4);
+        return this.header;
+      }
+      const header = new Uint32Array(buffer, this.byteOffset, HEADER_BYTES / 4);
+      this.header = header;
+      for (let l = 0; l < header[LEVEL_COUNT]; l++) {
+        this.levels.push(new Int8Array(buffer, this.byteOffset + header[LEVEL_OFFSET + l], header[LEVEL_BUCKETS + l] * 2));
+      }
+    }
+    return this.header!;
+  }
+
+  levelCount(): number {
+    return this.views()[LEVEL_COUNT];
+  }
+
+  totalFrames(): number {
+    return this.views()[TOTAL_FRAMES];
+  }
+
+  builtFrames(): number {
+    return this.views()[BUILT_FRAMES];
+  }
+
+  isComplete(): boolean {
+    const h = this.views();
+    return h[BUILT_FRAMES] >= h[TOTAL_FRAMES];
+  }
+
+  bucketFrames(level: number): number {
+    return this.views()[BUCKET_FRAMES] * 2 ** level;
+  }
+
+  buckets(level: number): number {
+    return this.views()[LEVEL_BUCKETS + level];
+  }
+
+  // Buckets of `level` that are already summarized
+  builtBuckets(level: number): number {
+    const h = this.views();
+    if (h[BUILT_FRAMES] >= h[TOTAL_FRAMES]) return h[LEVEL_BUCKETS + level];
+    return Math.floor(h[BUILT_FRAMES] / (h[BUCKET_FRAMES] * 2 ** level));
+  }
+
+  // (min, max) pairs scaled to -127..127
+  levelData(level: number): Int8Array {
+    this.views();
+    return this.levels[level];
+  }
+
+  // Coarsest level that still has at least one bucket per pixel
+  levelFor(pixels: number): number {
+    const count = this.levelCount();
+    let level = 0;
+    while (level + 1 < count && this.buckets(level + 1) >= pixels) level++;
+    return level;
+  }
+}
+
+// Same algorithm as WaveformPyramid in src/sdl/waveform.cpp, over planar channels
+export class WaveformBuilder {
+  readonly view: WaveformView;
+  private buffer: ArrayBuffer;
+  private header: Uint32Array;
+  private levels: Int8Array[] = [];
+  private channels: Float32Array[];
+  private derived: number[] = [];
+
+  constructor(channels: Float32Array[], sampleRate: number) {
+    this.channels = channels;
+    const frames = channels.length > 0 ? channels[0].length : 0;
+
+    const offsets: number[] = [];
+    const counts: number[] = [];
+    let offset = HEADER_BYTES;
+    let buckets = Math.ceil(frames / WAVEFORM_BUCKET_FRAMES);
+    while (frames > 0 && offsets.length < MAX_LEVELS) {
+      offsets.push(offset);
+      counts.push(buckets);
+      offset += buckets * 2;
+      if (buckets <= 1) break;
+      buckets = Math.ceil(buckets / 2);
+    }
+
+    this.buffer = new ArrayBuffer(offset);
+    this.header = new Uint32Array(this.buffer, 0, HEADER_BYTES / 4);
+    this.header[LEVEL_COUNT] = offsets.length;
+    this.header[BUCKET_FRAMES] = WAVEFORM_BUCKET_FRAMES;
+    this.header[TOTAL_FRAMES] = frames;
+    offsets.forEach((o, l) => {
+      this.header[LEVEL_OFFSET + l] = o;
+      this.header[LEVEL_BUCKETS + l] = counts[l];
+      this.levels.push(new Int8Array(this.buffer, o, counts[l] * 2));
+      this.derived.push(0);
+    });
+
+    const buffer = this.buffer;
+    this.view = new WaveformView(() => buffer, 0, sampleRate);
+  }
+
+  // Summarizes up to `maxFrames` more frames; true once the whole track is done
+  step(maxFrames: number): boolean {
+    const h = this.header;
+    const total = h[TOTAL_FRAMES];
+    const start = h[BUILT_FRAMES];
+    if (start >= total) return true;
+
+    let end = Math.min(total, start + Math.max(maxFrames, WAVEFORM_BUCKET_FRAMES));
+    if (end < total) end -= end % WAVEFORM_BUCKET_FRAMES;
+
+    const base = this.levels[0];
+    for (let bucketStart = start; bucketStart < end; bucketStart += WAVEFORM_BUCKET_FRAMES) {
+      const bucketEnd = Math.min(end, bucketStart + WAVEFORM_BUCKET_FRAMES);
+      let lo = Infinity;
+      let hi = -Infinity;
+      for (const channel of this.channels) {
+        for (let i = bucketStart; i < bucketEnd; i++) {
+          const v = channel[i];
+          if (v < lo) lo = v;
+          if (v > hi) hi = v;
+        }
+      }
+      const bucket = bucketStart / WAVEFORM_BUCKET_FRAMES;
+      base[bucket * 2] = quantize(lo);
+      base[bucket * 2 + 1] = quantize(hi);
+    }
+    h[BUILT_FRAMES] = end;
+
+    const complete = end >= total;
+    this.propagate(complete);
+    if (complete) this.channels = [];
+    return complete;
+  }
+
+  private propagate(complete: boolean): void {
+    const h = this.header;
+    let below = complete ? h[LEVEL_BUCKETS] : Math.floor(h[BUILT_FRAMES] / WAVEFORM_BUCKET_FRAMES);
+    for (let l = 1; l < h[LEVEL_COUNT]; l++) {
+      const ready = complete ? h[LEVEL_BUCKETS + l] : Math.floor(below / 2);
+      const src = this.levels[l - 1];
+      const dst = this.levels[l];
+      const lastBelow = h[LEVEL_BUCKETS + l - 1] - 1;
+      for (let b = this.derived[l]; b < ready; b++) {
+        const left = b * 2;
+        const right = Math.min(left + 1, lastBelow);
+        dst[b * 2] = Math.min(src[left * 2], src[right * 2]);
+        dst[b * 2 + 1] = Math.max(src[left * 2 + 1], src[right * 2 + 1]);
+      }
+      this.derived[l] = ready;
+      below = ready;
+    }
+  }
+}
+
+function quantize(sample: number): number {
+  return Math.round(Math.max(-1, Math.min(1, sample)) * 127);
+}
+
+// Runs `step` in short slices between tasks until it reports completion. Returns a cancel function.
+export function buildInSlices(step: (maxFrames: number) => boolean): () => void {
+  let cancelled = false;
+  let timer: ReturnType<typeof setTimeout> | null = null;
+
+  const slice = () => {
+    timer = null;
+    if (cancelled) return;
+    const started = performance.now();
+    while (performance.now() - started < SLICE_MS) {
+      if (step(STEP_FRAMES)) return;
+    }
+    timer = setTimeout(slice, 0);
+  };
+  timer = setTimeout(slice, 0);
+
+  return () => {
+    cancelled = true;
+    if (timer !== null) clearTimeout(timer);
+  };
+}
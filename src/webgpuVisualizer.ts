@@ -1,23 +1,50 @@
 import { Mat4, Vec3 } from './math';
-
-export type VisualizerMode = 'flat' | '3D';
-
-// WebGPU shader interface for audio visualization
+import { SpectrumSource } from './spectrumSource';
+import { FrameStats, FrameStatsSnapshot } from './frameStats';
+import { FramePacer, PacingSnapshot } from './framePacer';
+import { AudioClock, AudioClockSnapshot } from './audioClock';
+import { StateBlockLocation } from './playerStateBlock';
+import { GpuResources, GpuResourceSnapshot } from './gpuResources';
+import { StereoSource } from './stereoSource';
+
+export type VisualizerMode = 'flat' | 'waterfall' | 'stereo' | '3D';
+
+// Spectrogram rows kept for the waterfall; one per drawn frame
+const WATERFALL_ROWS = 512;
+export type VisualizerStats = FrameStatsSnapshot & PacingSnapshot & AudioClockSnapshot & GpuResourceSnapshot;
+
+// WebGPU shader interface for audio visualization. Runs on a page canvas or, inside
+// src/workers/visualizer.worker.ts, on an OffscreenCanvas with input forwarded from the page.
 export class WebGPUVisualizer {
   private device: GPUDevice | null = null;
   private context: GPUCanvasContext | null = null;
-  private canvas: HTMLCanvasElement;
+  private canvas: HTMLCanvasElement | OffscreenCanvas;
   private animationFrameId: number | null = null;
-  private analyser: AnalyserNode | null = null;
-  private audioData: Uint8Array = new Uint8Array(0);
+  private spectrum: SpectrumSource | null = null;
   private time: number = 0;
   private mode: VisualizerMode = 'flat';
+  // Device, canvas configuration and pipelines are set up once; later initialize() calls
+  // only rebind the audio source
+  private gpuReady: Promise<boolean> | null = null;
+  private resources = new GpuResources();
 
   // --- Common Resources ---
   private waveformUniformBuffer: GPUBuffer | null = null;
   private waveformBindGroup: GPUBindGroup | null = null;
   private waveformPipeline: GPURenderPipeline | null = null;
 
+  // Spectrum upload and the GPU-side level reduction
+  private spectrumBuffer: GPUBuffer | null = null;
+  private spectrumBinCount: number = 0;
+  // Bins the spectrum buffer and waterfall texture have room for; only ever grows
+  private spectrumCapacity: number = 0;
+  private levelBuffer: GPUBuffer | null = null;
+  private levelLayout: GPUBindGroupLayout | null = null;
+  private levelBindGroup: GPUBindGroup | null = null;
+  private waveformLayout: GPUBindGroupLayout | null = null;
+  private levelPipeline: GPUComputePipeline | null = null;
+  private frameUploadBytes: number = 0;
+
   // --- 3D Mode Resources ---
   private cubeVertexBuffer: GPUBuffer | null = null;
   private cubeIndexBuffer: GPUBuffer | null = null;
@@ -31,6 +58,31 @@ export class WebGPUVisualizer {
   private renderTargetTexture: GPUTexture | null = null;
   private renderTargetView: GPUTextureView | null = null;
 
+  // Waterfall: a ring of spectrum rows in a texture, one row written per frame
+  private waterfallTexture: GPUTexture | null = null;
+  private waterfallUniformBuffer: GPUBuffer | null = null;
+  private waterfallLayout: GPUBindGroupLayout | null = null;
+  private waterfallBindGroup: GPUBindGroup | null = null;
+  private waterfallPipeline: GPURenderPipeline | null = null;
+  private waterfallHead: number = 0;
+  private waterfallUniforms = new Uint32Array(4);
+  private waterfallOrigin: [number, number, number] = [0, 0, 0];
+  private waterfallDestination: GPUImageCopyTexture | null = null;
+  private waterfallDataLayout: GPUImageDataLayout = { offset: 0 };
+  private waterfallRowSize: [number, number] = [0, 1];
+
+  // Stereo view: the engine's stereo block uploaded whole and drawn as a point list
+  // (vectorscope), a line strip (scope) and a correlation meter
+  private stereo: StereoSource | null = null;
+  private stereoBuffer: GPUBuffer | null = null;
+  private stereoCapacity: number = 0;
+  private stereoLayout: GPUBindGroupLayout | null = null;
+  private stereoBindGroup: GPUBindGroup | null = null;
+  private stereoPointsPipeline: GPURenderPipeline | null = null;
+  private stereoScopePipeline: GPURenderPipeline | null = null;
+  private stereoMeterPipeline: GPURenderPipeline | null = null;
+  private stereoHeaderReset = new Uint32Array(4);
+
   // Camera State
   private cameraRotation = { x: 0, y: 0 };
   private isDragging = false;
@@ -38,20 +90,141 @@ export class WebGPUVisualizer {
 
   private onTogglePlay: (() => void) | null = null;
 
-  constructor(canvas: HTMLCanvasElement) {
+  // Per-frame scratch state, allocated once so render() creates no garbage of its own
+  // (the GPU command encoder, passes and the swap-chain view are WebGPU's own objects)
+  private uniformData = new Float32Array(4);
+  private uniformWords = new Uint32Array(this.uniformData.buffer);
+  private projection = new Mat4();
+  private view = new Mat4();
+  private mvp = new Mat4();
+  private eye = new Vec3(0, 0, 5);
+  private center = new Vec3(0, 0, 0);
+  private up = new Vec3(0, 1, 0);
+  private depthView: GPUTextureView | null = null;
+  private commandBuffers: GPUCommandBuffer[] = [];
+  private canvasColorAttachment: GPURenderPassColorAttachment = {
+      view: null as unknown as GPUTextureView,
+      clearValue: { r: 0.1, g: 0.1, b: 0.2, a: 1.0 },
+      loadOp: 'clear',
+      storeOp: 'store'
+  };
+  private flatPassDescriptor: GPURenderPassDescriptor = { colorAttachments: [this.canvasColorAttachment] };
+  private screenPassDescriptor: GPURenderPassDescriptor | null = null;
+  private cubeDepthAttachment: GPURenderPassDepthStencilAttachment = {
+      view: null as unknown as GPUTextureView,
+      depthClearValue: 1.0,
+      depthLoadOp: 'clear',
+      depthStoreOp: 'store'
+  };
+  private cubePassDescriptor: GPURenderPassDescriptor = {
+      colorAttachments: [this.canvasColorAttachment],
+      depthStencilAttachment: this.cubeDepthAttachment
+  };
+  private frameStats = new FrameStats();
+  private pacer = new FramePacer();
+  private clock = new AudioClock();
+  // What the clock was last attached to, so a lost device can be brought back on it
+  private clockLocation: StateBlockLocation | null = null;
+  private lastFrameTime: number = 0;
+  private running = false;
+  private animate = (timestamp: number) => {
+      this.animationFrameId = null;
+      // The clock's timebase; the frame is on screen about one refresh interval from now
+      const now = performance.timeOrigin + timestamp;
+      const displayTime = now + this.pacer.frameIntervalMs();
+      this.clock.update();
+
+      let bins = this.spectrum ? this.spectrum.frequencyBytes() : null;
+      if (bins) bins = this.clock.delaySpectrum(bins, now, displayTime);
+
+      const decision = this.pacer.tick(timestamp, bins);
+      if (decision === 'render') {
+          const started = performance.now();
+          this.advanceTime(timestamp, displayTime);
+          this.render(bins);
+          this.frameStats.record(timestamp, performance.now() - started, this.frameUploadBytes);
+      } else {
+          // The gap to the next drawn frame is chosen, not dropped
+          this.frameStats.resetTiming();
+      }
+      // A sleeping loop is restarted by wake()
+      if (decision !== 'sleep') {
+          this.animationFrameId = requestAnimationFrame(this.animate);
+      }
+  };
+
+  constructor(canvas: HTMLCanvasElement | OffscreenCanvas) {
     this.canvas = canvas;
-    this.setupInputListeners();
+    if (typeof HTMLCanvasElement !== 'undefined' && canvas instanceof HTMLCanvasElement) {
+      this.setupInputListeners(canvas);
+    }
   }
 
   setMode(mode: VisualizerMode) {
     this.mode = mode;
+    this.wake();
+  }
+
+  // Pacing inputs: the loop sleeps while hidden or paused, and caps its rate on battery
+  setVisible(visible: boolean) {
+    this.pacer.setVisible(visible);
+    if (visible) this.wake();
+  }
+
+  setPlaying(playing: boolean) {
+    this.pacer.setPlaying(playing, performance.now());
+    this.wake();
+  }
+
+  setOnBattery(onBattery: boolean) {
+    this.pacer.setOnBattery(onBattery);
+  }
+
+  setBatteryFpsCap(fps: number) {
+    this.pacer.setBatteryFpsCap(fps);
+  }
+
+  // Keeps frames coming at full rate for a while, restarting the loop if it slept
+  private wake() {
+    const now = performance.now();
+    this.pacer.poke(now);
+    if (this.running && this.animationFrameId === null) {
+      this.pacer.wake(now);
+      this.frameStats.resetTiming();
+      this.animationFrameId = requestAnimationFrame(this.animate);
+    }
   }
 
   setTogglePlayCallback(cb: () => void) {
       this.onTogglePlay = cb;
   }
 
-  async initialize(analyser: AnalyserNode): Promise<boolean> {
+  // `spectrum` may be null (no engine yet); the visuals then run without audio input.
+  // `clock` is the player's state block; without it the visuals run on wall time.
+  // `stereo` feeds the stereo mode; without it that mode shows an empty meter.
+  // The first call sets up the GPU; later ones (output mode switches) only rebind the source.
+  async initialize(
+    spectrum: SpectrumSource | null, clock: StateBlockLocation | null = null, stereo: StereoSource | null = null
+  ): Promise<boolean> {
+    const started = performance.now();
+    const fresh = this.gpuReady === null;
+    if (fresh) this.gpuReady = this.initGpu();
+    if (!(await this.gpuReady)) {
+      this.gpuReady = null;
+      return false;
+    }
+
+    const bindStarted = performance.now();
+    this.bindSource(spectrum, clock, stereo);
+    if (fresh) {
+      this.resources.recordInit(performance.now() - started);
+    } else {
+      this.resources.recordSwitch(performance.now() - bindStarted);
+    }
+    return true;
+  }
+
+  private async initGpu(): Promise<boolean> {
     if (!navigator.gpu) {
       console.warn('WebGPU not supported in this browser');
       return false;
@@ -64,8 +237,9 @@ export class WebGPUVisualizer {
         return false;
       }
 
-      this.device = await adapter.requestDevice();
-      this.context = this.canvas.getContext('webgpu') as unknown as GPUCanvasContext;
+      const device = await adapter.requestDevice();
+      this.device = device;
+      this.context = (this.canvas as HTMLCanvasElement).getContext('webgpu') as unknown as GPUCanvasContext; // same call on OffscreenCanvas
       
       if (!this.context) {
         console.error('Could not get WebGPU context');
@@ -74,16 +248,34 @@ export class WebGPUVisualizer {
 
       const format = navigator.gpu.getPreferredCanvasFormat();
       this.context.configure({
-        device: this.device,
+        device,
         format: format,
         alphaMode: 'opaque'
       });
 
-      this.analyser = analyser;
-      this.audioData = new Uint8Array(analyser.frequencyBinCount);
+      // A lost device takes its resources with it. Unless it was destroyed on purpose (a
+      // driver reset, the GPU process restarting) the visuals start over on a new one.
+      device.lost.then((info) => {
+        if (this.device !== device || info.reason === 'destroyed') return;
+        console.warn('WebGPU device lost:', info.message);
+        this.device = null;
+        this.gpuReady = null;
+        this.spectrumBuffer = null;
+        this.waterfallTexture = null;
+        this.depthTexture = null;
+        this.stereoBuffer = null;
+        this.spectrumCapacity = 0;
+        this.stereoCapacity = 0;
+        this.resources.forget();
+        this.initialize(this.spectrum, this.clockLocation, this.stereo).then((ok) => {
+          if (!ok) console.error('Could not recover from the lost WebGPU device');
+        });
+      });
 
-      await this.initWaveformResources(format);
-      await this.init3DResources(format);
+      this.initWaveformResources(format);
+      this.init3DResources(format);
+      this.initWaterfallResources(format);
+      this.initStereoResources(format);
 
       return true;
     } catch (error) {
@@ -92,27 +284,185 @@ export class WebGPUVisualizer {
     }
   }
 
-  private async initWaveformResources(canvasFormat: GPUTextureFormat) {
+  // Points the visuals at a new audio source. Nothing is allocated unless the source has more
+  // bins than any before it, so repeated switches leave GPU memory where it was.
+  private bindSource(spectrum: SpectrumSource | null, clock: StateBlockLocation | null, stereo: StereoSource | null) {
+    this.spectrum = spectrum;
+    // Byte bins as they come from the source, four to a word. writeBuffer needs a multiple of 4.
+    const binCount = spectrum ? spectrum.binCount & ~3 : 0;
+    this.ensureSpectrumCapacity(binCount);
+    this.spectrumBinCount = binCount;
+
+    // The previous source's history means nothing against the new one's bins
+    const width = Math.max(binCount, 4);
+    this.waterfallHead = 0;
+    this.waterfallDataLayout.bytesPerRow = width;
+    this.waterfallRowSize[0] = width;
+    this.clearWaterfall();
+
+    this.stereo = stereo;
+    this.ensureStereoCapacity(stereo ? stereo.byteLength : 0);
+    // Zero counts and correlation until the new source's first upload
+    if (this.device && this.stereoBuffer) {
+      this.device.queue.writeBuffer(this.stereoBuffer, 0, this.stereoHeaderReset);
+    }
+
+    this.clockLocation = clock;
+    this.clock.attach(clock, spectrum ? spectrum.binCount : 0);
+    this.wake();
+  }
+
+  // (Re)creates the bin-sized resources and the bind groups that reference them
+  private ensureSpectrumCapacity(binCount: number) {
     if (!this.device) return;
+    const capacity = Math.max(binCount, 4);
+    if (this.spectrumBuffer && capacity <= this.spectrumCapacity) return;
+
+    this.resources.release(this.spectrumBuffer);
+    this.resources.release(this.waterfallTexture);
+    this.spectrumBuffer = this.resources.buffer(this.device, {
+        size: capacity,
+        usage: GPUBufferUsage.STORAGE | GPUBufferUsage.COPY_DST
+    });
+    // One texel per bin across, one row per frame down; rows are addressed as a ring
+    this.waterfallTexture = this.resources.texture(this.device, {
+        size: [capacity, WATERFALL_ROWS],
+        format: 'r8unorm',
+        usage: GPUTextureUsage.TEXTURE_BINDING | GPUTextureUsage.COPY_DST
+    });
+    this.waterfallDestination = { texture: this.waterfallTexture, origin: this.waterfallOrigin };
+    this.spectrumCapacity = capacity;
+
+    this.levelBindGroup = this.device.createBindGroup({
+        layout: this.levelLayout!,
+        entries: [
+            { binding: 0, resource: { buffer: this.waveformUniformBuffer! } },
+            { binding: 1, resource: { buffer: this.spectrumBuffer } },
+            { binding: 2, resource: { buffer: this.levelBuffer! } }
+        ]
+    });
+    this.waveformBindGroup = this.device.createBindGroup({
+        layout: this.waveformLayout!,
+        entries: [
+            { binding: 0, resource: { buffer: this.waveformUniformBuffer! } },
+            { binding: 1, resource: { buffer: this.spectrumBuffer } },
+            { binding: 2, resource: { buffer: this.levelBuffer! } }
+        ]
+    });
+    this.waterfallBindGroup = this.device.createBindGroup({
+        layout: this.waterfallLayout!,
+        entries: [
+            { binding: 0, resource: { buffer: this.waterfallUniformBuffer! } },
+            { binding: 1, resource: this.waterfallTexture.createView() }
+        ]
+    });
+  }
+
+  private ensureStereoCapacity(byteLength: number) {
+    if (!this.device || !this.stereoLayout) return;
+    // Header plus at least one element of the data array, the binding's minimum size
+    const capacity = Math.max(byteLength, 32);
+    if (this.stereoBuffer && capacity <= this.stereoCapacity) return;
+
+    this.resources.release(this.stereoBuffer);
+    this.stereoBuffer = this.resources.buffer(this.device, {
+        size: capacity,
+        usage: GPUBufferUsage.STORAGE | GPUBufferUsage.COPY_DST
+    });
+    this.stereoCapacity = capacity;
+    this.stereoBindGroup = this.device.createBindGroup({
+        layout: this.stereoLayout,
+        entries: [{ binding: 0, resource: { buffer: this.stereoBuffer } }]
+    });
+  }
+
+  private clearWaterfall() {
+      if (!this.device || !this.waterfallTexture) return;
+      const size = [this.spectrumCapacity, WATERFALL_ROWS];
+      this.device.queue.writeTexture(
+          { texture: this.waterfallTexture },
+          new Uint8Array(size[0] * size[1]),
+          { offset: 0, bytesPerRow: size[0] },
+          size
+      );
+  }
 
-    this.waveformUniformBuffer = this.device.createBuffer({
-        size: 32,
+  // Pipelines and fixed-size buffers; the spectrum buffer and bind groups come with the source
+  private initWaveformResources(canvasFormat: GPUTextureFormat) {
+    if (!this.device) return;
+
+    this.waveformUniformBuffer = this.resources.buffer(this.device, {
+        size: 16,
         usage: GPUBufferUsage.UNIFORM | GPUBufferUsage.COPY_DST
     });
 
-    const shaderCode = `
+    this.levelBuffer = this.resources.buffer(this.device, {
+        size: 4,
+        usage: GPUBufferUsage.STORAGE
+    });
+
+    const commonCode = `
       struct Uniforms {
         resolution: vec2<f32>,
         time: f32,
-        audioLevel: f32,
+        binCount: u32,
       };
       @group(0) @binding(0) var<uniform> uniforms: Uniforms;
+      @group(0) @binding(1) var<storage, read> spectrum: array<u32>;
+    `;
+
+    // Mean bin magnitude, reduced on the GPU so the fragment shader can use it as the overall level
+    const levelCode = commonCode + `
+      @group(0) @binding(2) var<storage, read_write> level: array<f32>;
+
+      var<workgroup> partial: array<u32, 256>;
+
+      @compute @workgroup_size(256)
+      fn level_main(@builtin(local_invocation_index) i: u32) {
+        var sum = 0u;
+        let words = uniforms.binCount / 4u;
+        for (var w = i; w < words; w += 256u) {
+          let v = spectrum[w];
+          sum += (v & 0xffu) + ((v >> 8u) & 0xffu) + ((v >> 16u) & 0xffu) + (v >> 24u);
+        }
+        partial[i] = sum;
+        workgroupBarrier();
+        for (var stride = 128u; stride > 0u; stride >>= 1u) {
+          if (i < stride) {
+            partial[i] += partial[i + stride];
+          }
+          workgroupBarrier();
+        }
+        if (i == 0u) {
+          level[0] = select(0.0, f32(partial[0]) / (f32(uniforms.binCount) * 255.0), uniforms.binCount > 0u);
+        }
+      }
+    `;
+
+    const shaderCode = commonCode + `
+      @group(0) @binding(2) var<storage, read> level: array<f32>;
 
       struct VertexOutput {
         @builtin(position) position: vec4<f32>,
         @location(0) uv: vec2<f32>,
       };
 
+      fn bin(index: u32) -> f32 {
+        let word = spectrum[index >> 2u];
+        return f32((word >> ((index & 3u) * 8u)) & 0xffu) / 255.0;
+      }
+
+      // Magnitude at x in 0..1, log-spaced so the low end isn't squeezed into a few pixels
+      fn spectrumAt(x: f32) -> f32 {
+        if (uniforms.binCount < 2u) {
+          return 0.0;
+        }
+        let last = uniforms.binCount - 1u;
+        let pos = pow(f32(last), clamp(x, 0.0, 1.0));
+        let i = u32(pos);
+        return mix(bin(min(i, last)), bin(min(i + 1u, last)), fract(pos));
+      }
+
       @vertex
       fn vertex_main(@builtin(vertex_index) vertexIndex: u32) -> VertexOutput {
         var output: VertexOutput;
@@ -129,18 +479,21 @@ export class WebGPUVisualizer {
       fn fragment_main(input: VertexOutput) -> @location(0) vec4<f32> {
         let uv = input.uv;
         let time = uniforms.time;
-        let audio = uniforms.audioLevel;
+        let audio = level[0];
+        let magnitude = spectrumAt(uv.x);
         
-        let aspect = uniforms.resolution.x / uniforms.resolution.y;
         var p = (uv - 0.5) * 2.0;
         
-        // Circular waveform for 3D screen? Or standard linear?
-        // Let's keep the linear wave.
-        let wave = sin(p.x * 3.0 + time + audio * 3.0) * 0.5 * audio;
+        // The line follows the overall level; the local band adds detail along it
+        let wave = sin(p.x * 3.0 + time + audio * 3.0) * 0.5 * (audio + magnitude * 0.5);
         let dist = abs(p.y - wave);
         let glow = 0.05 / (dist + 0.01);
         
-        let color = vec3<f32>(0.2, 0.5, 1.0) * glow;
+        var color = vec3<f32>(0.2, 0.5, 1.0) * glow;
+
+        // Faint spectrum bars rising from the bottom
+        let bar = step(uv.y, magnitude * 0.6) * step(0.2, fract(uv.x * 96.0));
+        color += vec3<f32>(0.1, 0.25, 0.5) * bar;
         
         // Add a border/grid effect to look like a screen
         let grid = step(0.95, fract(uv.x * 20.0)) + step(0.95, fract(uv.y * 20.0));
@@ -149,39 +502,211 @@ export class WebGPUVisualizer {
         return vec4<f32>(screenColor, 1.0);
       }
     `;
-    const module = this.device.createShaderModule({ code: shaderCode });
 
-    this.waveformBindGroup = this.device.createBindGroup({
-        layout: this.device.createBindGroupLayout({
-            entries: [{ binding: 0, visibility: GPUShaderStage.FRAGMENT, buffer: { type: 'uniform' } }]
-        }),
-        entries: [{ binding: 0, resource: { buffer: this.waveformUniformBuffer } }]
+    const levelLayout = this.device.createBindGroupLayout({
+        entries: [
+            { binding: 0, visibility: GPUShaderStage.COMPUTE, buffer: { type: 'uniform' } },
+            { binding: 1, visibility: GPUShaderStage.COMPUTE, buffer: { type: 'read-only-storage' } },
+            { binding: 2, visibility: GPUShaderStage.COMPUTE, buffer: { type: 'storage' } }
+        ]
+    });
+    this.levelLayout = levelLayout;
+    this.levelPipeline = this.device.createComputePipeline({
+        layout: this.device.createPipelineLayout({ bindGroupLayouts: [levelLayout] }),
+        compute: { module: this.device.createShaderModule({ code: levelCode }), entryPoint: 'level_main' }
     });
 
-    const layout = this.device.createPipelineLayout({
-        bindGroupLayouts: [this.device.createBindGroupLayout({
-            entries: [{ binding: 0, visibility: GPUShaderStage.FRAGMENT, buffer: { type: 'uniform' } }]
-        })]
+    const module = this.device.createShaderModule({ code: shaderCode });
+
+    const waveformLayout = this.device.createBindGroupLayout({
+        entries: [
+            { binding: 0, visibility: GPUShaderStage.FRAGMENT, buffer: { type: 'uniform' } },
+            { binding: 1, visibility: GPUShaderStage.FRAGMENT, buffer: { type: 'read-only-storage' } },
+            { binding: 2, visibility: GPUShaderStage.FRAGMENT, buffer: { type: 'read-only-storage' } }
+        ]
     });
 
+    this.waveformLayout = waveformLayout;
+
     this.waveformPipeline = this.device.createRenderPipeline({
-        layout,
+        layout: this.device.createPipelineLayout({ bindGroupLayouts: [waveformLayout] }),
         vertex: { module, entryPoint: 'vertex_main' },
         fragment: { module, entryPoint: 'fragment_main', targets: [{ format: canvasFormat }] },
         primitive: { topology: 'triangle-list' }
     });
   }
 
-  private async init3DResources(canvasFormat: GPUTextureFormat) {
+  private initWaterfallResources(canvasFormat: GPUTextureFormat) {
+      if (!this.device) return;
+
+      this.waterfallUniformBuffer = this.resources.buffer(this.device, {
+          size: 16,
+          usage: GPUBufferUsage.UNIFORM | GPUBufferUsage.COPY_DST
+      });
+
+      const shaderCode = `
+        struct WaterfallUniforms {
+          head: u32,
+          rows: u32,
+          binCount: u32,
+          pad: u32,
+        };
+        @group(0) @binding(0) var<uniform> uniforms: WaterfallUniforms;
+        @group(0) @binding(1) var history: texture_2d<f32>;
+
+        struct VertexOutput {
+          @builtin(position) position: vec4<f32>,
+          @location(0) uv: vec2<f32>,
+        };
+
+        @vertex
+        fn vertex_main(@builtin(vertex_index) vertexIndex: u32) -> VertexOutput {
+          var output: VertexOutput;
+          var pos = array<vec2<f32>, 6>(
+            vec2<f32>(-1.0, -1.0), vec2<f32>(1.0, -1.0), vec2<f32>(-1.0, 1.0),
+            vec2<f32>(-1.0, 1.0), vec2<f32>(1.0, -1.0), vec2<f32>(1.0, 1.0)
+          );
+          output.position = vec4<f32>(pos[vertexIndex], 0.0, 1.0);
+          output.uv = pos[vertexIndex] * 0.5 + 0.5;
+          return output;
+        }
+
+        @fragment
+        fn fragment_main(input: VertexOutput) -> @location(0) vec4<f32> {
+          if (uniforms.binCount < 2u) {
+            return vec4<f32>(0.0, 0.02, 0.08, 1.0);
+          }
+          // Newest row at the right edge; head is the row written last
+          let age = min(u32((1.0 - input.uv.x) * f32(uniforms.rows)), uniforms.rows - 1u);
+          let row = (uniforms.head + uniforms.rows - age) % uniforms.rows;
+          // Log-spaced frequency axis, lows at the bottom
+          let bin = u32(pow(f32(uniforms.binCount - 1u), clamp(input.uv.y, 0.0, 1.0)));
+          let v = textureLoad(history, vec2<u32>(bin, row), 0).r;
+
+          let low = mix(vec3<f32>(0.0, 0.02, 0.08), vec3<f32>(0.0, 0.6, 1.0), smoothstep(0.0, 0.6, v));
+          return vec4<f32>(mix(low, vec3<f32>(1.0, 1.0, 1.0), smoothstep(0.6, 1.0, v)), 1.0);
+        }
+      `;
+      const module = this.device.createShaderModule({ code: shaderCode });
+
+      const layout = this.device.createBindGroupLayout({
+          entries: [
+              { binding: 0, visibility: GPUShaderStage.FRAGMENT, buffer: { type: 'uniform' } },
+              { binding: 1, visibility: GPUShaderStage.FRAGMENT, texture: { sampleType: 'float' } }
+          ]
+      });
+      this.waterfallLayout = layout;
+      this.waterfallPipeline = this.device.createRenderPipeline({
+          layout: this.device.createPipelineLayout({ bindGroupLayouts: [layout] }),
+          vertex: { module, entryPoint: 'vertex_main' },
+          fragment: { module, entryPoint: 'fragment_main', targets: [{ format: canvasFormat }] },
+          primitive: { topology: 'triangle-list' }
+      });
+  }
+
+  private initStereoResources(canvasFormat: GPUTextureFormat) {
+      if (!this.device) return;
+
+      const shaderCode = `
+        struct Stereo {
+          seq: u32,
+          pointCount: u32,
+          scopeSamples: u32,
+          correlation: f32,
+          // points[pointCount] as (side, mid) pairs, then scope[scopeSamples]
+          data: array<f32>,
+        };
+        @group(0) @binding(0) var<storage, read> stereo: Stereo;
+
+        struct VertexOutput {
+          @builtin(position) position: vec4<f32>,
+          @location(0) color: vec4<f32>,
+        };
+
+        // Side across, mid up: mono is a vertical line, out-of-phase a horizontal one.
+        // Older points are dimmer.
+        @vertex
+        fn points_main(@builtin(vertex_index) i: u32) -> VertexOutput {
+          var output: VertexOutput;
+          let side = stereo.data[i * 2u];
+          let mid = stereo.data[i * 2u + 1u];
+          output.position = vec4<f32>(clamp(side, -1.0, 1.0), clamp(mid, -1.0, 1.0), 0.0, 1.0);
+          let age = f32(i + 1u) / f32(max(stereo.pointCount, 1u));
+          output.color = vec4<f32>(vec3<f32>(0.3, 1.0, 0.6) * (0.25 + 0.75 * age), 1.0);
+          return output;
+        }
+
+        @vertex
+        fn scope_main(@builtin(vertex_index) i: u32) -> VertexOutput {
+          var output: VertexOutput;
+          let x = f32(i) / f32(max(stereo.scopeSamples, 2u) - 1u) * 2.0 - 1.0;
+          let y = stereo.data[stereo.pointCount * 2u + i];
+          output.position = vec4<f32>(x, clamp(y, -1.0, 1.0) * 0.9, 0.0, 1.0);
+          output.color = vec4<f32>(0.0, 0.6, 1.0, 1.0);
+          return output;
+        }
+
+        // Correlation meter: a track across the viewport, filled from the centre towards
+        // the reading, red for out of phase and green for in phase
+        @vertex
+        fn meter_main(@builtin(vertex_index) i: u32) -> VertexOutput {
+          var output: VertexOutput;
+          var corner = array<vec2<f32>, 6>(
+            vec2<f32>(0.0, 0.0), vec2<f32>(1.0, 0.0), vec2<f32>(0.0, 1.0),
+            vec2<f32>(0.0, 1.0), vec2<f32>(1.0, 0.0), vec2<f32>(1.0, 1.0)
+          );
+          let c = corner[i % 6u];
+          let correlation = clamp(stereo.correlation, -1.0, 1.0);
+          if (i < 6u) {
+            output.position = vec4<f32>(c.x * 2.0 - 1.0, c.y * 2.0 - 1.0, 0.0, 1.0);
+            output.color = vec4<f32>(0.12, 0.12, 0.16, 1.0);
+          } else {
+            output.position = vec4<f32>(c.x * correlation, c.y * 1.6 - 0.8, 0.0, 1.0);
+            output.color = vec4<f32>(mix(vec3<f32>(1.0, 0.25, 0.2), vec3<f32>(0.3, 1.0, 0.4), correlation * 0.5 + 0.5), 1.0);
+          }
+          return output;
+        }
+
+        @fragment
+        fn fragment_main(input: VertexOutput) -> @location(0) vec4<f32> {
+          return input.color;
+        }
+      `;
+      const module = this.device.createShaderModule({ code: shaderCode });
+
+      this.stereoLayout = this.device.createBindGroupLayout({
+          entries: [{ binding: 0, visibility: GPUShaderStage.VERTEX, buffer: { type: 'read-only-storage' } }]
+      });
+      const layout = this.device.createPipelineLayout({ bindGroupLayouts: [this.stereoLayout] });
+      const pipeline = (entryPoint: string, topology: GPUPrimitiveTopology) => this.device!.createRenderPipeline({
+          layout,
+          vertex: { module, entryPoint },
+          fragment: { module, entryPoint: 'fragment_main', targets: [{ format: canvasFormat }] },
+          primitive: { topology }
+      });
+      this.stereoPointsPipeline = pipeline('points_main', 'point-list');
+      this.stereoScopePipeline = pipeline('scope_main', 'line-strip');
+      this.stereoMeterPipeline = pipeline('meter_main', 'triangle-list');
+  }
+
+  private init3DResources(canvasFormat: GPUTextureFormat) {
       if (!this.device) return;
 
       const texSize = 512;
-      this.renderTargetTexture = this.device.createTexture({
+      this.renderTargetTexture = this.resources.texture(this.device, {
           size: [texSize, texSize],
           format: canvasFormat,
           usage: GPUTextureUsage.RENDER_ATTACHMENT | GPUTextureUsage.TEXTURE_BINDING
       });
       this.renderTargetView = this.renderTargetTexture.createView();
+      this.screenPassDescriptor = {
+          colorAttachments: [{
+              view: this.renderTargetView,
+              clearValue: { r: 0, g: 0, b: 0, a: 1 },
+              loadOp: 'clear',
+              storeOp: 'store'
+          }]
+      };
 
       this.sampler = this.device.createSampler({
           magFilter: 'linear',
@@ -231,19 +756,19 @@ export class WebGPUVisualizer {
           20, 21, 22, 20, 22, 23  // Left
       ]);
 
-      this.cubeVertexBuffer = this.device.createBuffer({
+      this.cubeVertexBuffer = this.resources.buffer(this.device, {
           size: vertexData.byteLength,
           usage: GPUBufferUsage.VERTEX | GPUBufferUsage.COPY_DST,
       });
       this.device.queue.writeBuffer(this.cubeVertexBuffer, 0, vertexData);
 
-      this.cubeIndexBuffer = this.device.createBuffer({
+      this.cubeIndexBuffer = this.resources.buffer(this.device, {
           size: indexData.byteLength,
           usage: GPUBufferUsage.INDEX | GPUBufferUsage.COPY_DST,
       });
       this.device.queue.writeBuffer(this.cubeIndexBuffer, 0, indexData);
 
-      this.cubeUniformBuffer = this.device.createBuffer({
+      this.cubeUniformBuffer = this.resources.buffer(this.device, {
           size: 64,
           usage: GPUBufferUsage.UNIFORM | GPUBufferUsage.COPY_DST
       });
@@ -353,26 +878,33 @@ struct Uniforms {
       });
   }
 
-  private setupInputListeners() {
-      this.canvas.addEventListener('mousedown', (e) => {
-          this.isDragging = true;
-          this.lastMousePos = { x: e.clientX, y: e.clientY };
-          this.checkInteraction(e.clientX, e.clientY);
-      });
+  private setupInputListeners(canvas: HTMLCanvasElement) {
+      canvas.addEventListener('mousedown', (e) => this.pointerDown(e.clientX, e.clientY));
+      window.addEventListener('mousemove', (e) => this.pointerMove(e.clientX, e.clientY));
+      window.addEventListener('mouseup', () => this.pointerUp());
+  }
 
-      window.addEventListener('mousemove', (e) => {
-          if (this.isDragging && this.mode === '3D') {
-              const deltaX = e.clientX - this.lastMousePos.x;
-              const deltaY = e.clientY - this.lastMousePos.y;
-              this.cameraRotation.y += deltaX * 0.01;
-              this.cameraRotation.x += deltaY * 0.01;
-              this.lastMousePos = { x: e.clientX, y: e.clientY };
-          }
-      });
+  // Pointer input in client coordinates; only deltas matter, so forwarded events need no mapping
+  pointerDown(x: number, y: number) {
+      this.wake();
+      this.isDragging = true;
+      this.lastMousePos = { x, y };
+      this.checkInteraction(x, y);
+  }
 
-      window.addEventListener('mouseup', () => {
-          this.isDragging = false;
-      });
+  pointerMove(x: number, y: number) {
+      if (this.isDragging && this.mode === '3D') {
+          const deltaX = x - this.lastMousePos.x;
+          const deltaY = y - this.lastMousePos.y;
+          this.cameraRotation.y += deltaX * 0.01;
+          this.cameraRotation.x += deltaY * 0.01;
+          this.lastMousePos = { x, y };
+          this.wake();
+      }
+  }
+
+  pointerUp() {
+      this.isDragging = false;
   }
 
   private checkInteraction(mx: number, my: number) {
@@ -382,75 +914,179 @@ struct Uniforms {
       }
   }
 
-  render(): void {
+  // Shader time follows what is heard at display time, so motion stays locked to the audio;
+  // without a clock it advances by the real frame interval
+  private advanceTime(timestamp: number, displayTime: number) {
+    const dt = this.lastFrameTime > 0 ? Math.min((timestamp - this.lastFrameTime) / 1000, 0.1) : 0;
+    this.lastFrameTime = timestamp;
+    this.time = this.clock.isAttached() ? this.clock.audibleAt(displayTime) : this.time + dt;
+  }
+
+  render(bins: Uint8Array | null): void {
     if (!this.device || !this.context || !this.waveformPipeline) return;
 
-    let audioLevel = 0;
-    if (this.analyser && this.audioData.length > 0) {
-      const tempData = new Uint8Array(this.analyser.frequencyBinCount);
-      this.analyser.getByteFrequencyData(tempData);
-      let sum = 0;
-      for (let i = 0; i < tempData.length; i++) sum += tempData[i];
-      audioLevel = sum / tempData.length / 255.0;
+    this.frameUploadBytes = 0;
+
+    if (this.mode === 'waterfall') {
+        this.renderWaterfall(bins);
+        return;
+    }
+    if (this.mode === 'stereo') {
+        this.renderStereo();
+        return;
     }
-    this.time += 0.016;
 
+    this.uploadSpectrum(bins);
     if (this.mode === 'flat') {
-        this.renderFlat(audioLevel);
+        this.renderFlat();
     } else {
-        this.render3D(audioLevel);
+        this.render3D();
     }
   }
 
-  private renderFlat(audioLevel: number) {
-      if (!this.device || !this.context || !this.waveformPipeline || !this.waveformBindGroup) return;
+  // Writes this frame's bins as the next ring row: the upload is one row however long the history
+  private renderWaterfall(bins: Uint8Array | null) {
+      if (!this.device || !this.context || !this.waterfallPipeline || !this.waterfallBindGroup || !this.waterfallDestination) return;
 
-      this.device.queue.writeBuffer(this.waveformUniformBuffer!, 0, new Float32Array([
-          this.canvas.width, this.canvas.height, this.time, audioLevel
-      ]));
+      const width = this.waterfallRowSize[0];
+      if (bins && this.spectrumBinCount > 0 && bins.length >= width) {
+          this.waterfallHead = (this.waterfallHead + 1) % WATERFALL_ROWS;
+          this.waterfallOrigin[1] = this.waterfallHead;
+          this.device.queue.writeTexture(this.waterfallDestination, bins, this.waterfallDataLayout, this.waterfallRowSize);
+          this.frameUploadBytes += width;
+      }
+
+      const u = this.waterfallUniforms;
+      u[0] = this.waterfallHead;
+      u[1] = WATERFALL_ROWS;
+      u[2] = this.spectrumBinCount;
+      this.device.queue.writeBuffer(this.waterfallUniformBuffer!, 0, u);
+      this.frameUploadBytes += u.byteLength;
 
       const commandEncoder = this.device.createCommandEncoder();
-      const textureView = this.context.getCurrentTexture().createView();
+      const attachment = this.canvasColorAttachment;
+      attachment.view = this.context.getCurrentTexture().createView();
 
-      const pass = commandEncoder.beginRenderPass({
-          colorAttachments: [{
-              view: textureView,
-              clearValue: { r: 0.1, g: 0.1, b: 0.2, a: 1.0 },
-              loadOp: 'clear',
-              storeOp: 'store'
-          }]
-      });
+      const pass = commandEncoder.beginRenderPass(this.flatPassDescriptor);
+      pass.setPipeline(this.waterfallPipeline);
+      pass.setBindGroup(0, this.waterfallBindGroup);
+      pass.draw(6);
+      pass.end();
+      this.submit(commandEncoder);
+  }
+
+  // Vectorscope on the left, triggered scope on the right, correlation meter along the bottom,
+  // each in its own viewport so the shaders work in plain clip space
+  private renderStereo() {
+      if (!this.device || !this.context || !this.stereoBindGroup || !this.stereoPointsPipeline ||
+          !this.stereoScopePipeline || !this.stereoMeterPipeline) return;
+
+      const stereo = this.stereo;
+      if (stereo) {
+          const bytes = stereo.blockBytes();
+          this.device.queue.writeBuffer(this.stereoBuffer!, 0, bytes);
+          this.frameUploadBytes += bytes.byteLength;
+      }
+
+      const commandEncoder = this.device.createCommandEncoder();
+      const attachment = this.canvasColorAttachment;
+      attachment.view = this.context.getCurrentTexture().createView();
+      (attachment.clearValue as GPUColorDict).r = 0.02;
+      (attachment.clearValue as GPUColorDict).g = 0.02;
+      (attachment.clearValue as GPUColorDict).b = 0.05;
+
+      const width = this.canvas.width;
+      const height = this.canvas.height;
+      const meterHeight = Math.max(8, Math.round(height * 0.06));
+      const top = height - meterHeight;
+      const scopeSize = Math.min(width / 2, top);
+
+      const pass = commandEncoder.beginRenderPass(this.flatPassDescriptor);
+      pass.setBindGroup(0, this.stereoBindGroup);
+      if (stereo) {
+          pass.setViewport((width / 2 - scopeSize) / 2, (top - scopeSize) / 2, scopeSize, scopeSize, 0, 1);
+          pass.setPipeline(this.stereoPointsPipeline);
+          pass.draw(stereo.pointCount);
+          pass.setViewport(width / 2, 0, width / 2, top, 0, 1);
+          pass.setPipeline(this.stereoScopePipeline);
+          pass.draw(stereo.scopeSamples);
+      }
+      pass.setViewport(0, top, width, meterHeight, 0, 1);
+      pass.setPipeline(this.stereoMeterPipeline);
+      pass.draw(12);
+      pass.end();
+      this.submit(commandEncoder);
+  }
+
+  // The raw bins go to the GPU as-is; everything derived from them happens in the shaders
+  private uploadSpectrum(bins: Uint8Array | null) {
+      if (!bins || this.spectrumBinCount === 0) return;
+      const size = Math.min(bins.length & ~3, this.spectrumBinCount);
+      this.device!.queue.writeBuffer(this.spectrumBuffer!, 0, bins, 0, size);
+      this.frameUploadBytes += size;
+  }
+
+  private encodeLevel(commandEncoder: GPUCommandEncoder) {
+      const pass = commandEncoder.beginComputePass();
+      pass.setPipeline(this.levelPipeline!);
+      pass.setBindGroup(0, this.levelBindGroup!);
+      pass.dispatchWorkgroups(1);
+      pass.end();
+  }
+
+  private renderFlat() {
+      if (!this.device || !this.context || !this.waveformPipeline || !this.waveformBindGroup) return;
+
+      this.writeWaveformUniforms(this.canvas.width, this.canvas.height);
+
+      const commandEncoder = this.device.createCommandEncoder();
+      this.encodeLevel(commandEncoder);
+      const attachment = this.canvasColorAttachment;
+      attachment.view = this.context.getCurrentTexture().createView();
+      (attachment.clearValue as GPUColorDict).r = 0.1;
+      (attachment.clearValue as GPUColorDict).g = 0.1;
+      (attachment.clearValue as GPUColorDict).b = 0.2;
+
+      const pass = commandEncoder.beginRenderPass(this.flatPassDescriptor);
       pass.setPipeline(this.waveformPipeline);
       pass.setBindGroup(0, this.waveformBindGroup);
       pass.draw(6);
       pass.end();
-      this.device.queue.submit([commandEncoder.finish()]);
+      this.submit(commandEncoder);
+  }
+
+  private writeWaveformUniforms(width: number, height: number) {
+      const data = this.uniformData;
+      data[0] = width;
+      data[1] = height;
+      data[2] = this.time;
+      this.uniformWords[3] = this.spectrumBinCount;
+      this.device!.queue.writeBuffer(this.waveformUniformBuffer!, 0, data);
+      this.frameUploadBytes += data.byteLength;
+  }
+
+  private submit(commandEncoder: GPUCommandEncoder) {
+      this.commandBuffers[0] = commandEncoder.finish();
+      this.device!.queue.submit(this.commandBuffers);
+      this.commandBuffers.length = 0;
   }
 
-  private render3D(audioLevel: number) {
-     if (!this.device || !this.context || !this.cubePipeline || !this.renderTargetView || !this.cubeBindGroup || !this.cubeVertexBuffer || !this.cubeIndexBuffer) return;
+  private render3D() {
+     if (!this.device || !this.context || !this.cubePipeline || !this.renderTargetView || !this.cubeBindGroup || !this.cubeVertexBuffer || !this.cubeIndexBuffer || !this.screenPassDescriptor) return;
 
-      this.device.queue.writeBuffer(this.waveformUniformBuffer!, 0, new Float32Array([
-          512, 512, this.time, audioLevel
-      ]));
+      this.writeWaveformUniforms(512, 512);
 
       const commandEncoder = this.device.createCommandEncoder();
+      this.encodeLevel(commandEncoder);
 
-      const waveformPass = commandEncoder.beginRenderPass({
-          colorAttachments: [{
-              view: this.renderTargetView!,
-              clearValue: { r: 0, g: 0, b: 0, a: 1 },
-              loadOp: 'clear',
-              storeOp: 'store'
-          }]
-      });
+      const waveformPass = commandEncoder.beginRenderPass(this.screenPassDescriptor);
       waveformPass.setPipeline(this.waveformPipeline!);
       waveformPass.setBindGroup(0, this.waveformBindGroup!);
       waveformPass.draw(6);
       waveformPass.end();
 
       const aspect = this.canvas.width / this.canvas.height;
-      const projection = Mat4.perspective(Math.PI / 4, aspect, 0.1, 100.0);
+      Mat4.perspectiveInto(this.projection, Math.PI / 4, aspect, 0.1, 100.0);
 
       const radius = 5;
       // Clamp X rotation to avoid flipping
@@ -460,42 +1096,31 @@ struct Uniforms {
       const camY = Math.sin(this.cameraRotation.x) * radius;
       const camZ = Math.cos(this.cameraRotation.y) * radius * Math.cos(this.cameraRotation.x);
 
-      const view = Mat4.lookAt(
-          new Vec3(camX, camY, camZ),
-          new Vec3(0, 0, 0),
-          new Vec3(0, 1, 0)
-      );
-
-      const mvp = Mat4.multiply(projection, view);
-      this.device.queue.writeBuffer(this.cubeUniformBuffer!, 0, mvp.values as any);
+      Mat4.lookAtInto(this.view, this.eye.set(camX, camY, camZ), this.center, this.up);
+      Mat4.multiplyInto(this.mvp, this.projection, this.view);
+      this.device.queue.writeBuffer(this.cubeUniformBuffer!, 0, this.mvp.values);
+      this.frameUploadBytes += this.mvp.values.byteLength;
 
       if (!this.depthTexture ||
           this.depthTexture.width !== this.canvas.width ||
           this.depthTexture.height !== this.canvas.height) {
-          if (this.depthTexture) this.depthTexture.destroy();
-          this.depthTexture = this.device.createTexture({
+          this.resources.release(this.depthTexture);
+          this.depthTexture = this.resources.texture(this.device, {
               size: [this.canvas.width, this.canvas.height],
               format: 'depth24plus',
               usage: GPUTextureUsage.RENDER_ATTACHMENT
           });
+          this.depthView = this.depthTexture.createView();
       }
 
-      const textureView = this.context.getCurrentTexture().createView();
+      const attachment = this.canvasColorAttachment;
+      attachment.view = this.context.getCurrentTexture().createView();
+      (attachment.clearValue as GPUColorDict).r = 0.05;
+      (attachment.clearValue as GPUColorDict).g = 0.05;
+      (attachment.clearValue as GPUColorDict).b = 0.05;
+      this.cubeDepthAttachment.view = this.depthView!;
 
-      const cubePass = commandEncoder.beginRenderPass({
-          colorAttachments: [{
-              view: textureView,
-              clearValue: { r: 0.05, g: 0.05, b: 0.05, a: 1.0 },
-              loadOp: 'clear',
-              storeOp: 'store'
-          }],
-          depthStencilAttachment: {
-              view: this.depthTexture.createView(),
-              depthClearValue: 1.0,
-              depthLoadOp: 'clear',
-              depthStoreOp: 'store'
-          }
-      });
+      const cubePass = commandEncoder.beginRenderPass(this.cubePassDescriptor);
 
       cubePass.setPipeline(this.cubePipeline);
       cubePass.setBindGroup(0, this.cubeBindGroup);
@@ -504,18 +1129,25 @@ struct Uniforms {
       cubePass.drawIndexed(36);
 
       cubePass.end();
-      this.device.queue.submit([commandEncoder.finish()]);
+      this.submit(commandEncoder);
   }
 
   startAnimation(): void {
-    const animate = () => {
-      this.render();
-      this.animationFrameId = requestAnimationFrame(animate);
+    // Re-initialising (output mode switch) must not leave a second loop running
+    this.stopAnimation();
+    this.running = true;
+    this.wake();
+  }
+
+  // CPU frame time, dropped frames and GC-free streaks of the render loop, and how it was paced
+  getStats(): VisualizerStats {
+    return {
+      ...this.frameStats.snapshot(), ...this.pacer.snapshot(), ...this.clock.snapshot(), ...this.resources.snapshot()
     };
-    animate();
   }
 
   stopAnimation(): void {
+    this.running = false;
     if (this.animationFrameId !== null) {
       cancelAnimationFrame(this.animationFrameId);
       this.animationFrameId = null;
@@ -524,15 +1156,12 @@ struct Uniforms {
 
   destroy(): void {
     this.stopAnimation();
-    if (this.waveformUniformBuffer) this.waveformUniformBuffer.destroy();
-    if (this.cubeUniformBuffer) this.cubeUniformBuffer.destroy();
-    if (this.cubeVertexBuffer) this.cubeVertexBuffer.destroy();
-    if (this.cubeIndexBuffer) this.cubeIndexBuffer.destroy();
-    if (this.renderTargetTexture) this.renderTargetTexture.destroy();
-    if (this.depthTexture) this.depthTexture.destroy();
+    this.resources.releaseAll();
+    this.gpuReady = null;
     if (this.device) {
-      this.device.destroy();
+      const device = this.device;
       this.device = null;
+      device.destroy();
     }
   }
 }
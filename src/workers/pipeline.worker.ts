@@ -0,0 +1,47 @@
+// Loader pipeline worker: fetches audio (and its index) and interleaves decoded channels off the main thread.
+import { AudioLoader } from '../audioLoader';
+import { PipelineRequest, PipelineResponse, interleaveInto } from './pipelineProtocol';
+
+interface PipelineWorkerScope {
+  onmessage: ((e: MessageEvent<PipelineRequest>) => void) | null;
+  postMessage(message: PipelineResponse, transfer?: Transferable[]): void;
+}
+
+const scope = self as unknown as PipelineWorkerScope;
+const loader = new AudioLoader();
+
+async function handle(request: PipelineRequest): Promise<void> {
+  switch (request.type) {
+    case 'fetch': {
+      const { audio, index } = await loader.loadTrack(request.url);
+      scope.postMessage({ type: 'fetched', id: request.id, buffer: audio, index }, index ? [audio, index] : [audio]);
+      break;
+    }
+    case 'interleave': {
+      const frames = request.channels.length > 0 ? request.channels[0].length : 0;
+      const length = frames * request.channels.length;
+
+      if (request.target) {
+        const destination = new Float32Array(request.target.memory, request.target.byteOffset, length);
+        interleaveInto(request.channels, destination);
+        scope.postMessage({ type: 'interleaved', id: request.id, buffer: null, length });
+      } else {
+        const destination = new Float32Array(length);
+        interleaveInto(request.channels, destination);
+        scope.postMessage({ type: 'interleaved', id: request.id, buffer: destination.buffer, length }, [destination.buffer]);
+      }
+      break;
+    }
+  }
+}
+
+scope.onmessage = (e) => {
+  const request = e.data;
+  handle(request).catch((error) => {
+    scope.postMessage({
+      type: 'error',
+      id: request.id,
+      message: error instanceof Error ? error.message : String(error)
+    });
+  });
+};
@@ -0,0 +1,48 @@
+// Typed command channel between the main thread and the loader pipeline worker.
+// Every request carries an id; the worker answers with exactly one response of the same id.
+
+// Destination inside a shared WebAssembly heap. When the engine's memory is a
+// SharedArrayBuffer the worker writes interleaved samples straight into a malloc'd block.
+export interface SharedHeapTarget {
+  memory: SharedArrayBuffer;
+  byteOffset: number;
+}
+
+export type PipelineRequest =
+  | { type: 'fetch'; id: number; url: string }
+  | { type: 'interleave'; id: number; channels: Float32Array[]; target: SharedHeapTarget | null };
+
+export type PipelineResponse =
+  // `index` is the scanner's sidecar next to the audio, when there is one
+  | { type: 'fetched'; id: number; buffer: ArrayBuffer; index: ArrayBuffer | null }
+  // `buffer` is null when the samples were written into the shared heap target
+  | { type: 'interleaved'; id: number; buffer: ArrayBuffer | null; length: number }
+  | { type: 'error'; id: number; message: string };
+
+// Plain loop shared by the worker and the in-thread fallback.
+export function interleaveInto(channels: Float32Array[], destination: Float32Array): void {
+  const channelCount = channels.length;
+  const frames = channelCount > 0 ? channels[0].length : 0;
+
+  if (channelCount === 1) {
+    destination.set(channels[0].subarray(0, frames));
+    return;
+  }
+
+  if (channelCount === 2) {
+    const left = channels[0];
+    const right = channels[1];
+    for (let i = 0, j = 0; i < frames; i++, j += 2) {
+      destination[j] = left[i];
+      destination[j + 1] = right[i];
+    }
+    return;
+  }
+
+  for (let ch = 0; ch < channelCount; ch++) {
+    const source = channels[ch];
+    for (let i = 0, j = ch; i < frames; i++, j += channelCount) {
+      destination[j] = source[i];
+    }
+  }
+}
@@ -0,0 +1,96 @@
+// Visualizer worker: runs WebGPUVisualizer on a transferred OffscreenCanvas, so its frames
+// keep coming while the main thread is busy (React, track loads, decoding).
+import { WebGPUVisualizer } from '../webgpuVisualizer';
+import { EngineSpectrumSource } from '../spectrumSource';
+import { StereoSource } from '../stereoSource';
+import { VisualizerRequest, VisualizerResponse } from './visualizerProtocol';
+
+interface VisualizerWorkerScope {
+  onmessage: ((e: MessageEvent<VisualizerRequest>) => void) | null;
+  postMessage(message: VisualizerResponse): void;
+}
+
+const STATS_INTERVAL_MS = 500;
+
+const scope = self as unknown as VisualizerWorkerScope;
+let visualizer: WebGPUVisualizer | null = null;
+let statsTimer: ReturnType<typeof setInterval> | null = null;
+
+function stopStats(): void {
+  if (statsTimer !== null) {
+    clearInterval(statsTimer);
+    statsTimer = null;
+  }
+}
+
+async function handle(request: VisualizerRequest): Promise<void> {
+  switch (request.type) {
+    case 'probe': {
+      // Workers can lack WebGPU where the page has it, so this is checked here, not there
+      const ok = !!navigator.gpu && (await navigator.gpu.requestAdapter()) !== null;
+      scope.postMessage({ type: 'probed', id: request.id, ok });
+      break;
+    }
+    case 'initialize': {
+      if (request.canvas) {
+        visualizer = new WebGPUVisualizer(request.canvas);
+        visualizer.setTogglePlayCallback(() => scope.postMessage({ type: 'togglePlay' }));
+      }
+      const spectrum = request.spectrum
+        ? new EngineSpectrumSource(() => request.spectrum!.buffer, request.spectrum.byteOffset)
+        : null;
+      const stereo = request.stereo
+        ? new StereoSource(() => request.stereo!.buffer, request.stereo.byteOffset)
+        : null;
+      const ok = visualizer ? await visualizer.initialize(spectrum, request.clock, stereo) : false;
+      scope.postMessage({ type: 'initialized', id: request.id, ok });
+      break;
+    }
+    case 'start':
+      visualizer?.startAnimation();
+      stopStats();
+      statsTimer = setInterval(() => {
+        if (visualizer) scope.postMessage({ type: 'stats', stats: visualizer.getStats() });
+      }, STATS_INTERVAL_MS);
+      break;
+    case 'stop':
+      visualizer?.stopAnimation();
+      stopStats();
+      break;
+    case 'mode':
+      visualizer?.setMode(request.mode);
+      break;
+    case 'visible':
+      visualizer?.setVisible(request.visible);
+      break;
+    case 'playing':
+      visualizer?.setPlaying(request.playing);
+      break;
+    case 'battery':
+      visualizer?.setBatteryFpsCap(request.fpsCap);
+      visualizer?.setOnBattery(request.onBattery);
+      break;
+    case 'pointer':
+      if (!visualizer) break;
+      if (request.kind === 'down') visualizer.pointerDown(request.x, request.y);
+      else if (request.kind === 'move') visualizer.pointerMove(request.x, request.y);
+      else visualizer.pointerUp();
+      break;
+    case 'destroy':
+      stopStats();
+      visualizer?.destroy();
+      visualizer = null;
+      break;
+  }
+}
+
+scope.onmessage = (e) => {
+  handle(e.data).catch((err) => {
+    console.error('Visualizer worker error:', err);
+    if (e.data.type === 'initialize') {
+      scope.postMessage({ type: 'initialized', id: e.data.id, ok: false });
+    } else if (e.data.type === 'probe') {
+      scope.postMessage({ type: 'probed', id: e.data.id, ok: false });
+    }
+  });
+};
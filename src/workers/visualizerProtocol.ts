@@ -0,0 +1,32 @@
+// Messages between the page and the visualizer worker (see src/visualizerClient.ts).
+import { SharedSpectrumBlock } from '../spectrumSource';
+import { SharedStereoBlock } from '../stereoSource';
+import { StateBlockLocation } from '../playerStateBlock';
+import { VisualizerMode, VisualizerStats } from '../webgpuVisualizer';
+
+export type VisualizerRequest =
+  // Whether WebGPU works in the worker; asked before the canvas is handed over for good
+  | { type: 'probe'; id: number }
+  // `canvas` is only sent (transferred) with the first initialize
+  // `clock` is the player's state block, in shared memory
+  | {
+      type: 'initialize'; id: number; canvas: OffscreenCanvas | null;
+      spectrum: SharedSpectrumBlock | null; clock: StateBlockLocation | null; stereo: SharedStereoBlock | null;
+    }
+  | { type: 'start' }
+  | { type: 'stop' }
+  | { type: 'mode'; mode: VisualizerMode }
+  // Pacing inputs the worker can't observe itself
+  | { type: 'visible'; visible: boolean }
+  | { type: 'playing'; playing: boolean }
+  | { type: 'battery'; onBattery: boolean; fpsCap: number }
+  | { type: 'pointer'; kind: 'down' | 'move' | 'up'; x: number; y: number }
+  | { type: 'destroy' };
+
+export type VisualizerResponse =
+  | { type: 'probed'; id: number; ok: boolean }
+  | { type: 'initialized'; id: number; ok: boolean }
+  // Posted twice a second while animating
+  | { type: 'stats'; stats: VisualizerStats }
+  // The 3D screen's play button was hit
+  | { type: 'togglePlay' };
@@ -1,7 +1,49 @@
 const path = require('path');
+const fs = require('fs');
+const crypto = require('crypto');
+const webpack = require('webpack');
 const HtmlWebpackPlugin = require('html-webpack-plugin');
 const CopyPlugin = require('copy-webpack-plugin');
 
+// Emits sw.js from src/sw.template.js with a manifest of every shell asset and its content hash.
+// Runs after HtmlWebpackPlugin and CopyPlugin so index.html and the sdl-audio/worklet files are included.
+// Only production builds get a service worker (dev keeps hitting the network); the app reads
+// that from __SERVICE_WORKER_ENABLED__.
+class PrecacheManifestPlugin {
+  constructor({ template, include, exclude }) {
+    this.template = template;
+    this.include = include;
+    this.exclude = exclude;
+  }
+
+  apply(compiler) {
+    const enabled = compiler.options.mode === 'production';
+    new webpack.DefinePlugin({ __SERVICE_WORKER_ENABLED__: JSON.stringify(enabled) }).apply(compiler);
+    if (!enabled) return;
+
+    compiler.hooks.thisCompilation.tap('PrecacheManifestPlugin', (compilation) => {
+      compilation.hooks.processAssets.tap(
+        { name: 'PrecacheManifestPlugin', stage: webpack.Compilation.PROCESS_ASSETS_STAGE_SUMMARIZE },
+        (assets) => {
+          const manifest = Object.keys(assets)
+            .filter((name) => this.include.test(name) && !this.exclude.test(name))
+            .sort()
+            .map((name) => ({
+              url: name,
+              revision: crypto.createHash('sha256').update(assets[name].buffer()).digest('hex').slice(0, 16)
+            }));
+          const version = crypto.createHash('sha256').update(JSON.stringify(manifest)).digest('hex').slice(0, 16);
+
+          const source = fs.readFileSync(this.template, 'utf8')
+            .replace('self.__PRECACHE_MANIFEST', JSON.stringify(manifest))
+            .replace('self.__PRECACHE_VERSION', JSON.stringify(version));
+          compilation.emitAsset('sw.js', new webpack.sources.RawSource(source));
+        }
+      );
+    });
+  }
+}
+
 module.exports = {
   entry: './src/index.tsx',
   output: {
@@ -31,11 +73,18 @@ module.exports = {
       template: './public/index.html',
       filename: 'index.html'
     }),
-    // Ensure sdl-audio.* files from public/ are copied into dist/
+    // Ensure sdl-audio.* and the ScriptProcessor worklet shim from public/ are copied into dist/
     new CopyPlugin({
       patterns: [
-        { from: 'public/sdl-audio.*', to: '.' }
+        { from: 'public/sdl-audio.*', to: '[name][ext]' },
+        { from: 'public/script-processor-*.js', to: '[name][ext]' },
+        { from: 'public/pcm-ring-processor.js', to: '[name][ext]' }
       ]
+    }),
+    new PrecacheManifestPlugin({
+      template: './src/sw.template.js',
+      include: /\.(html|js|wasm)$/,
+      exclude: /^sw\.js$|\.LICENSE\.txt$/
     })
   ],
   devServer: {
@@ -45,10 +94,12 @@ module.exports = {
     compress: true,
     port: 3000,
     hot: true,
-    // Required for AudioWorklet and cross-origin isolation during development
-    headers: {
+    // Required for AudioWorklet and cross-origin isolation during development. sw.js is never
+    // cached so a left-over worker from a production build gets replaced on the next check.
+    headers: (req) => ({
       "Cross-Origin-Opener-Policy": "same-origin",
-      "Cross-Origin-Embedder-Policy": "require-corp"
-    }
+      "Cross-Origin-Embedder-Policy": "require-corp",
+      ...(req.path === '/sw.js' ? { "Cache-Control": "no-cache" } : {})
+    })
   }
 };